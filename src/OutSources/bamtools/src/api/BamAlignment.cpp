@@ -351,6 +351,49 @@ bool BamAlignment::BuildCharData(void) {
     return true;
 }
 
+/*! \fn const char* BamAlignment::GetRawName(void) const
+    \brief Returns the read name without populating the string fields.
+
+    For a core-only alignment the name is read in place from the raw record, so
+    the alignments discarded after a look at their names are never copied.
+
+    \return pointer to the null-terminated read name, valid until the alignment is changed
+*/
+const char* BamAlignment::GetRawName(void) const {
+
+    if ( !SupportData.HasCoreOnly )
+        return Name.c_str();
+
+    // relies on null char in name as terminator
+    return SupportData.AllCharData.data();
+}
+
+/*! \fn const char* BamAlignment::GetRawTagData(unsigned int& tagDataLength) const
+    \brief Returns the tag data without populating the string fields.
+
+    For a core-only alignment the tags are read in place from the raw record.
+    The raw tags are not swapped, so on big endian systems BuildCharData()
+    has to be called first.
+
+    \param[out] tagDataLength length of the tag data
+    \return pointer to the tag data, valid until the alignment is changed
+*/
+const char* BamAlignment::GetRawTagData(unsigned int& tagDataLength) const {
+
+    if ( !SupportData.HasCoreOnly ) {
+        tagDataLength = TagData.size();
+        return TagData.data();
+    }
+
+    // calculate tag data length/offset
+    const unsigned int dataLength     = SupportData.BlockLength - Constants::BAM_CORE_SIZE;
+    const unsigned int tagDataOffset  = SupportData.QueryNameLength + (SupportData.NumCigarOperations*4)
+                                      + (SupportData.QuerySequenceLength+1)/2 + SupportData.QuerySequenceLength;
+
+    tagDataLength = ( tagDataOffset < dataLength ) ? dataLength - tagDataOffset : 0;
+    return SupportData.AllCharData.data() + tagDataOffset;
+}
+
 /*! \fn bool BamAlignment::FindTag(const std::string& tag, char*& pTagData, const unsigned int& tagDataLength, unsigned int& numBytesParsed) const
     \internal
 
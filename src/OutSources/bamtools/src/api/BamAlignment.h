@@ -94,6 +94,10 @@ struct API_EXPORT BamAlignment {
         // populates alignment string fields
         bool BuildCharData(void);
 
+        // read name and tag data, read in place from a core-only alignment
+        const char* GetRawName(void) const;
+        const char* GetRawTagData(unsigned int& tagDataLength) const;
+
         // calculates alignment end position
         int GetEndPosition(bool usePadded = false, bool closedInterval = false) const;
 
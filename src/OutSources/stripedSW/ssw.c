@@ -41,6 +41,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+#include <pthread.h>
 #include "ssw.h"
 
 #ifdef __GNUC__
@@ -83,20 +84,81 @@ struct _profile{
 	int32_t readLen;
 	int32_t n;
 	uint8_t bias;
+	int32_t byte_cap;	// bytes allocated for profile_byte
+	int32_t word_cap;	// bytes allocated for profile_word
+	int8_t simd;	// SSW_SIMD_* level of the kernels the profile is built for
 };
 
+/* Number of bytes in a vector register of a SIMD level: 16, 32 or 64. */
+#define simd_bytes(simd) (16 << (simd))
+
+/* Size of a byte (word) query profile in bytes. */
+#define profile_byte_size(readLen, n, simd) ((n) * (((readLen) + simd_bytes(simd) - 1) / simd_bytes(simd)) * simd_bytes(simd))
+#define profile_word_size(readLen, n, simd) ((n) * (((readLen) + simd_bytes(simd) / 2 - 1) / (simd_bytes(simd) / 2)) * simd_bytes(simd))
+
+/* Heap allocations made by the calling thread, see ssw_num_allocs. */
+static __thread int64_t ssw_allocs = 0;
+
+static void* ssw_malloc (size_t size) {
+	++ssw_allocs;
+	return malloc(size);
+}
+
+static void* ssw_calloc (size_t n, size_t size) {
+	++ssw_allocs;
+	return calloc(n, size);
+}
+
+static void* ssw_realloc (void* p, size_t size) {
+	++ssw_allocs;
+	return realloc(p, size);
+}
+
+/* Allocate memory aligned for the widest vector registers. */
+static void* ssw_malloc_aligned (size_t size) {
+	void* p = 0;
+	++ssw_allocs;
+	if (posix_memalign(&p, 64, size) != 0) return 0;
+	return p;
+}
+
+static void* ssw_calloc_aligned (size_t n, size_t size) {
+	void* p = ssw_malloc_aligned(n * size);
+	if (p != 0) memset(p, 0, n * size);
+	return p;
+}
+
+void qP_byte_fill (__m128i* vProfile, const int8_t* read_num, const int8_t* mat, const int32_t readLen, const int32_t n, uint8_t bias, int8_t simd);
+
+void qP_word_fill (__m128i* vProfile, const int8_t* read_num, const int8_t* mat, const int32_t readLen, const int32_t n, int8_t simd);
+
 /* Generate query profile rearrange query sequence & calculate the weight of match/mismatch. */
 __m128i* qP_byte (const int8_t* read_num,
 				  const int8_t* mat,
 				  const int32_t readLen,
 				  const int32_t n,	/* the edge length of the squre matrix mat */
-				  uint8_t bias) {
+				  uint8_t bias,
+				  int8_t simd) {	/* SSW_SIMD_* level of the kernel */
  
-	int32_t segLen = (readLen + 15) / 16; /* Split the 128 bit register into 16 pieces. 
-								     Each piece is 8 bit. Split the read into 16 segments. 
-								     Calculat 16 segments in parallel.
+	__m128i* vProfile = (__m128i*)ssw_malloc_aligned(profile_byte_size(readLen, n, simd));
+	qP_byte_fill(vProfile, read_num, mat, readLen, n, bias, simd);
+	return vProfile;
+}
+
+/* Fill a byte query profile that has been allocated. */
+void qP_byte_fill (__m128i* vProfile,
+				   const int8_t* read_num,
+				   const int8_t* mat,
+				   const int32_t readLen,
+				   const int32_t n,
+				   uint8_t bias,
+				   int8_t simd) {
+
+	int32_t lanes = simd_bytes(simd);
+	int32_t segLen = (readLen + lanes - 1) / lanes; /* Split the register into lanes of 8 bit. 
+								     Split the read into as many segments as the lanes. 
+								     Calculat the segments in parallel.
 								   */
-	__m128i* vProfile = (__m128i*)malloc(n * segLen * sizeof(__m128i));
 	int8_t* t = (int8_t*)vProfile;
 	int32_t nt, i, j, segNum;
 	
@@ -104,13 +166,12 @@ __m128i* qP_byte (const int8_t* read_num,
 	for (nt = 0; LIKELY(nt < n); nt ++) {
 		for (i = 0; i < segLen; i ++) {
 			j = i; 
-			for (segNum = 0; LIKELY(segNum < 16) ; segNum ++) {
+			for (segNum = 0; LIKELY(segNum < lanes) ; segNum ++) {
 				*t++ = j>= readLen ? bias : mat[nt * n + read_num[j]] + bias;
 				j += segLen;
 			}
 		}
 	}
-	return vProfile;
 }
 
 /* Striped Smith-Waterman
@@ -146,18 +207,18 @@ alignment_end* sw_sse2_byte (const int8_t* ref,
 	int32_t segLen = (readLen + 15) / 16; /* number of segment */
 	
 	/* array to record the largest score of each reference position */
-	uint8_t* maxColumn = (uint8_t*) calloc(refLen, 1); 
+	uint8_t* maxColumn = (uint8_t*) ssw_calloc(refLen, 1); 
 	
 	/* array to record the alignment read ending position of the largest score of each reference position */
-	int32_t* end_read_column = (int32_t*) calloc(refLen, sizeof(int32_t));
+	int32_t* end_read_column = (int32_t*) ssw_calloc(refLen, sizeof(int32_t));
 	
 	/* Define 16 byte 0 vector. */
 	__m128i vZero = _mm_set1_epi32(0);
 
-	__m128i* pvHStore = (__m128i*) calloc(segLen, sizeof(__m128i));
-	__m128i* pvHLoad = (__m128i*) calloc(segLen, sizeof(__m128i));
-	__m128i* pvE = (__m128i*) calloc(segLen, sizeof(__m128i));
-	__m128i* pvHmax = (__m128i*) calloc(segLen, sizeof(__m128i));
+	__m128i* pvHStore = (__m128i*) ssw_calloc(segLen, sizeof(__m128i));
+	__m128i* pvHLoad = (__m128i*) ssw_calloc(segLen, sizeof(__m128i));
+	__m128i* pvE = (__m128i*) ssw_calloc(segLen, sizeof(__m128i));
+	__m128i* pvHmax = (__m128i*) ssw_calloc(segLen, sizeof(__m128i));
 
 	int32_t i, j;
 	/* 16 byte insertion begin vector */
@@ -313,7 +374,7 @@ alignment_end* sw_sse2_byte (const int8_t* ref,
 	free(pvHStore); 	
 
 	/* Find the most possible 2nd best alignment. */
-	alignment_end* bests = (alignment_end*) calloc(2, sizeof(alignment_end));
+	alignment_end* bests = (alignment_end*) ssw_calloc(2, sizeof(alignment_end));
 	bests[0].score = max + bias >= 255 ? 255 : max;
 	bests[0].ref = end_ref;
 	bests[0].read = end_read;
@@ -347,10 +408,24 @@ alignment_end* sw_sse2_byte (const int8_t* ref,
 __m128i* qP_word (const int8_t* read_num,
 				  const int8_t* mat,
 				  const int32_t readLen,
-				  const int32_t n) { 
+				  const int32_t n,
+				  int8_t simd) { 
 					
-	int32_t segLen = (readLen + 7) / 8; 
-	__m128i* vProfile = (__m128i*)malloc(n * segLen * sizeof(__m128i));
+	__m128i* vProfile = (__m128i*)ssw_malloc_aligned(profile_word_size(readLen, n, simd));
+	qP_word_fill(vProfile, read_num, mat, readLen, n, simd);
+	return vProfile;
+}
+
+/* Fill a word query profile that has been allocated. */
+void qP_word_fill (__m128i* vProfile,
+				   const int8_t* read_num,
+				   const int8_t* mat,
+				   const int32_t readLen,
+				   const int32_t n,
+				   int8_t simd) {
+
+	int32_t lanes = simd_bytes(simd) / 2;
+	int32_t segLen = (readLen + lanes - 1) / lanes;
 	int16_t* t = (int16_t*)vProfile;
 	int32_t nt, i, j;
 	int32_t segNum;
@@ -359,13 +434,12 @@ __m128i* qP_word (const int8_t* read_num,
 	for (nt = 0; LIKELY(nt < n); nt ++) {
 		for (i = 0; i < segLen; i ++) {
 			j = i; 
-			for (segNum = 0; LIKELY(segNum < 8) ; segNum ++) {
+			for (segNum = 0; LIKELY(segNum < lanes) ; segNum ++) {
 				*t++ = j>= readLen ? 0 : mat[nt * n + read_num[j]];
 				j += segLen;
 			}
 		}
 	}
-	return vProfile;
 }
 
 alignment_end* sw_sse2_word (const int8_t* ref, 
@@ -389,18 +463,18 @@ alignment_end* sw_sse2_word (const int8_t* ref,
 	int32_t segLen = (readLen + 7) / 8; /* number of segment */
 	
 	/* array to record the largest score of each reference position */
-	uint16_t* maxColumn = (uint16_t*) calloc(refLen, 2); 
+	uint16_t* maxColumn = (uint16_t*) ssw_calloc(refLen, 2); 
 	
 	/* array to record the alignment read ending position of the largest score of each reference position */
-	int32_t* end_read_column = (int32_t*) calloc(refLen, sizeof(int32_t));
+	int32_t* end_read_column = (int32_t*) ssw_calloc(refLen, sizeof(int32_t));
 	
 	/* Define 16 byte 0 vector. */
 	__m128i vZero = _mm_set1_epi32(0);
 
-	__m128i* pvHStore = (__m128i*) calloc(segLen, sizeof(__m128i));
-	__m128i* pvHLoad = (__m128i*) calloc(segLen, sizeof(__m128i));
-	__m128i* pvE = (__m128i*) calloc(segLen, sizeof(__m128i));
-	__m128i* pvHmax = (__m128i*) calloc(segLen, sizeof(__m128i));
+	__m128i* pvHStore = (__m128i*) ssw_calloc(segLen, sizeof(__m128i));
+	__m128i* pvHLoad = (__m128i*) ssw_calloc(segLen, sizeof(__m128i));
+	__m128i* pvE = (__m128i*) ssw_calloc(segLen, sizeof(__m128i));
+	__m128i* pvHmax = (__m128i*) ssw_calloc(segLen, sizeof(__m128i));
 
 	int32_t i, j, k;
 	/* 16 byte insertion begin vector */
@@ -517,7 +591,7 @@ end:
 	free(pvHStore); 
 	
 	/* Find the most possible 2nd best alignment. */
-	alignment_end* bests = (alignment_end*) calloc(2, sizeof(alignment_end));
+	alignment_end* bests = (alignment_end*) ssw_calloc(2, sizeof(alignment_end));
 	bests[0].score = max;
 	bests[0].ref = end_ref;
 	bests[0].read = end_read;
@@ -546,6 +620,189 @@ end:
 	return bests;
 }
 
+#if defined(__GNUC__) && (__GNUC__ >= 5 || defined(__clang__))
+
+#include <immintrin.h>
+
+#define SSW_HAVE_AVX 1
+
+/* 256-bit kernels */
+#define SSW_VEC __m256i
+#define SSW_SUFFIX avx2
+#define SSW_TARGET __attribute__((target("avx2")))
+#define SSW_BYTES 32
+#define V_ZERO() _mm256_setzero_si256()
+#define V_SET1_8(x) _mm256_set1_epi8(x)
+#define V_SET1_16(x) _mm256_set1_epi16(x)
+#define V_LOAD(p) _mm256_load_si256(p)
+#define V_STORE(p, v) _mm256_store_si256((p), (v))
+#define V_ADDS_U8(a, b) _mm256_adds_epu8((a), (b))
+#define V_SUBS_U8(a, b) _mm256_subs_epu8((a), (b))
+#define V_MAX_U8(a, b) _mm256_max_epu8((a), (b))
+#define V_ADDS_I16(a, b) _mm256_adds_epi16((a), (b))
+#define V_SUBS_U16(a, b) _mm256_subs_epu16((a), (b))
+#define V_MAX_I16(a, b) _mm256_max_epi16((a), (b))
+/* the byte shift of AVX2 works inside each 128-bit lane, so the lanes are stitched with a permutation */
+#define V_SHIFT(v, n) _mm256_alignr_epi8((v), _mm256_permute2x128_si256((v), (v), 0x08), 16 - (n))
+#define V_EQ_U8(a, b) (_mm256_movemask_epi8(_mm256_cmpeq_epi8((a), (b))) == -1)
+#define V_EQ_16(a, b) (_mm256_movemask_epi8(_mm256_cmpeq_epi16((a), (b))) == -1)
+#define V_GT_ANY_I16(a, b) (_mm256_movemask_epi8(_mm256_cmpgt_epi16((a), (b))) != 0)
+#define V_HMAX_U8(v) hmax_u8_avx2(v)
+#define V_HMAX_I16(v) hmax_i16_avx2(v)
+
+SSW_TARGET
+static inline uint8_t hmax_u8_avx2 (__m256i v) {
+	__m128i m = _mm_max_epu8(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+	m = _mm_max_epu8(m, _mm_srli_si128(m, 8));
+	m = _mm_max_epu8(m, _mm_srli_si128(m, 4));
+	m = _mm_max_epu8(m, _mm_srli_si128(m, 2));
+	m = _mm_max_epu8(m, _mm_srli_si128(m, 1));
+	return _mm_extract_epi16(m, 0);
+}
+
+SSW_TARGET
+static inline uint16_t hmax_i16_avx2 (__m256i v) {
+	__m128i m = _mm_max_epi16(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+	m = _mm_max_epi16(m, _mm_srli_si128(m, 8));
+	m = _mm_max_epi16(m, _mm_srli_si128(m, 4));
+	m = _mm_max_epi16(m, _mm_srli_si128(m, 2));
+	return _mm_extract_epi16(m, 0);
+}
+
+#include "ssw_kernel.h"
+
+#undef SSW_VEC
+#undef SSW_SUFFIX
+#undef SSW_TARGET
+#undef SSW_BYTES
+#undef V_ZERO
+#undef V_SET1_8
+#undef V_SET1_16
+#undef V_LOAD
+#undef V_STORE
+#undef V_ADDS_U8
+#undef V_SUBS_U8
+#undef V_MAX_U8
+#undef V_ADDS_I16
+#undef V_SUBS_U16
+#undef V_MAX_I16
+#undef V_SHIFT
+#undef V_EQ_U8
+#undef V_EQ_16
+#undef V_GT_ANY_I16
+#undef V_HMAX_U8
+#undef V_HMAX_I16
+
+/* 512-bit kernels */
+#define SSW_VEC __m512i
+#define SSW_SUFFIX avx512
+#define SSW_TARGET __attribute__((target("avx512f,avx512bw")))
+#define SSW_BYTES 64
+#define V_ZERO() _mm512_setzero_si512()
+#define V_SET1_8(x) _mm512_set1_epi8(x)
+#define V_SET1_16(x) _mm512_set1_epi16(x)
+#define V_LOAD(p) _mm512_load_si512(p)
+#define V_STORE(p, v) _mm512_store_si512((p), (v))
+#define V_ADDS_U8(a, b) _mm512_adds_epu8((a), (b))
+#define V_SUBS_U8(a, b) _mm512_subs_epu8((a), (b))
+#define V_MAX_U8(a, b) _mm512_max_epu8((a), (b))
+#define V_ADDS_I16(a, b) _mm512_adds_epi16((a), (b))
+#define V_SUBS_U16(a, b) _mm512_subs_epu16((a), (b))
+#define V_MAX_I16(a, b) _mm512_max_epi16((a), (b))
+/* the 128-bit lanes are moved up by one and stitched with alignr */
+#define V_SHIFT(v, n) _mm512_alignr_epi8((v), _mm512_maskz_shuffle_i64x2(0xfc, (v), (v), _MM_SHUFFLE(2, 1, 0, 0)), 16 - (n))
+#define V_EQ_U8(a, b) (_mm512_cmpneq_epi8_mask((a), (b)) == 0)
+#define V_EQ_16(a, b) (_mm512_cmpneq_epi16_mask((a), (b)) == 0)
+#define V_GT_ANY_I16(a, b) (_mm512_cmpgt_epi16_mask((a), (b)) != 0)
+#define V_HMAX_U8(v) hmax_u8_avx512(v)
+#define V_HMAX_I16(v) hmax_i16_avx512(v)
+
+SSW_TARGET
+static inline uint8_t hmax_u8_avx512 (__m512i v) {
+	__m256i m = _mm256_max_epu8(_mm512_castsi512_si256(v), _mm512_extracti64x4_epi64(v, 1));
+	return hmax_u8_avx2(m);
+}
+
+SSW_TARGET
+static inline uint16_t hmax_i16_avx512 (__m512i v) {
+	__m256i m = _mm256_max_epi16(_mm512_castsi512_si256(v), _mm512_extracti64x4_epi64(v, 1));
+	return hmax_i16_avx2(m);
+}
+
+#include "ssw_kernel.h"
+
+#undef SSW_VEC
+#undef SSW_SUFFIX
+#undef SSW_TARGET
+#undef SSW_BYTES
+#undef V_ZERO
+#undef V_SET1_8
+#undef V_SET1_16
+#undef V_LOAD
+#undef V_STORE
+#undef V_ADDS_U8
+#undef V_SUBS_U8
+#undef V_MAX_U8
+#undef V_ADDS_I16
+#undef V_SUBS_U16
+#undef V_MAX_I16
+#undef V_SHIFT
+#undef V_EQ_U8
+#undef V_EQ_16
+#undef V_GT_ANY_I16
+#undef V_HMAX_U8
+#undef V_HMAX_I16
+
+#endif	// __GNUC__
+
+typedef alignment_end* (*sw_byte_fn) (const int8_t*, int8_t, int32_t, int32_t, const uint8_t, const uint8_t, __m128i*, uint8_t, uint8_t, int32_t);
+typedef alignment_end* (*sw_word_fn) (const int8_t*, int8_t, int32_t, int32_t, const uint8_t, const uint8_t, __m128i*, uint16_t, int32_t);
+
+#ifdef SSW_HAVE_AVX
+static const sw_byte_fn sw_byte_kernels[] = {sw_sse2_byte, sw_byte_avx2, sw_byte_avx512};
+static const sw_word_fn sw_word_kernels[] = {sw_sse2_word, sw_word_avx2, sw_word_avx512};
+#else
+static const sw_byte_fn sw_byte_kernels[] = {sw_sse2_byte};
+static const sw_word_fn sw_word_kernels[] = {sw_sse2_word};
+#endif
+
+/* SIMD level used by ssw_init; set once by ssw_simd_default before it is read */
+static int ssw_simd = SSW_SIMD_SSE2;
+static pthread_once_t ssw_simd_once = PTHREAD_ONCE_INIT;
+
+int ssw_simd_supported (void) {
+#ifdef SSW_HAVE_AVX
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx512bw")) return SSW_SIMD_AVX512;
+	if (__builtin_cpu_supports("avx2")) return SSW_SIMD_AVX2;
+#endif
+	return SSW_SIMD_SSE2;
+}
+
+/* AVX-512 is not the default: with reads of 50-100bp the 64 byte lanes are
+   mostly padding and the wider kernels run slower than AVX2 (ssw_bench). */
+static void ssw_simd_default (void) {
+	int supported = ssw_simd_supported();
+	ssw_simd = supported > SSW_SIMD_AVX2 ? SSW_SIMD_AVX2 : supported;
+}
+
+int ssw_simd_level (void) {
+	pthread_once(&ssw_simd_once, ssw_simd_default);
+	return ssw_simd;
+}
+
+int ssw_set_simd_level (int level) {
+	pthread_once(&ssw_simd_once, ssw_simd_default);
+	int supported = ssw_simd_supported();
+	if (level < SSW_SIMD_SSE2) level = SSW_SIMD_SSE2;
+	ssw_simd = level > supported ? supported : level;
+	return ssw_simd;
+}
+
+int64_t ssw_num_allocs (void) {
+	return ssw_allocs;
+}
+
 cigar* banded_sw (const int8_t* ref,
 				 const int8_t* read, 
 				 int32_t refLen, 
@@ -557,24 +814,24 @@ cigar* banded_sw (const int8_t* ref,
 				 const int8_t* mat,	/* pointer to the weight matrix */
 				 int32_t n) {	
 
-	uint32_t *c = (uint32_t*)malloc(16 * sizeof(uint32_t)), *c1;
+	uint32_t *c = (uint32_t*)ssw_malloc(16 * sizeof(uint32_t)), *c1;
 	int32_t i, j, e, f, temp1, temp2, s = 16, s1 = 8, s2 = 1024, l, max = 0;
 	int32_t width, width_d, *h_b, *e_b, *h_c;
 	int8_t *direction, *direction_line;
-	cigar* result = (cigar*)malloc(sizeof(cigar));
-	h_b = (int32_t*)malloc(s1 * sizeof(int32_t)); 
-	e_b = (int32_t*)malloc(s1 * sizeof(int32_t)); 
-	h_c = (int32_t*)malloc(s1 * sizeof(int32_t)); 
-	direction = (int8_t*)malloc(s2 * sizeof(int8_t));
+	cigar* result = (cigar*)ssw_malloc(sizeof(cigar));
+	h_b = (int32_t*)ssw_malloc(s1 * sizeof(int32_t)); 
+	e_b = (int32_t*)ssw_malloc(s1 * sizeof(int32_t)); 
+	h_c = (int32_t*)ssw_malloc(s1 * sizeof(int32_t)); 
+	direction = (int8_t*)ssw_malloc(s2 * sizeof(int8_t));
 
 	do {
 		width = band_width * 2 + 3, width_d = band_width * 2 + 1;
 		while (width >= s1) {
 			++s1;
 			kroundup32(s1);
-			h_b = (int32_t*)realloc(h_b, s1 * sizeof(int32_t)); 
-			e_b = (int32_t*)realloc(e_b, s1 * sizeof(int32_t)); 
-			h_c = (int32_t*)realloc(h_c, s1 * sizeof(int32_t)); 
+			h_b = (int32_t*)ssw_realloc(h_b, s1 * sizeof(int32_t)); 
+			e_b = (int32_t*)ssw_realloc(e_b, s1 * sizeof(int32_t)); 
+			h_c = (int32_t*)ssw_realloc(h_c, s1 * sizeof(int32_t)); 
 		}
 		while (width_d * readLen * 3 >= s2) {
 			++s2;
@@ -583,7 +840,7 @@ cigar* banded_sw (const int8_t* ref,
 				fprintf(stderr, "Alignment score and position are not consensus.\n");
 				exit(1);
 			}
-			direction = (int8_t*)realloc(direction, s2 * sizeof(int8_t)); 
+			direction = (int8_t*)ssw_realloc(direction, s2 * sizeof(int8_t)); 
 		}
 		direction_line = direction;
 		for (j = 1; LIKELY(j < width - 1); j ++) h_b[j] = 0;
@@ -679,7 +936,7 @@ cigar* banded_sw (const int8_t* ref,
 			while (l >= s) {
 				++s;
 				kroundup32(s);
-				c = (uint32_t*)realloc(c, s * sizeof(uint32_t));
+				c = (uint32_t*)ssw_realloc(c, s * sizeof(uint32_t));
 			}
 			c[l - 1] = e<<4|max;
 			max = f;
@@ -691,7 +948,7 @@ cigar* banded_sw (const int8_t* ref,
 		while (l >= s) {
 			++s;
 			kroundup32(s);
-			c = (uint32_t*)realloc(c, s * sizeof(uint32_t));
+			c = (uint32_t*)ssw_realloc(c, s * sizeof(uint32_t));
 		}
 		c[l - 1] = (e+1)<<4;
 	}else {
@@ -699,14 +956,14 @@ cigar* banded_sw (const int8_t* ref,
 		while (l >= s) {
 			++s;
 			kroundup32(s);
-			c = (uint32_t*)realloc(c, s * sizeof(uint32_t));
+			c = (uint32_t*)ssw_realloc(c, s * sizeof(uint32_t));
 		}
 		c[l - 2] = e<<4|f;
 		c[l - 1] = 16;	// 1M
 	}
 
 	// reverse cigar
-	c1 = (uint32_t*)malloc(l * sizeof(uint32_t));
+	c1 = (uint32_t*)ssw_malloc(l * sizeof(uint32_t));
 	s = 0;
 	e = l - 1;
 	while (LIKELY(s <= e)) {			
@@ -728,7 +985,7 @@ cigar* banded_sw (const int8_t* ref,
 
 int8_t* seq_reverse(const int8_t* seq, int32_t end)	/* end is 0-based alignment ending position */	
 {									
-	int8_t* reverse = (int8_t*)calloc(end + 1, sizeof(int8_t));	
+	int8_t* reverse = (int8_t*)ssw_calloc(end + 1, sizeof(int8_t));	
 	int32_t start = 0;
 	while (LIKELY(start <= end)) {			
 		reverse[start] = seq[end];		
@@ -740,10 +997,11 @@ int8_t* seq_reverse(const int8_t* seq, int32_t end)	/* end is 0-based alignment
 }
 		
 s_profile* ssw_init (const int8_t* read, const int32_t readLen, const int8_t* mat, const int32_t n, const int8_t score_size) {
-	s_profile* p = (s_profile*)calloc(1, sizeof(struct _profile));
+	s_profile* p = (s_profile*)ssw_calloc(1, sizeof(struct _profile));
 	p->profile_byte = 0;
 	p->profile_word = 0;
 	p->bias = 0;
+	p->simd = ssw_simd_level();
 	
 	if (score_size == 0 || score_size == 2) {
 		/* Find the bias to use in the substitution matrix */
@@ -752,9 +1010,58 @@ s_profile* ssw_init (const int8_t* read, const int32_t readLen, const int8_t* ma
 		bias = abs(bias);
 
 		p->bias = bias;
-		p->profile_byte = qP_byte (read, mat, readLen, n, bias);
+		p->profile_byte = qP_byte (read, mat, readLen, n, bias, p->simd);
+		p->byte_cap = profile_byte_size(readLen, n, p->simd);
+	}
+	if (score_size == 1 || score_size == 2) {
+		p->profile_word = qP_word (read, mat, readLen, n, p->simd);
+		p->word_cap = profile_word_size(readLen, n, p->simd);
+	}
+	p->read = read;
+	p->mat = mat;
+	p->readLen = readLen;
+	p->n = n;
+	return p;
+}
+
+s_profile* ssw_reinit (s_profile* p, const int8_t* read, const int32_t readLen, const int8_t* mat, const int32_t n, const int8_t score_size) {
+	int32_t size;
+	if (p == 0) return ssw_init(read, readLen, mat, n, score_size);
+	p->simd = ssw_simd_level();
+
+	if (score_size == 0 || score_size == 2) {
+		/* Find the bias to use in the substitution matrix */
+		int32_t bias = 0, i;
+		for (i = 0; i < n*n; i++) if (mat[i] < bias) bias = mat[i];
+		bias = abs(bias);
+
+		size = profile_byte_size(readLen, n, p->simd);
+		if (p->byte_cap < size) {
+			free(p->profile_byte);
+			p->profile_byte = (__m128i*)ssw_malloc_aligned(size);
+			p->byte_cap = size;
+		}
+		p->bias = bias;
+		qP_byte_fill(p->profile_byte, read, mat, readLen, n, bias, p->simd);
+	} else {
+		free(p->profile_byte);
+		p->profile_byte = 0;
+		p->byte_cap = 0;
+		p->bias = 0;
+	}
+	if (score_size == 1 || score_size == 2) {
+		size = profile_word_size(readLen, n, p->simd);
+		if (p->word_cap < size) {
+			free(p->profile_word);
+			p->profile_word = (__m128i*)ssw_malloc_aligned(size);
+			p->word_cap = size;
+		}
+		qP_word_fill(p->profile_word, read, mat, readLen, n, p->simd);
+	} else {
+		free(p->profile_word);
+		p->profile_word = 0;
+		p->word_cap = 0;
 	}
-	if (score_size == 1 || score_size == 2) p->profile_word = qP_word (read, mat, readLen, n);
 	p->read = read;
 	p->mat = mat;
 	p->readLen = readLen;
@@ -783,7 +1090,7 @@ s_align* ssw_align (const s_profile* prof,
 	int32_t word = 0, band_width = 0, readLen = prof->readLen;
 	int8_t* read_reverse = 0;
 	cigar* path;
-	s_align* r = (s_align*)calloc(1, sizeof(s_align));
+	s_align* r = (s_align*)ssw_calloc(1, sizeof(s_align));
 	r->ref_begin1 = -1;
 	r->read_begin1 = -1;
 	r->cigar = 0;
@@ -792,19 +1099,23 @@ s_align* ssw_align (const s_profile* prof,
 		fprintf(stderr, "When maskLen < 15, the function ssw_align doesn't return 2nd best alignment information.\n");
 	}
 
+	// Kernels matching the layout of the profile
+	sw_byte_fn sw_byte = sw_byte_kernels[prof->simd];
+	sw_word_fn sw_word = sw_word_kernels[prof->simd];
+
 	// Find the alignment scores and ending positions
 	if (prof->profile_byte) {
-		bests = sw_sse2_byte(ref, 0, refLen, readLen, weight_gapO, weight_gapE, prof->profile_byte, -1, prof->bias, maskLen);
+		bests = sw_byte(ref, 0, refLen, readLen, weight_gapO, weight_gapE, prof->profile_byte, -1, prof->bias, maskLen);
 		if (prof->profile_word && bests[0].score == 255) {
 			free(bests);
-			bests = sw_sse2_word(ref, 0, refLen, readLen, weight_gapO, weight_gapE, prof->profile_word, -1, maskLen);
+			bests = sw_word(ref, 0, refLen, readLen, weight_gapO, weight_gapE, prof->profile_word, -1, maskLen);
 			word = 1;
 		} else if (bests[0].score == 255) {
 			fprintf(stderr, "Please set 2 to the score_size parameter of the function ssw_init, otherwise the alignment results will be incorrect.\n");
 			return 0;
 		}
 	}else if (prof->profile_word) {
-		bests = sw_sse2_word(ref, 0, refLen, readLen, weight_gapO, weight_gapE, prof->profile_word, -1, maskLen);
+		bests = sw_word(ref, 0, refLen, readLen, weight_gapO, weight_gapE, prof->profile_word, -1, maskLen);
 		word = 1;
 	}else {
 		fprintf(stderr, "Please call the function ssw_init before ssw_align.\n");
@@ -826,11 +1137,11 @@ s_align* ssw_align (const s_profile* prof,
 	// Find the beginning position of the best alignment.
 	read_reverse = seq_reverse(prof->read, r->read_end1);
 	if (word == 0) {
-		vP = qP_byte(read_reverse, prof->mat, r->read_end1 + 1, prof->n, prof->bias);
-		bests_reverse = sw_sse2_byte(ref, 1, r->ref_end1 + 1, r->read_end1 + 1, weight_gapO, weight_gapE, vP, r->score1, prof->bias, maskLen);
+		vP = qP_byte(read_reverse, prof->mat, r->read_end1 + 1, prof->n, prof->bias, prof->simd);
+		bests_reverse = sw_byte(ref, 1, r->ref_end1 + 1, r->read_end1 + 1, weight_gapO, weight_gapE, vP, r->score1, prof->bias, maskLen);
 	} else {
-		vP = qP_word(read_reverse, prof->mat, r->read_end1 + 1, prof->n);
-		bests_reverse = sw_sse2_word(ref, 1, r->ref_end1 + 1, r->read_end1 + 1, weight_gapO, weight_gapE, vP, r->score1, maskLen);
+		vP = qP_word(read_reverse, prof->mat, r->read_end1 + 1, prof->n, prof->simd);
+		bests_reverse = sw_word(ref, 1, r->ref_end1 + 1, r->read_end1 + 1, weight_gapO, weight_gapE, vP, r->score1, maskLen);
 	}
 	free(vP);
 	free(read_reverse);
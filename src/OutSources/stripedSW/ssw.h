@@ -50,6 +50,37 @@ typedef struct {
 extern "C" {
 #endif	// __cplusplus
 
+/*!	@abstract	SIMD levels of the Smith-Waterman kernels: 16, 32 and 64 lanes of 8 bits (8, 16 and 32 lanes of 16 bits).
+*/
+#define SSW_SIMD_SSE2	0
+#define SSW_SIMD_AVX2	1
+#define SSW_SIMD_AVX512	2
+
+/*!	@function	Get the highest SIMD level supported by both the CPU and the build.
+	@return	SSW_SIMD_SSE2, SSW_SIMD_AVX2 or SSW_SIMD_AVX512
+*/
+int ssw_simd_supported (void);
+
+/*!	@function	Get the SIMD level used by the function ssw_init.
+	@note	By default the highest supported level up to SSW_SIMD_AVX2. The default is set once
+			and can be read from several threads; AVX-512 has to be asked for by ssw_set_simd_level.
+*/
+int ssw_simd_level (void);
+
+/*!	@function	Set the SIMD level used by the query profiles created afterwards.
+	@param	level	requested level; it is lowered to the highest supported level
+	@return	the level actually set
+	@note	A profile keeps the level it was created with, so ssw_align always runs the matching kernels.
+			Set the level before the threads start aligning.
+*/
+int ssw_set_simd_level (int level);
+
+/*!	@function	Get the number of heap allocations made by the SSW functions in the calling thread.
+	@note	The count includes the profiles, the alignment results and the scratch of the kernels.
+			Take the difference around the calls to measure them.
+*/
+int64_t ssw_num_allocs (void);
+
 /*!	@function	Create the query profile using the query sequence.
 	@param	read	pointer to the query sequence; the query sequence needs to be numbers
 	@param	readLen	length of the query sequence
@@ -70,6 +101,14 @@ extern "C" {
 */
 s_profile* ssw_init (const int8_t* read, const int32_t readLen, const int8_t* mat, const int32_t n, const int8_t score_size);
 
+/*!	@function	Rebuild a query profile in place for another query sequence.
+	@param	p	pointer to the query profile structure to be reused; a new one is created if it is 0
+	@param	read, readLen, mat, n, score_size	the same as the function ssw_init
+	@return	pointer to the query profile structure
+	@note	The profile buffers are only reallocated when they are too small for the new query.
+*/
+s_profile* ssw_reinit (s_profile* p, const int8_t* read, const int32_t readLen, const int8_t* mat, const int32_t n, const int8_t score_size);
+
 /*!	@function	Release the memory allocated by function ssw_init.
 	@param	p	pointer to the query profile structure	
 */
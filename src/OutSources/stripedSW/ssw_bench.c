@@ -0,0 +1,139 @@
+/*
+ *  ssw_bench.c
+ *
+ *	Micro-benchmark of the striped Smith-Waterman kernels.
+ *	Reads of 100bp are aligned against a random 6kb reference (the length
+ *	of a full L1 element) with every SIMD level supported by the CPU. The
+ *	speed of the forward pass is reported in giga cell updates per second
+ *	(GCUPS), and the alignments are checked against the SSE2 kernels.
+ *
+ *	Usage: ssw_bench [num_reads] [read_len] [ref_len]
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include "ssw.h"
+
+static const int8_t mat[] = { 2, -2, -2, -2, -2,
+							 -2,  2, -2, -2, -2,
+							 -2, -2,  2, -2, -2,
+							 -2, -2, -2,  2, -2,
+							 -2, -2, -2, -2, -2};
+
+static const char* level_names[] = {"sse2", "avx2", "avx512"};
+
+static double now (void) {
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+/* Half of the reads are sampled from the reference with 2% mismatches, the others are random. */
+static void make_reads (int8_t* reads, int32_t num_reads, int32_t read_len, const int8_t* ref, int32_t ref_len) {
+	int32_t i, j;
+	for (i = 0; i < num_reads; ++i) {
+		int8_t* read = reads + (size_t)i * read_len;
+		if (i % 2 == 0) {
+			int32_t pos = rand() % (ref_len - read_len);
+			for (j = 0; j < read_len; ++j)
+				read[j] = rand() % 50 == 0 ? (ref[pos + j] + 1) % 4 : ref[pos + j];
+		} else {
+			for (j = 0; j < read_len; ++j) read[j] = rand() % 4;
+		}
+	}
+}
+
+/* Align all the reads with one kernel; score_size 0 runs the byte kernel, 1 the word kernel. */
+static double run (s_align** results, const int8_t* reads, int32_t num_reads, int32_t read_len,
+				   const int8_t* ref, int32_t ref_len, int8_t score_size, uint8_t flag) {
+	int32_t i;
+	double start = now();
+	for (i = 0; i < num_reads; ++i) {
+		s_profile* p = ssw_init(reads + (size_t)i * read_len, read_len, mat, 5, score_size);
+		results[i] = ssw_align(p, ref, ref_len, 3, 1, flag, 0, 32767, read_len);
+		init_destroy(p);
+	}
+	return now() - start;
+}
+
+static int32_t compare (s_align** a, s_align** b, int32_t num_reads) {
+	int32_t i, diff = 0;
+	for (i = 0; i < num_reads; ++i) {
+		if (a[i]->score1 != b[i]->score1 || a[i]->ref_end1 != b[i]->ref_end1 || a[i]->read_end1 != b[i]->read_end1
+			|| a[i]->ref_begin1 != b[i]->ref_begin1 || a[i]->read_begin1 != b[i]->read_begin1)
+			++diff;
+	}
+	return diff;
+}
+
+static void clean (s_align** results, int32_t num_reads) {
+	int32_t i;
+	for (i = 0; i < num_reads; ++i) align_destroy(results[i]);
+}
+
+int main (int argc, char* argv[]) {
+	int32_t num_reads = argc > 1 ? atoi(argv[1]) : 20000;
+	int32_t read_len = argc > 2 ? atoi(argv[2]) : 100;
+	int32_t ref_len = argc > 3 ? atoi(argv[3]) : 6000;
+	int32_t i, level, kernel;
+
+	if (num_reads <= 0 || read_len <= 0 || ref_len <= read_len) {
+		fprintf(stderr, "Usage: ssw_bench [num_reads] [read_len] [ref_len]\n");
+		return 1;
+	}
+
+	int8_t* ref = (int8_t*) malloc(ref_len);
+	int8_t* reads = (int8_t*) malloc((size_t)num_reads * read_len);
+	s_align** base = (s_align**) calloc(num_reads, sizeof(s_align*));
+	s_align** results = (s_align**) calloc(num_reads, sizeof(s_align*));
+	if (ref == NULL || reads == NULL || base == NULL || results == NULL) {
+		fprintf(stderr, "ERROR: Not enough memory for the benchmark.\n");
+		return 1;
+	}
+
+	srand(11);
+	for (i = 0; i < ref_len; ++i) ref[i] = rand() % 4;
+	make_reads(reads, num_reads, read_len, ref, ref_len);
+
+	int supported = ssw_simd_supported();
+	double cells = (double)num_reads * read_len * ref_len;
+
+	printf("%d reads of %dbp against a %dbp reference\n", num_reads, read_len, ref_len);
+	printf("kernel\tlevel\tseconds\tGCUPS\tmismatches\n");
+
+	for (kernel = 0; kernel != 2; ++kernel) {
+		/* the byte kernel overflows when a read can score 255 or more */
+		if (kernel == 0 && read_len * mat[0] >= 255) continue;
+		for (level = SSW_SIMD_SSE2; level <= supported; ++level) {
+			ssw_set_simd_level(level);
+
+			/* the forward pass only, which is where the time goes */
+			double seconds = run(results, reads, num_reads, read_len, ref, ref_len, kernel, 0);
+			clean(results, num_reads);
+
+			/* the full alignments are compared with the SSE2 kernels */
+			run(results, reads, num_reads, read_len, ref, ref_len, kernel, 0x0f);
+			int32_t diff = 0;
+			if (level == SSW_SIMD_SSE2) {
+				s_align** t = base;
+				base = results;
+				results = t;
+			} else {
+				diff = compare(base, results, num_reads);
+				clean(results, num_reads);
+			}
+
+			printf("%s\t%s\t%.3f\t%.2f\t%d\n", kernel == 0 ? "byte" : "word", level_names[level], seconds, cells / seconds * 1e-9, diff);
+		}
+		clean(base, num_reads);
+	}
+
+	free(ref);
+	free(reads);
+	free(base);
+	free(results);
+	return 0;
+}
@@ -385,9 +385,60 @@ bool Aligner::Align(const char* query, const char* ref, const int& ref_len,
   s_profile* profile = ssw_init(translated_query, query_len, score_matrix_, 
                                 score_matrix_size_, score_size);
 
+  AlignProfile(profile, translated_query, query_len, translated_ref, valid_ref_len, filter, alignment);
+
+  // Free memory
+  delete [] translated_query;
+  delete [] translated_ref;
+  init_destroy(profile);
+
+  return true;
+}
+
+bool Aligner::Align(const char* query, const char* ref, const int& ref_len,
+                    const Filter& filter, Alignment* alignment,
+                    AlignmentBuffer* buffer) const
+{
+  if (!matrix_built_) return false;
+  
+  int query_len = strlen(query);
+  if (query_len == 0) return false;
+  if (query_len > buffer->query_capacity) {
+    delete [] buffer->translated_query;
+    buffer->query_capacity = query_len * 2;
+    buffer->translated_query = new int8_t[buffer->query_capacity];
+    ++buffer->num_allocs;
+  }
+  TranslateBase(query, query_len, buffer->translated_query);
+
+  if (ref_len > buffer->ref_capacity) {
+    delete [] buffer->translated_ref;
+    buffer->ref_capacity = ref_len * 2;
+    buffer->translated_ref = new int8_t[buffer->ref_capacity];
+    ++buffer->num_allocs;
+  }
+  TranslateBase(ref, ref_len, buffer->translated_ref);
+
+  // the profile is only made again for a longer query,
+  // the alignment itself still allocates its result and the kernel scratch
+  int64_t ssw_allocs = ssw_num_allocs();
+  const int8_t score_size = 2;
+  buffer->profile = ssw_reinit(buffer->profile, buffer->translated_query, query_len,
+                               score_matrix_, score_matrix_size_, score_size);
+
+  AlignProfile(buffer->profile, buffer->translated_query, query_len, buffer->translated_ref, ref_len, filter, alignment);
+  buffer->num_ssw_allocs += ssw_num_allocs() - ssw_allocs;
+
+  return true;
+}
+
+void Aligner::AlignProfile(const s_profile* profile, const int8_t* translated_query,
+                           const int& query_len, const int8_t* translated_ref,
+                           const int& ref_len, const Filter& filter, Alignment* alignment) const
+{
   uint8_t flag = 0;
   SetFlag(filter, &flag);
-  s_align* s_al = ssw_align(profile, translated_ref, valid_ref_len,
+  s_align* s_al = ssw_align(profile, translated_ref, ref_len,
                                  static_cast<int>(gap_opening_penalty_), 
 				 static_cast<int>(gap_extending_penalty_),
 				 flag, filter.score_filter, filter.distance_filter, query_len);
@@ -396,15 +447,24 @@ bool Aligner::Align(const char* query, const char* ref, const int& ref_len,
   ConvertAlignment(*s_al, query_len, alignment);
   alignment->mismatches = CalculateNumberMismatch(&*alignment, translated_ref, translated_query);
 
-  // Free memory
-  if (query_len > 1) delete [] translated_query;
-  else delete translated_query;
-  if (valid_ref_len > 1) delete [] translated_ref;
-  else delete translated_ref;
   align_destroy(s_al);
-  init_destroy(profile);
+}
 
-  return true;
+AlignmentBuffer::AlignmentBuffer(void)
+    : translated_query(NULL)
+    , query_capacity(0)
+    , translated_ref(NULL)
+    , ref_capacity(0)
+    , profile(NULL)
+    , num_allocs(0)
+    , num_ssw_allocs(0)
+{
+}
+
+AlignmentBuffer::~AlignmentBuffer(void) {
+  delete [] translated_query;
+  delete [] translated_ref;
+  if (profile) init_destroy(profile);
 }
 
 void Aligner::Clear(void) {
@@ -5,6 +5,8 @@
 #include <string>
 #include <vector>
 
+struct _profile;
+
 namespace StripedSmithWaterman {
 
 struct Alignment {
@@ -66,6 +68,28 @@ struct Filter {
     {};
 };
 
+// The buffers of Aligner::Align kept by the caller, so aligning many
+// queries reuses the translated sequences and the query profile.
+// num_allocs counts the heap allocations made for the translated sequences,
+// num_ssw_allocs the ones made inside SSW: the profile, the alignment
+// results and the scratch of the kernels, which still happen for every query.
+struct AlignmentBuffer {
+  int8_t* translated_query;
+  int     query_capacity;
+  int8_t* translated_ref;
+  int     ref_capacity;
+  struct _profile* profile;  // rebuilt by ssw_reinit for every query
+  int64_t num_allocs;
+  int64_t num_ssw_allocs;
+
+  AlignmentBuffer(void);
+  ~AlignmentBuffer(void);
+
+ private:
+  AlignmentBuffer& operator= (const AlignmentBuffer&);
+  AlignmentBuffer (const AlignmentBuffer&);
+};
+
 class Aligner {
  public:
   // =========
@@ -146,6 +170,14 @@ class Aligner {
   bool Align(const char* query, const char* ref, const int& ref_len, 
              const Filter& filter, Alignment* alignment) const;
 
+  // =========
+  // @function The same as above but the translated sequences and the
+  //             query profile are kept in buffer for the next call.
+  // =========
+  bool Align(const char* query, const char* ref, const int& ref_len, 
+             const Filter& filter, Alignment* alignment,
+             AlignmentBuffer* buffer) const;
+
   // @function Clear up all containers and thus the aligner is disabled.
   //             To rebuild the aligner please use Build functions.
   void Clear(void);
@@ -195,6 +227,9 @@ class Aligner {
   int32_t reference_length_;
 
   int TranslateBase(const char* bases, const int& length, int8_t* translated) const;
+  void AlignProfile(const struct _profile* profile, const int8_t* translated_query,
+                    const int& query_len, const int8_t* translated_ref,
+                    const int& ref_len, const Filter& filter, Alignment* alignment) const;
   void SetAllDefault(void);
   void BuildDefaultMatrix(void);
   
@@ -0,0 +1,367 @@
+/*
+ *  ssw_kernel.h
+ *
+ *	Striped Smith-Waterman kernels for the wide vector registers.
+ *	This file is included by ssw.c once for each instruction set; the
+ *	includer defines the vector type and the vector operations below.
+ *	The kernels are the same as sw_sse2_byte and sw_sse2_word, only the
+ *	number of lanes in a register differs.
+ *
+ *	SSW_VEC				vector type
+ *	SSW_SUFFIX			suffix of the function names
+ *	SSW_TARGET			function attribute enabling the instruction set
+ *	SSW_BYTES			size of a vector in bytes
+ *	V_ZERO()			all zero vector
+ *	V_SET1_8/16(x)		broadcast a byte/word
+ *	V_LOAD(p), V_STORE(p, v)
+ *	V_ADDS_U8, V_SUBS_U8, V_MAX_U8, V_ADDS_I16, V_SUBS_U16, V_MAX_I16
+ *	V_SHIFT(v, n)		shift the whole vector left by n bytes
+ *	V_EQ_U8/16(a, b)	true if all the bytes/words are equal
+ *	V_GT_ANY_I16(a, b)	true if any word of a is greater than b
+ *	V_HMAX_U8/I16(v)	largest byte/word of the vector
+ */
+
+#define SSW_NAME3(x, s) x##_##s
+#define SSW_NAME2(x, s) SSW_NAME3(x, s)
+#define SSW_NAME(x) SSW_NAME2(x, SSW_SUFFIX)
+
+SSW_TARGET
+alignment_end* SSW_NAME(sw_byte) (const int8_t* ref,
+							 int8_t ref_dir,	// 0: forward ref; 1: reverse ref
+							 int32_t refLen,
+							 int32_t readLen,
+							 const uint8_t weight_gapO, /* will be used as - */
+							 const uint8_t weight_gapE, /* will be used as - */
+							 __m128i* profile,
+							 uint8_t terminate,	/* the best alignment score: used to terminate
+												   the matrix calculation when locating the
+												   alignment beginning point. If this score
+												   is set to 0, it will not be used */
+	 						 uint8_t bias,  /* Shift 0 point to a positive value. */
+							 int32_t maskLen) {
+
+	const int32_t lanes = SSW_BYTES;
+	uint8_t max = 0;		                     /* the max alignment score */
+	int32_t end_read = readLen - 1;
+	int32_t end_ref = -1; /* 0_based best alignment ending point; Initialized as isn't aligned -1. */
+	int32_t segLen = (readLen + lanes - 1) / lanes; /* number of segment */
+	SSW_VEC* vProfile = (SSW_VEC*) profile;
+
+	/* array to record the largest score of each reference position */
+	uint8_t* maxColumn = (uint8_t*) ssw_calloc(refLen, 1);
+
+	SSW_VEC vZero = V_ZERO();
+
+	SSW_VEC* pvHStore = (SSW_VEC*) ssw_calloc_aligned(segLen, sizeof(SSW_VEC));
+	SSW_VEC* pvHLoad = (SSW_VEC*) ssw_calloc_aligned(segLen, sizeof(SSW_VEC));
+	SSW_VEC* pvE = (SSW_VEC*) ssw_calloc_aligned(segLen, sizeof(SSW_VEC));
+	SSW_VEC* pvHmax = (SSW_VEC*) ssw_calloc_aligned(segLen, sizeof(SSW_VEC));
+
+	int32_t i, j;
+	SSW_VEC vGapO = V_SET1_8(weight_gapO);
+	SSW_VEC vGapE = V_SET1_8(weight_gapE);
+	SSW_VEC vBias = V_SET1_8(bias);
+
+	SSW_VEC vMaxScore = vZero; /* Trace the highest score of the whole SW matrix. */
+	SSW_VEC vMaxMark = vZero; /* Trace the highest score till the previous column. */
+	SSW_VEC vTemp;
+	int32_t edge, begin = 0, end = refLen, step = 1;
+
+	/* outer loop to process the reference sequence */
+	if (ref_dir == 1) {
+		begin = refLen - 1;
+		end = -1;
+		step = -1;
+	}
+	for (i = begin; LIKELY(i != end); i += step) {
+		SSW_VEC e = vZero, vF = vZero, vMaxColumn = vZero;
+
+		SSW_VEC vH = pvHStore[segLen - 1];
+		vH = V_SHIFT(vH, 1);
+		SSW_VEC* vP = vProfile + ref[i] * segLen; /* Right part of the vProfile */
+
+		/* Swap the 2 H buffers. */
+		SSW_VEC* pv = pvHLoad;
+		pvHLoad = pvHStore;
+		pvHStore = pv;
+
+		/* inner loop to process the query sequence */
+		for (j = 0; LIKELY(j < segLen); ++j) {
+			vH = V_ADDS_U8(vH, V_LOAD(vP + j));
+			vH = V_SUBS_U8(vH, vBias); /* vH will be always > 0 */
+
+			/* Get max from vH, vE and vF. */
+			e = V_LOAD(pvE + j);
+			vH = V_MAX_U8(vH, e);
+			vH = V_MAX_U8(vH, vF);
+			vMaxColumn = V_MAX_U8(vMaxColumn, vH);
+
+			/* Save vH values. */
+			V_STORE(pvHStore + j, vH);
+
+			/* Update vE value. */
+			vH = V_SUBS_U8(vH, vGapO); /* saturation arithmetic, result >= 0 */
+			e = V_SUBS_U8(e, vGapE);
+			e = V_MAX_U8(e, vH);
+			V_STORE(pvE + j, e);
+
+			/* Update vF value. */
+			vF = V_SUBS_U8(vF, vGapE);
+			vF = V_MAX_U8(vF, vH);
+
+			/* Load the next vH. */
+			vH = V_LOAD(pvHLoad + j);
+		}
+
+		/* Lazy_F loop: disallow adjecent insertion and then deletion, so don't update E(i, j) */
+        j = 0;
+        vH = V_LOAD(pvHStore + j);
+        vF = V_SHIFT(vF, 1);
+        vTemp = V_SUBS_U8(vH, vGapO);
+		vTemp = V_SUBS_U8(vF, vTemp);
+
+        while (!V_EQ_U8(vTemp, vZero))
+        {
+            vH = V_MAX_U8(vH, vF);
+			vMaxColumn = V_MAX_U8(vMaxColumn, vH);
+            V_STORE(pvHStore + j, vH);
+            vF = V_SUBS_U8(vF, vGapE);
+            j++;
+            if (j >= segLen)
+            {
+                j = 0;
+                vF = V_SHIFT(vF, 1);
+            }
+            vH = V_LOAD(pvHStore + j);
+
+            vTemp = V_SUBS_U8(vH, vGapO);
+            vTemp = V_SUBS_U8(vF, vTemp);
+        }
+
+		vMaxScore = V_MAX_U8(vMaxScore, vMaxColumn);
+		if (!V_EQ_U8(vMaxMark, vMaxScore)) {
+			uint8_t temp = V_HMAX_U8(vMaxScore);
+			vMaxMark = vMaxScore;
+
+			if (LIKELY(temp > max)) {
+				max = temp;
+				if (max + bias >= 255) break;	//overflow
+				end_ref = i;
+
+				/* Store the column with the highest alignment score in order to trace the alignment ending position on read. */
+				for (j = 0; LIKELY(j < segLen); ++j) pvHmax[j] = pvHStore[j];
+			}
+		}
+
+		/* Record the max score of current column. */
+		maxColumn[i] = V_HMAX_U8(vMaxColumn);
+		if (maxColumn[i] == terminate) break;
+	}
+
+	/* Trace the alignment ending position on read. */
+	uint8_t *t = (uint8_t*)pvHmax;
+	int32_t column_len = segLen * lanes;
+	for (i = 0; LIKELY(i < column_len); ++i, ++t) {
+		int32_t temp;
+		if (*t == max) {
+			temp = i / lanes + i % lanes * segLen;
+			if (temp < end_read) end_read = temp;
+		}
+	}
+
+	free(pvHmax);
+	free(pvE);
+	free(pvHLoad);
+	free(pvHStore);
+
+	/* Find the most possible 2nd best alignment. */
+	alignment_end* bests = (alignment_end*) ssw_calloc(2, sizeof(alignment_end));
+	bests[0].score = max + bias >= 255 ? 255 : max;
+	bests[0].ref = end_ref;
+	bests[0].read = end_read;
+
+	bests[1].score = 0;
+	bests[1].ref = 0;
+	bests[1].read = 0;
+
+	edge = (end_ref - maskLen) > 0 ? (end_ref - maskLen) : 0;
+	for (i = 0; i < edge; i ++) {
+		if (maxColumn[i] > bests[1].score) {
+			bests[1].score = maxColumn[i];
+			bests[1].ref = i;
+		}
+	}
+	edge = (end_ref + maskLen) > refLen ? refLen : (end_ref + maskLen);
+	for (i = edge + 1; i < refLen; i ++) {
+		if (maxColumn[i] > bests[1].score) {
+			bests[1].score = maxColumn[i];
+			bests[1].ref = i;
+		}
+	}
+
+	free(maxColumn);
+	return bests;
+}
+
+SSW_TARGET
+alignment_end* SSW_NAME(sw_word) (const int8_t* ref,
+							 int8_t ref_dir,	// 0: forward ref; 1: reverse ref
+							 int32_t refLen,
+							 int32_t readLen,
+							 const uint8_t weight_gapO, /* will be used as - */
+							 const uint8_t weight_gapE, /* will be used as - */
+						     __m128i* profile,
+							 uint16_t terminate,
+							 int32_t maskLen) {
+
+	const int32_t lanes = SSW_BYTES / 2;
+	uint16_t max = 0;		                     /* the max alignment score */
+	int32_t end_read = readLen - 1;
+	int32_t end_ref = 0; /* 1_based best alignment ending point; Initialized as isn't aligned - 0. */
+	int32_t segLen = (readLen + lanes - 1) / lanes; /* number of segment */
+	SSW_VEC* vProfile = (SSW_VEC*) profile;
+
+	/* array to record the largest score of each reference position */
+	uint16_t* maxColumn = (uint16_t*) ssw_calloc(refLen, 2);
+
+	SSW_VEC vZero = V_ZERO();
+
+	SSW_VEC* pvHStore = (SSW_VEC*) ssw_calloc_aligned(segLen, sizeof(SSW_VEC));
+	SSW_VEC* pvHLoad = (SSW_VEC*) ssw_calloc_aligned(segLen, sizeof(SSW_VEC));
+	SSW_VEC* pvE = (SSW_VEC*) ssw_calloc_aligned(segLen, sizeof(SSW_VEC));
+	SSW_VEC* pvHmax = (SSW_VEC*) ssw_calloc_aligned(segLen, sizeof(SSW_VEC));
+
+	int32_t i, j, k;
+	SSW_VEC vGapO = V_SET1_16(weight_gapO);
+	SSW_VEC vGapE = V_SET1_16(weight_gapE);
+
+	SSW_VEC vMaxScore = vZero; /* Trace the highest score of the whole SW matrix. */
+	SSW_VEC vMaxMark = vZero; /* Trace the highest score till the previous column. */
+	int32_t edge, begin = 0, end = refLen, step = 1;
+
+	/* outer loop to process the reference sequence */
+	if (ref_dir == 1) {
+		begin = refLen - 1;
+		end = -1;
+		step = -1;
+	}
+	for (i = begin; LIKELY(i != end); i += step) {
+		SSW_VEC e = vZero, vF = vZero;
+		SSW_VEC vH = pvHStore[segLen - 1];
+		vH = V_SHIFT(vH, 2);
+
+		/* Swap the 2 H buffers. */
+		SSW_VEC* pv = pvHLoad;
+
+		SSW_VEC vMaxColumn = vZero; /* vMaxColumn is used to record the max values of column i. */
+
+		SSW_VEC* vP = vProfile + ref[i] * segLen; /* Right part of the vProfile */
+		pvHLoad = pvHStore;
+		pvHStore = pv;
+
+		/* inner loop to process the query sequence */
+		for (j = 0; LIKELY(j < segLen); j ++) {
+			vH = V_ADDS_I16(vH, V_LOAD(vP + j));
+
+			/* Get max from vH, vE and vF. */
+			e = V_LOAD(pvE + j);
+			vH = V_MAX_I16(vH, e);
+			vH = V_MAX_I16(vH, vF);
+			vMaxColumn = V_MAX_I16(vMaxColumn, vH);
+
+			/* Save vH values. */
+			V_STORE(pvHStore + j, vH);
+
+			/* Update vE value. */
+			vH = V_SUBS_U16(vH, vGapO); /* saturation arithmetic, result >= 0 */
+			e = V_SUBS_U16(e, vGapE);
+			e = V_MAX_I16(e, vH);
+			V_STORE(pvE + j, e);
+
+			/* Update vF value. */
+			vF = V_SUBS_U16(vF, vGapE);
+			vF = V_MAX_I16(vF, vH);
+
+			/* Load the next vH. */
+			vH = V_LOAD(pvHLoad + j);
+		}
+
+		/* Lazy_F loop: disallow adjecent insertion and then deletion, so don't update E(i, j) */
+		for (k = 0; LIKELY(k < lanes); ++k) {
+			vF = V_SHIFT(vF, 2);
+			for (j = 0; LIKELY(j < segLen); ++j) {
+				vH = V_LOAD(pvHStore + j);
+				vH = V_MAX_I16(vH, vF);
+				V_STORE(pvHStore + j, vH);
+				vH = V_SUBS_U16(vH, vGapO);
+				vF = V_SUBS_U16(vF, vGapE);
+				if (UNLIKELY(! V_GT_ANY_I16(vF, vH))) goto end;
+			}
+		}
+
+end:
+		vMaxScore = V_MAX_I16(vMaxScore, vMaxColumn);
+		if (!V_EQ_16(vMaxMark, vMaxScore)) {
+			uint16_t temp = V_HMAX_I16(vMaxScore);
+			vMaxMark = vMaxScore;
+
+			if (LIKELY(temp > max)) {
+				max = temp;
+				end_ref = i;
+				for (j = 0; LIKELY(j < segLen); ++j) pvHmax[j] = pvHStore[j];
+			}
+		}
+
+		/* Record the max score of current column. */
+		maxColumn[i] = V_HMAX_I16(vMaxColumn);
+		if (maxColumn[i] == terminate) break;
+	}
+
+	/* Trace the alignment ending position on read. */
+	uint16_t *t = (uint16_t*)pvHmax;
+	int32_t column_len = segLen * lanes;
+	for (i = 0; LIKELY(i < column_len); ++i, ++t) {
+		int32_t temp;
+		if (*t == max) {
+			temp = i / lanes + i % lanes * segLen;
+			if (temp < end_read) end_read = temp;
+		}
+	}
+
+	free(pvHmax);
+	free(pvE);
+	free(pvHLoad);
+	free(pvHStore);
+
+	/* Find the most possible 2nd best alignment. */
+	alignment_end* bests = (alignment_end*) ssw_calloc(2, sizeof(alignment_end));
+	bests[0].score = max;
+	bests[0].ref = end_ref;
+	bests[0].read = end_read;
+
+	bests[1].score = 0;
+	bests[1].ref = 0;
+	bests[1].read = 0;
+
+	edge = (end_ref - maskLen) > 0 ? (end_ref - maskLen) : 0;
+	for (i = 0; i < edge; i ++) {
+		if (maxColumn[i] > bests[1].score) {
+			bests[1].score = maxColumn[i];
+			bests[1].ref = i;
+		}
+	}
+	edge = (end_ref + maskLen) > refLen ? refLen : (end_ref + maskLen);
+	for (i = edge; i < refLen; i ++) {
+		if (maxColumn[i] > bests[1].score) {
+			bests[1].score = maxColumn[i];
+			bests[1].ref = i;
+		}
+	}
+
+	free(maxColumn);
+	return bests;
+}
+
+#undef SSW_NAME
+#undef SSW_NAME2
+#undef SSW_NAME3
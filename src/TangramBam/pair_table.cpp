@@ -0,0 +1,158 @@
+#include "pair_table.h"
+
+#include <algorithm>
+
+using std::string;
+using std::vector;
+
+namespace {
+bool OperatorName(const Alignment* a1, const Alignment* a2) {
+  return a1->bam_alignment.Name < a2->bam_alignment.Name;
+}
+} // namespace
+
+PairTable::PairTable(void)
+    : slots_()
+    , blocks_()
+    , free_records_()
+    , size_(0)
+    , peak_size_(0)
+    , num_records_(0)
+{}
+
+PairTable::~PairTable(void) {
+  for (unsigned int i = 0; i < blocks_.size(); ++i)
+    delete [] blocks_[i];
+}
+
+// FNV-1a
+uint32_t PairTable::Hash(const string& name) {
+  uint32_t hash = 2166136261U;
+  for (string::const_iterator ite = name.begin(); ite != name.end(); ++ite) {
+    hash ^= static_cast<unsigned char>(*ite);
+    hash *= 16777619U;
+  }
+
+  return hash;
+}
+
+uint32_t PairTable::NewRecord(void) {
+  if (!free_records_.empty()) {
+    const uint32_t record = free_records_.back();
+    free_records_.pop_back();
+    return record;
+  }
+
+  if ((num_records_ & (kBlockSize - 1)) == 0)
+    blocks_.push_back(new Alignment[kBlockSize]);
+
+  return num_records_++;
+}
+
+void PairTable::Place(const Slot& slot) {
+  const uint32_t mask = slots_.size() - 1;
+  uint32_t i = slot.hash & mask;
+  while (slots_[i].record != kEmpty) i = (i + 1) & mask;
+  slots_[i] = slot;
+}
+
+void PairTable::Rehash(const unsigned int& num_slots) {
+  vector<Slot> old_slots(num_slots);
+  old_slots.swap(slots_);
+  for (unsigned int i = 0; i < slots_.size(); ++i) slots_[i].record = kEmpty;
+
+  for (unsigned int i = 0; i < old_slots.size(); ++i) {
+    if (old_slots[i].record != kEmpty) Place(old_slots[i]);
+  }
+}
+
+int PairTable::Find(const string& name) const {
+  if (size_ == 0) return -1;
+
+  const uint32_t hash = Hash(name);
+  const uint32_t mask = slots_.size() - 1;
+  for (uint32_t i = hash & mask; slots_[i].record != kEmpty; i = (i + 1) & mask) {
+    if ((slots_[i].hash == hash) && (GetRecord(slots_[i].record)->bam_alignment.Name == name))
+      return i;
+  }
+
+  return -1;
+}
+
+void PairTable::Insert(Alignment* al) {
+  const int found = Find(al->bam_alignment.Name);
+  if (found != -1) {
+    Get(found)->Swap(al);
+    return;
+  }
+
+  // keep the load factor under 0.5
+  if (static_cast<unsigned int>(size_ + 1) * 2 > slots_.size())
+    Rehash(slots_.empty() ? kInitialSlots : slots_.size() * 2);
+
+  Slot slot;
+  slot.hash   = Hash(al->bam_alignment.Name);
+  slot.record = NewRecord();
+  GetRecord(slot.record)->Swap(al);
+  Place(slot);
+
+  ++size_;
+  if (size_ > peak_size_) peak_size_ = size_;
+}
+
+// Backward-shift deletion, so no tombstones are left in the probe sequences.
+void PairTable::Erase(const int& slot) {
+  const uint32_t mask = slots_.size() - 1;
+  uint32_t hole = slot;
+  free_records_.push_back(slots_[hole].record);
+  slots_[hole].record = kEmpty;
+  --size_;
+
+  for (uint32_t i = (hole + 1) & mask; slots_[i].record != kEmpty; i = (i + 1) & mask) {
+    const uint32_t home = slots_[i].hash & mask;
+    // the entry stays if its home lies cyclically in (hole, i]
+    const bool stay = (hole <= i) ? ((home > hole) && (home <= i))
+                                  : ((home > hole) || (home <= i));
+    if (!stay) {
+      slots_[hole] = slots_[i];
+      slots_[i].record = kEmpty;
+      hole = i;
+    }
+  }
+}
+
+void PairTable::Clear(void) {
+  for (unsigned int i = 0; i < slots_.size(); ++i) {
+    if (slots_[i].record != kEmpty) {
+      free_records_.push_back(slots_[i].record);
+      slots_[i].record = kEmpty;
+    }
+  }
+  size_ = 0;
+}
+
+void PairTable::GetSorted(vector<Alignment*>* sorted) {
+  sorted->clear();
+  sorted->reserve(size_);
+  for (unsigned int i = 0; i < slots_.size(); ++i) {
+    if (slots_[i].record != kEmpty) sorted->push_back(GetRecord(slots_[i].record));
+  }
+
+  sort(sorted->begin(), sorted->end(), OperatorName);
+}
+
+size_t PairTable::GetMemoryUsage(void) const {
+  size_t bytes = slots_.capacity() * sizeof(Slot)
+               + blocks_.size() * kBlockSize * sizeof(Alignment)
+               + free_records_.capacity() * sizeof(uint32_t);
+
+  for (int i = 0; i < num_records_; ++i) {
+    const Alignment* al = GetRecord(i);
+    const BamTools::BamAlignment& bam = al->bam_alignment;
+    bytes += bam.Name.capacity() + bam.QueryBases.capacity() + bam.AlignedBases.capacity()
+           + bam.Qualities.capacity() + bam.TagData.capacity() + bam.Filename.capacity()
+           + bam.CigarData.capacity() * sizeof(BamTools::CigarOp) + al->ins_prefix.capacity();
+  }
+
+  return bytes;
+}
@@ -0,0 +1,104 @@
+#ifndef TANGRAMBAM_PAIR_TABLE_H_
+#define TANGRAMBAM_PAIR_TABLE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#include "tangram_bam.h"
+
+// An open-addressed hash table keyed by read name that buffers alignments
+// until their mates show up.
+//
+// The buffered records live in an arena owned by the table and are recycled
+// through a free list. An alignment is moved in by swapping its buffers with
+// a recycled record, so once the arena is warm neither inserting nor erasing
+// copies or allocates read data.
+class PairTable {
+ public:
+  PairTable(void);
+  ~PairTable(void);
+
+  // @function: Moving an alignment into the table.
+  //            An alignment with the same name is replaced.
+  //            After the call, al holds the buffers of a recycled record.
+  void Insert(Alignment* al);
+
+  // @function: Finding the alignment with the given name.
+  // @return:   The slot of the alignment; -1 if it is not found.
+  int Find(const std::string& name) const;
+
+  Alignment* Get(const int& slot) {return GetRecord(slots_[slot].record);};
+
+  // @function: Removing the alignment in the slot and recycling its record.
+  void Erase(const int& slot);
+
+  // @function: Removing all alignments. The records are kept for reuse.
+  void Clear(void);
+
+  // @function: Removing all alignments that pred returns true for.
+  // @return:   The number of removed alignments.
+  template<typename Predicate>
+  int EraseIf(Predicate pred);
+
+  // @function: Collecting the stored alignments sorted by read names.
+  void GetSorted(std::vector<Alignment*>* sorted);
+
+  // Memory-usage counters
+  int GetSize(void) const {return size_;};
+  int GetPeakSize(void) const {return peak_size_;};
+  int GetNumRecords(void) const {return num_records_;}; // records held by the arena
+  size_t GetMemoryUsage(void) const; // bytes of slots, records and their buffers
+
+ private:
+  struct Slot {
+    uint32_t hash;
+    uint32_t record;
+  };
+
+  static const uint32_t kEmpty = 0xffffffff;
+  static const int kBlockBits = 10;
+  static const int kBlockSize = 1 << kBlockBits;
+  static const int kInitialSlots = 64;
+
+  std::vector<Slot> slots_;
+  std::vector<Alignment*> blocks_;     // the arena; kBlockSize records per block
+  std::vector<uint32_t> free_records_;
+  int size_;
+  int peak_size_;
+  int num_records_;
+
+  Alignment* GetRecord(const uint32_t& record) const {
+    return blocks_[record >> kBlockBits] + (record & (kBlockSize - 1));
+  };
+  uint32_t NewRecord(void);
+  void Place(const Slot& slot);
+  void Rehash(const unsigned int& num_slots);
+  static uint32_t Hash(const std::string& name);
+
+  PairTable (const PairTable&);
+  PairTable& operator= (const PairTable&);
+};
+
+template<typename Predicate>
+int PairTable::EraseIf(Predicate pred) {
+  int erased = 0;
+  for (unsigned int i = 0; i < slots_.size(); ++i) {
+    if (slots_[i].record == kEmpty) continue;
+    if (pred(*GetRecord(slots_[i].record))) {
+      free_records_.push_back(slots_[i].record);
+      slots_[i].record = kEmpty;
+      ++erased;
+    }
+  }
+
+  if (erased > 0) {
+    size_ -= erased;
+    Rehash(slots_.size());
+  }
+
+  return erased;
+}
+
+#endif // TANGRAMBAM_PAIR_TABLE_H_
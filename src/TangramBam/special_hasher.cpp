@@ -3,6 +3,10 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 extern "C" {
 #include "SR_InHashTable.h"
@@ -10,8 +14,110 @@ extern "C" {
 #include "SR_Reference.h"
 #include "ConvertHashTableOutToIn.h"
 }
+#include "../OutSources/util/md5.h"
 
 using std::string;
+using std::vector;
+
+namespace {
+// An index file begins with IndexHeader that is followed by the payload
+//   uint32_t indices[num_hashes]
+//   uint32_t hash_pos[num_pos]
+//   uint32_t end_pos[num_special_refs]
+//   uint32_t ref_lens[num_names]
+//   char     names[names_len]   // '\0'-terminated names
+//   char     sequence[seq_len]
+// All uint32_t arrays come first so that they are aligned in the mapping.
+// The MD5 checksum of the payload is kept in the header.
+const char kIndexMagic[8] = {'T', 'G', 'M', 'S', 'P', 'I', 'D', 'X'};
+const uint32_t kIndexVersion = 1;
+
+struct IndexHeader {
+  char     magic[8];
+  uint32_t version;
+  uint32_t hash_size;
+  int32_t  id;
+  uint32_t num_hashes;
+  uint32_t num_pos;
+  uint32_t seq_len;
+  uint32_t num_seqs;
+  uint32_t num_special_refs;
+  uint32_t num_names;
+  uint32_t names_len;
+  uint64_t payload_len;
+  unsigned char md5[MD5_CHECKSUM_LEN];
+};
+
+inline uint64_t GetPayloadLength(const IndexHeader& header) {
+  return sizeof(uint32_t) * ((uint64_t) header.num_hashes + header.num_pos
+                             + header.num_special_refs + header.num_names)
+         + header.names_len + header.seq_len;
+}
+
+// MD5Update takes an unsigned length, so long buffers are fed in pieces.
+void UpdateMd5(MD5_CTX* context, const void* data, uint64_t len) {
+  const unsigned char* ptr = (const unsigned char*) data;
+  const uint64_t kPiece = 1 << 30;
+  while (len > 0) {
+    const unsigned piece = (len > kPiece) ? kPiece : len;
+    MD5Update(context, const_cast<unsigned char*>(ptr), piece);
+    ptr += piece;
+    len -= piece;
+  }
+}
+
+bool WritePayload(const void* data, const uint64_t& len, FILE* output, MD5_CTX* context) {
+  if (len == 0) return true;
+  UpdateMd5(context, data, len);
+  return fwrite(data, 1, len, output) == len;
+}
+
+// Check the header, the section lengths and the checksum of a mapped index.
+bool CheckIndex(const char* filename, const void* mapped, const size_t& mapped_len) {
+  const IndexHeader* header = (const IndexHeader*) mapped;
+  const char* payload = (const char*) mapped + sizeof(IndexHeader);
+  if (memcmp(header->magic, kIndexMagic, sizeof(kIndexMagic)) != 0) {
+    fprintf(stderr, "ERROR: The file (%s) is not a special reference index.\n", filename);
+    return false;
+  }
+  if (header->version != kIndexVersion) {
+    fprintf(stderr, "ERROR: The index (%s) is of version %u while version %u is required. Please rebuild it.\n",
+            filename, header->version, kIndexVersion);
+    return false;
+  }
+  if ((header->hash_size == 0) || (header->hash_size > 16)
+      || (header->num_hashes != ((uint32_t) 1 << (2 * header->hash_size)))
+      || (header->payload_len != GetPayloadLength(*header))
+      || (header->payload_len != mapped_len - sizeof(IndexHeader))) {
+    fprintf(stderr, "ERROR: The index (%s) is truncated or corrupted.\n", filename);
+    return false;
+  }
+
+  unsigned char md5[MD5_CHECKSUM_LEN];
+  MD5_CTX context;
+  MD5Init(&context);
+  UpdateMd5(&context, payload, header->payload_len);
+  MD5Final(md5, &context);
+  if (memcmp(md5, header->md5, MD5_CHECKSUM_LEN) != 0) {
+    fprintf(stderr, "ERROR: The checksum of the index (%s) mismatches.\n", filename);
+    return false;
+  }
+
+  // names are '\0'-terminated within their section
+  const char* names = payload + GetPayloadLength(*header) - header->seq_len - header->names_len;
+  uint32_t num_names = 0;
+  for (uint32_t i = 0; i < header->names_len; ++i) {
+    if (names[i] == '\0') ++num_names;
+  }
+  if ((num_names != header->num_names)
+      || ((header->names_len > 0) && (names[header->names_len - 1] != '\0'))) {
+    fprintf(stderr, "ERROR: The index (%s) is truncated or corrupted.\n", filename);
+    return false;
+  }
+
+  return true;
+}
+} // namespace
 
 SpecialHasher::SpecialHasher(void)
     : fasta_("")
@@ -20,7 +126,9 @@ SpecialHasher::SpecialHasher(void)
     , hash_table_(NULL)
     , hash_size_(7)
     , is_loaded_(false)
-    , ref_id_start_no_(0){
+    , ref_id_start_no_(0)
+    , mapped_(NULL)
+    , mapped_len_(0){
   Init();
 }
 
@@ -31,7 +139,9 @@ SpecialHasher::SpecialHasher(const char* fasta, const int& hash_size, const int&
     , hash_table_(NULL)
     , hash_size_(hash_size)
     , is_loaded_(false)
-    , ref_id_start_no_(ref_id_start_no){
+    , ref_id_start_no_(ref_id_start_no)
+    , mapped_(NULL)
+    , mapped_len_(0){
   Init();
 }
 
@@ -39,8 +149,15 @@ SpecialHasher::~SpecialHasher(void) {
   // SR_RefHeaderFree also frees memory 
   //   that is allocated by SR_SpecialRefInfoAlloc
   SR_RefHeaderFree(reference_header_);
-  SR_ReferenceFree(references_);
-  SR_InHashTableFree(hash_table_);
+  if (mapped_ == NULL) {
+    SR_ReferenceFree(references_);
+    SR_InHashTableFree(hash_table_);
+  } else {
+    // the sequence and hash arrays point into the mapping
+    free(references_);
+    free(hash_table_);
+    munmap(mapped_, mapped_len_);
+  }
 }
 
 void SpecialHasher::Init(void) {
@@ -86,3 +203,160 @@ bool SpecialHasher::Load(void) {
   is_loaded_ = true;
   return true;
 }
+
+bool SpecialHasher::WriteIndex(const char* filename,
+                               const vector<string>& ref_names,
+                               const vector<int>& ref_lens) const {
+  if (!is_loaded_) {
+    fprintf(stderr, "ERROR: Please load special references before writing the index.\n");
+    return false;
+  }
+
+  const SR_SpecialRefInfo* special_info = reference_header_->pSpecialRefInfo;
+  string names;
+  for (unsigned int i = 0; i < ref_names.size(); ++i) {
+    names += ref_names[i];
+    names += '\0';
+  }
+  vector<uint32_t> lens(ref_lens.begin(), ref_lens.end());
+
+  IndexHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kIndexMagic, sizeof(kIndexMagic));
+  header.version          = kIndexVersion;
+  header.hash_size        = hash_table_->hashSize;
+  header.id               = hash_table_->id;
+  header.num_hashes       = hash_table_->numHashes;
+  header.num_pos          = hash_table_->numPos;
+  header.seq_len          = references_->seqLen;
+  header.num_seqs         = reference_header_->numSeqs;
+  header.num_special_refs = special_info ? special_info->numRefs : 0;
+  header.num_names        = lens.size();
+  header.names_len        = names.size();
+  header.payload_len      = GetPayloadLength(header);
+
+  FILE* output = fopen(filename, "wb");
+  if (output == NULL) {
+    fprintf(stderr, "ERROR: The file (%s) cannot be opened.\n", filename);
+    return false;
+  }
+
+  // the header is rewritten once the checksum is known
+  bool ok = (fwrite(&header, sizeof(header), 1, output) == 1);
+  MD5_CTX context;
+  MD5Init(&context);
+  ok = ok && WritePayload(hash_table_->indices, sizeof(uint32_t) * header.num_hashes, output, &context);
+  ok = ok && WritePayload(hash_table_->hashPos, sizeof(uint32_t) * header.num_pos, output, &context);
+  if (special_info)
+    ok = ok && WritePayload(special_info->endPos, sizeof(uint32_t) * header.num_special_refs, output, &context);
+  if (!lens.empty())
+    ok = ok && WritePayload(&lens[0], sizeof(uint32_t) * header.num_names, output, &context);
+  ok = ok && WritePayload(names.data(), header.names_len, output, &context);
+  ok = ok && WritePayload(references_->sequence, header.seq_len, output, &context);
+  MD5Final(header.md5, &context);
+
+  ok = ok && (fseek(output, 0, SEEK_SET) == 0);
+  ok = ok && (fwrite(&header, sizeof(header), 1, output) == 1);
+  ok = (fclose(output) == 0) && ok;
+
+  if (!ok) fprintf(stderr, "ERROR: The index (%s) cannot be written.\n", filename);
+
+  return ok;
+}
+
+bool SpecialHasher::LoadIndex(const char* filename,
+                              vector<string>* ref_names,
+                              vector<int>* ref_lens) {
+  if (is_loaded_) {
+    fprintf(stderr, "ERROR: Special references are already loaded.\n");
+    return false;
+  }
+
+  const int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "ERROR: The file (%s) cannot be opened.\n", filename);
+    return false;
+  }
+
+  struct stat file_stat;
+  if ((fstat(fd, &file_stat) != 0) || (file_stat.st_size < (off_t) sizeof(IndexHeader))) {
+    fprintf(stderr, "ERROR: The file (%s) is not a special reference index.\n", filename);
+    close(fd);
+    return false;
+  }
+
+  void* mapped = mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    fprintf(stderr, "ERROR: The file (%s) cannot be mapped.\n", filename);
+    return false;
+  }
+  if (!CheckIndex(filename, mapped, file_stat.st_size)) {
+    munmap(mapped, file_stat.st_size);
+    return false;
+  }
+  mapped_     = mapped;
+  mapped_len_ = file_stat.st_size;
+
+  const IndexHeader* header = (const IndexHeader*) mapped_;
+  const char* payload = (const char*) mapped_ + sizeof(IndexHeader);
+  const uint32_t* indices  = (const uint32_t*) payload;
+  const uint32_t* hash_pos = indices + header->num_hashes;
+  const uint32_t* end_pos  = hash_pos + header->num_pos;
+  const uint32_t* lens     = end_pos + header->num_special_refs;
+  const char* names        = (const char*) (lens + header->num_names);
+  const char* sequence     = names + header->names_len;
+
+  // the hash table and the sequence are used in place
+  free(references_->sequence);
+  references_->sequence = const_cast<char*>(sequence);
+  references_->id       = header->id;
+  references_->seqLen   = header->seq_len;
+  references_->seqCap   = header->seq_len;
+
+  hash_table_ = (SR_InHashTable*) calloc(1, sizeof(SR_InHashTable));
+  if (hash_table_ == NULL) {
+    fprintf(stderr, "ERROR: Not enough memory for a reference hash table object.\n");
+    return false;
+  }
+  hash_table_->id          = header->id;
+  hash_table_->hashSize    = header->hash_size;
+  hash_table_->highEndMask = GET_HIGH_END_MASK(header->hash_size);
+  hash_table_->numHashes   = header->num_hashes;
+  hash_table_->numPos      = header->num_pos;
+  hash_table_->indices     = const_cast<uint32_t*>(indices);
+  hash_table_->hashPos     = const_cast<uint32_t*>(hash_pos);
+  hash_size_ = header->hash_size;
+
+  SR_SpecialRefInfo* special_info = reference_header_->pSpecialRefInfo;
+  if (header->num_special_refs == 0) {
+    SR_SpecialRefInfoFree(special_info);
+    reference_header_->pSpecialRefInfo = NULL;
+  } else {
+    if (header->num_special_refs > special_info->capacity) {
+      free(special_info->endPos);
+      special_info->capacity = header->num_special_refs;
+      special_info->endPos = (uint32_t*) malloc(sizeof(uint32_t) * special_info->capacity);
+      if (special_info->endPos == NULL) {
+        fprintf(stderr, "ERROR: Not enough memory for the storage of end indices of special references.\n");
+        return false;
+      }
+    }
+    memcpy(special_info->endPos, end_pos, sizeof(uint32_t) * header->num_special_refs);
+    special_info->numRefs = header->num_special_refs;
+    special_info->ref_id_start_no = ref_id_start_no_;
+  }
+  reference_header_->numSeqs = header->num_seqs;
+
+  ref_names->clear();
+  ref_lens->clear();
+  const char* name = names;
+  for (uint32_t i = 0; i < header->num_names; ++i) {
+    ref_names->push_back(name);
+    ref_lens->push_back(lens[i]);
+    name += ref_names->back().size() + 1;
+  }
+
+  is_loaded_ = true;
+  return true;
+}
@@ -1,7 +1,9 @@
 #ifndef UTILITIES_HASHTABLE_SPECIAL_HASHER_H_
 #define UTILITIES_HASHTABLE_SPECIAL_HASHER_H_
 
+#include <stddef.h>
 #include <string>
+#include <vector>
 extern "C" {
 #include "SR_InHashTable.h"
 #include "SR_Reference.h"
@@ -46,6 +48,27 @@ class SpecialHasher {
   //            and hashing them.
   bool Load(void);
 
+  // @function: Writing the loaded special references and their hash table
+  //            into an index file which can be mapped by LoadIndex().
+  //            Notice that Load() should be called first.
+  // @param:    filename: index filename
+  //            ref_names: names of special references kept in the index
+  //            ref_lens:  lengths of special references kept in the index
+  bool WriteIndex(const char* filename,
+                  const std::vector<std::string>& ref_names,
+                  const std::vector<int>& ref_lens) const;
+
+  // @function: Mapping an index file written by WriteIndex() read-only
+  //            instead of loading and hashing the fasta file.
+  //            The hash table and sequences are used in place, so processes
+  //            on the same node share one page-cached copy.
+  // @param:    filename: index filename
+  //            ref_names: names of special references kept in the index
+  //            ref_lens:  lengths of special references kept in the index
+  bool LoadIndex(const char* filename,
+                 std::vector<std::string>* ref_names,
+                 std::vector<int>* ref_lens);
+
   const SR_Reference* GetReference(void) const {return(is_loaded_ ? references_ : NULL);};
   const SR_RefHeader* GetReferenceHeader(void) const {return(is_loaded_ ? reference_header_ : NULL);};
   const SR_InHashTable* GetHashTable(void) const {return(is_loaded_ ? hash_table_ : NULL);};
@@ -58,6 +81,8 @@ class SpecialHasher {
   int hash_size_;
   bool is_loaded_;
   int ref_id_start_no_;
+  void* mapped_;      // the index mapped by LoadIndex()
+  size_t mapped_len_;
 
   void Init(void);
   SpecialHasher (const SpecialHasher&);
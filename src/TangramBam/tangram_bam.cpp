@@ -1,7 +1,9 @@
 #include "tangram_bam.h"
 #include <stdio.h>
+#include <string.h>
 #include <limits.h>
 #include <getopt.h>
+#include <pthread.h>
 
 extern "C" {
 #include "../OutSources/samtools/bam.h"
@@ -9,6 +11,7 @@ extern "C" {
 #include "SR_QueryRegion.h"
 }
 
+#include <algorithm>
 #include <vector>
 #include <string>
 #include <iostream>
@@ -19,6 +22,7 @@ extern "C" {
 #include "../OutSources/stripedSW/ssw_cpp.h"
 #include "special_hasher.h"
 #include "hashes_collection.h"
+#include "pair_table.h"
 
 using namespace std;
 
@@ -28,26 +32,40 @@ const StripedSmithWaterman::Filter kFilter(true, false, 0, 32467);
 const int kAlignmentMapSize = 10000;
 const float kSoftClipRate = 0.15; // the max ratio of allowed soft clips
 const int kRequestedBases = 20;
+const int kBatchSize = 20000; // the number of alignments annotated in a batch by -p
+const int kBatchChunk = 64;   // the number of alignments a worker grabs at a time
 int kRequiredMatch;
 }
 
 void ShowHelp() {
   fprintf(stderr, "\n");
-  fprintf(stderr, "Usage: tangram_bam [options] -i <in_bam> -r <ref_fa> -o <out_bam>\n\n");
+  fprintf(stderr, "Usage: tangram_bam [options] -i <in_bam> -r <ref_fa> -o <out_bam>\n");
+  fprintf(stderr, "       tangram_bam [options] -i <in_bam> -x <ref_index> -o <out_bam>\n");
+  fprintf(stderr, "       tangram_bam -r <ref_fa> -w <ref_index>\n\n");
 
   fprintf(stderr, "\nMandatory arguments:\n");
   fprintf(stderr, "                     -i --input FILE   The input of bam file [stdin].\n");
   fprintf(stderr, "                     -r --ref FILE     The input of special reference file.\n");
   fprintf(stderr, "                     -o --output FILE  The output of bam file [stdout].\n");
+  fprintf(stderr, "                     -x --index FILE   The special reference index built by -w.\n");
+  fprintf(stderr, "                                       It replaces -r.\n");
 
   fprintf(stderr, "\nOptions:\n");
   fprintf(stderr, "                     -h --help                    Print this help message.\n");
   fprintf(stderr, "                     -t --target-ref-name STRING  Chromosome region.\n");
   fprintf(stderr, "                     -m --required-match INT      The number of required matches.\n");
   fprintf(stderr, "                                                  between reads and special references [50].\n");
+  fprintf(stderr, "                     -p --threads INT             The number of threads for special reference\n");
+  fprintf(stderr, "                                                  searching [1].\n");
+  fprintf(stderr, "                     -w --write-index FILE        Build the index of special references given by\n");
+  fprintf(stderr, "                                                  -r into FILE and exit.\n");
+  fprintf(stderr, "                     -s --stats                   Print the heap allocations of the special\n");
+  fprintf(stderr, "                                                  reference searching to stderr, with the ones\n");
+  fprintf(stderr, "                                                  made inside SSW counted separately.\n");
 
   fprintf(stderr, "\nNotes:\n");
   fprintf(stderr, "       1. tangram_bam will add ZA tags that are required for the following detection.\n");
+  fprintf(stderr, "       2. The index by -w is mapped read-only, so jobs on the same node share one copy of it.\n");
 
 }
 
@@ -200,12 +218,15 @@ void WriteAlignment(
     writer->SaveAlignment(al->bam_alignment);
 }
 
-void WriteAlignment(map<string, Alignment>* al_map_ite, 
+void WriteAlignment(PairTable* al_map_ite, 
                     BamTools::BamWriter* writer) {
 		    
-  for (map<string, Alignment>::iterator ite = al_map_ite->begin();
-       ite != al_map_ite->end(); ++ite) {
-    Alignment* al = &(ite->second);
+  // write in the order of read names as the former std::map buffers did
+  vector<Alignment*> sorted;
+  al_map_ite->GetSorted(&sorted);
+  for (vector<Alignment*>::iterator ite = sorted.begin();
+       ite != sorted.end(); ++ite) {
+    Alignment* al = *ite;
     string za;
     if (al->bam_alignment.IsPaired()) { // paired-end read
       if (al->bam_alignment.IsFirstMate()) {
@@ -272,59 +293,63 @@ inline void MarkAsUnmapped (BamTools::BamAlignment* al, BamTools::BamAlignment*
   }
 }
 
+// Note that al is moved into the buffer if its mate is not found.
 void StoreAlignment(
     Alignment* al,
-    vector<map<string, Alignment> > *al_maps,
+    vector<PairTable> *al_maps,
     BamTools::BamWriter* writer) {
   int ref_id = al->bam_alignment.MateRefID;
-  map<string, Alignment>* al_map = &((*al_maps)[ref_id]);
-  map<string, Alignment>::iterator ite = al_map->find(al->bam_alignment.Name);
-  if (ite == al_map->end()) { // cannot find the mate in the map
+  PairTable* al_map = &((*al_maps)[ref_id]);
+  const int slot = al_map->Find(al->bam_alignment.Name);
+  if (slot == -1) { // cannot find the mate in the map
     WriteAlignment(al, writer);
   } else {
-    WriteAlignment(ite->second, al, writer);
-    al_map->erase(ite);
+    WriteAlignment(*(al_map->Get(slot)), al, writer);
+    al_map->Erase(slot);
   }
 }
 
+// Note that al is moved into the buffer if its mate is not found.
 void StoreAlignment(
     Alignment* al,
-    map<string, Alignment>*& al_map_cur,
-    map<string, Alignment>*& al_map_pre,
+    PairTable*& al_map_cur,
+    PairTable*& al_map_pre,
     BamTools::BamWriter* writer) {
   // Clear up the buffers once the al_map_cur buffer is full
   // 1. Clear up al_map_pre
   // 2. move al_map_cur to al_map_pre
-  if ((static_cast<int>(al_map_cur->size()) > kAlignmentMapSize)) {
+  if (al_map_cur->GetSize() > kAlignmentMapSize) {
     WriteAlignment(al_map_pre, writer);
-    al_map_pre->clear();
-    map<string, Alignment> *tmp = al_map_pre;
+    al_map_pre->Clear();
+    PairTable *tmp = al_map_pre;
     al_map_pre = al_map_cur;
     al_map_cur = tmp;
   }
 
-  map<string, Alignment>::iterator ite_cur = al_map_cur->find(al->bam_alignment.Name);
-  if (ite_cur == al_map_cur->end()) {
+  const int slot_cur = al_map_cur->Find(al->bam_alignment.Name);
+  if (slot_cur == -1) {
     if (al_map_pre != NULL) {
-      map<string, Alignment>::iterator ite_pre = al_map_pre->find(al->bam_alignment.Name);
-      if (ite_pre == al_map_pre->end()) { // al is not found in cur or pre either
-        (*al_map_cur)[al->bam_alignment.Name] = *al;
+      const int slot_pre = al_map_pre->Find(al->bam_alignment.Name);
+      if (slot_pre == -1) { // al is not found in cur or pre either
+        al_map_cur->Insert(al);
       } else { // find the mate in al_map_pre
-        if (al->bam_alignment.IsMapped() && ite_pre->second.bam_alignment.IsMapped())
-          MarkAsUnmapped(&(al->bam_alignment), &(ite_pre->second.bam_alignment));
-	WriteAlignment(ite_pre->second, al, writer);
-        WriteAlignment(*al, &(ite_pre->second), writer);
-        al_map_pre->erase(ite_pre);
+        Alignment* mate = al_map_pre->Get(slot_pre);
+        if (al->bam_alignment.IsMapped() && mate->bam_alignment.IsMapped())
+          MarkAsUnmapped(&(al->bam_alignment), &(mate->bam_alignment));
+	WriteAlignment(*mate, al, writer);
+        WriteAlignment(*al, mate, writer);
+        al_map_pre->Erase(slot_pre);
       }
     } else { // al is not found in cur and pre is NULL
-      (*al_map_cur)[al->bam_alignment.Name] = *al;
+      al_map_cur->Insert(al);
     }
   } else { // find the mate in al_map_cur
-    if (al->bam_alignment.IsMapped() && ite_cur->second.bam_alignment.IsMapped())
-      MarkAsUnmapped(&(al->bam_alignment), &(ite_cur->second.bam_alignment));
-    WriteAlignment(ite_cur->second, al, writer);
-    WriteAlignment(*al, &(ite_cur->second), writer);
-    al_map_cur->erase(ite_cur);
+    Alignment* mate = al_map_cur->Get(slot_cur);
+    if (al->bam_alignment.IsMapped() && mate->bam_alignment.IsMapped())
+      MarkAsUnmapped(&(al->bam_alignment), &(mate->bam_alignment));
+    WriteAlignment(*mate, al, writer);
+    WriteAlignment(*al, mate, writer);
+    al_map_cur->Erase(slot_cur);
   }
     
 }
@@ -342,7 +367,7 @@ bool ParseArguments(const int argc, char* const * argv, Param* param) {
     param->command_line += argv[i];
   }
 
-  const char *short_option = "hi:o:r:t:";
+  const char *short_option = "hi:o:r:t:p:x:w:s";
   const struct option long_option[] = {
     {"help", no_argument, NULL, 'h'},
     {"input", required_argument, NULL, 'i'},
@@ -350,6 +375,10 @@ bool ParseArguments(const int argc, char* const * argv, Param* param) {
     {"ref", required_argument, NULL, 'r'},
     {"target-ref-name", required_argument, NULL, 't'},
     {"required-match", required_argument, NULL, 'm'},
+    {"threads", required_argument, NULL, 'p'},
+    {"index", required_argument, NULL, 'x'},
+    {"write-index", required_argument, NULL, 'w'},
+    {"stats", no_argument, NULL, 's'},
 
     {0, 0, 0, 0}
   };
@@ -370,10 +399,18 @@ bool ParseArguments(const int argc, char* const * argv, Param* param) {
       case 'r': param->ref_fasta = optarg; break;
       case 't': param->target_ref_name = optarg; break;
       case 'm': param->required_match = atoi(optarg); break;
+      case 'p': param->num_threads = atoi(optarg); break;
+      case 'x': param->ref_index = optarg; break;
+      case 'w': param->write_index = optarg; break;
+      case 's': param->show_stats = true; break;
     }
   }
 
-  if (show_help || param->ref_fasta.empty() || (param->required_match <= 0)) {
+  const bool no_ref = param->write_index.empty() 
+                     ? (param->ref_fasta.empty() && param->ref_index.empty())
+                     : param->ref_fasta.empty();
+  if (show_help || no_ref || (param->required_match <= 0)
+      || (param->num_threads <= 0)) {
     ShowHelp();
     return false;
   }
@@ -424,20 +461,97 @@ inline bool IsProblematicAlignment(const BamTools::BamAlignment& al) {
   return false;
 }
 
+// Note that al is moved into the buffer.
 inline void StoreInBuffer(
     Alignment* al,
-    vector<map<string, Alignment> >* al_maps) {
+    vector<PairTable>* al_maps) {
   int ref_id = al->bam_alignment.RefID;
-  ((*al_maps)[ref_id])[al->bam_alignment.Name] = *al;
+  (*al_maps)[ref_id].Insert(al);
 }
 
+// The scratch space of a thread for searching reads in the special references.
+// The buffers are kept across reads and grow only when a longer read shows up.
+// num_allocs counts the heap allocations made for the scratch and the aligner
+// buffers, which should stay flat while num_searches grows.
+// num_ssw_allocs counts the ones made inside SSW for every aligned read.
+// GetNumAllocs and GetNumSswAllocs add the aligner buffers to them.
+struct SearchScratch {
+  HashRegionTable* hashes;
+  SR_QueryRegion* query_region;
+  bam1_t orphan;           // only the query length is used by the hash searching
+  unsigned int seq_capacity;
+  SR_RefView* ref_view;
+  Scissors::HashesCollection hashes_collection;
+  string reverse;
+  StripedSmithWaterman::Alignment alignment;
+  StripedSmithWaterman::AlignmentBuffer align_buffer;
+  int64_t num_allocs;
+  int64_t num_ssw_allocs;
+  int64_t num_searches;
+
+  SearchScratch()
+      : hashes(HashRegionTableAlloc())
+      , query_region(SR_QueryRegionAlloc())
+      , orphan()
+      , seq_capacity(0)
+      , ref_view(SR_RefViewAlloc())
+      , hashes_collection()
+      , reverse()
+      , alignment()
+      , align_buffer()
+      , num_allocs(3)
+      , num_ssw_allocs(0)
+      , num_searches(0)
+  {
+    memset(&orphan, 0, sizeof(orphan));
+    query_region->pOrphan = &orphan;
+  }
+
+  ~SearchScratch() {
+    free(query_region->orphanSeq);
+    query_region->orphanSeq = NULL;
+    query_region->pOrphan = NULL;
+    SR_QueryRegionFree(query_region);
+    HashRegionTableFree(hashes);
+    SR_RefViewFree(ref_view);
+  }
+
+  int64_t GetNumAllocs(void) const {
+    return num_allocs + align_buffer.num_allocs;
+  }
+
+  int64_t GetNumSswAllocs(void) const {
+    return num_ssw_allocs + align_buffer.num_ssw_allocs;
+  }
+
+  // the total capacity of the arrays in hashes; it only changes on growing
+  unsigned int GetHashesCapacity(void) const {
+    unsigned int capacity = hashes->pPrevRegions->capacity + hashes->pCurrRegions->capacity;
+    if (hashes->pBestCloseRegions) capacity += hashes->pBestCloseRegions->capacity;
+    if (hashes->pBestFarRegions) capacity += hashes->pBestFarRegions->capacity;
+    return capacity;
+  }
+
+ private:
+  SearchScratch (const SearchScratch&);
+  SearchScratch& operator= (const SearchScratch&);
+};
+
 bool ConvertBamAlignmentToQueryRegion(
     const string& bases,
-    SR_QueryRegion* qr) {
-  qr->orphanSeq = (char*)malloc(bases.size() + 1); // free in LoadHash
+    SearchScratch* scratch) {
+  SR_QueryRegion* qr = scratch->query_region;
+  if (bases.size() + 1 > scratch->seq_capacity) {
+    scratch->seq_capacity = (bases.size() + 1) * 2;
+    qr->orphanSeq = (char*) realloc(qr->orphanSeq, scratch->seq_capacity);
+    if (qr->orphanSeq == NULL) {
+      fprintf(stderr, "ERROR: Not enough memory for the orphan sequence.\n");
+      exit(1);
+    }
+    ++scratch->num_allocs;
+  }
   memcpy(qr->orphanSeq, bases.c_str(), bases.size());
   qr->orphanSeq[bases.size()] = '\0';
-  qr->pOrphan = bam_init1(); // free in LoadHash
   qr->pOrphan->core.l_qseq  = bases.size();
 
   return true;
@@ -447,22 +561,21 @@ bool LoadHash(
     const string& bases,
     const SR_Reference* ref,
     const SR_InHashTable* hash_table,
-    HashRegionTable* hashes,
-    Scissors::HashesCollection* hashes_collection) {
+    SearchScratch* scratch) {
 
-  SR_QueryRegion* query_region = SR_QueryRegionAlloc();
-  ConvertBamAlignmentToQueryRegion(bases, query_region);
+  SR_QueryRegion* query_region = scratch->query_region;
+  HashRegionTable* hashes = scratch->hashes;
+  Scissors::HashesCollection* hashes_collection = &scratch->hashes_collection;
+  ConvertBamAlignmentToQueryRegion(bases, scratch);
 
+  const unsigned int capacity = scratch->GetHashesCapacity();
   HashRegionTableInit(hashes, bases.size());
   SR_QueryRegionSetRangeSpecial(query_region, ref->seqLen);
   HashRegionTableLoad(hashes, hash_table, query_region);
+  if (scratch->GetHashesCapacity() != capacity) ++scratch->num_allocs;
   hashes_collection->Init(*(hashes->pBestCloseRegions));
   hashes_collection->SortByLength();
 
-  free(query_region->orphanSeq);
-  bam_destroy1(query_region->pOrphan);
-  SR_QueryRegionFree(query_region);
-
   if ((hashes_collection->Get(hashes_collection->GetSize() - 1) == NULL))
     return false;
   if ((hashes_collection->Get(hashes_collection->GetSize() - 1)->length == 0))
@@ -476,19 +589,15 @@ int GetHashId(
     const unsigned int& required_length,
     const SR_RefHeader* reference_header,
     const SR_Reference* reference_special,
-    SR_RefView** special_ref_view,
+    SR_RefView* special_ref_view,
     uint32_t* pos) {
   if (region.length < required_length) return -1;
 
   int32_t ref_id = 0;
-  //uint32_t pos = 0;
   *pos = 0;
 
-  //SR_RefView* special_ref_view = SR_RefViewAlloc();
   const SR_Status ok = 
-    SR_GetRefFromSpecialPos(*special_ref_view, &ref_id, pos, reference_header, reference_special, region.refBegins[0]);
-
-  //SR_RefViewFree(special_ref_view);
+    SR_GetRefFromSpecialPos(special_ref_view, &ref_id, pos, reference_header, reference_special, region.refBegins[0]);
 
   if (ok != SR_OK) return -1;
   else return ref_id;
@@ -500,16 +609,15 @@ int GetAlignment(
     const int& length,
     const BestRegion& region,
     const SR_RefHeader* reference_header,
-    const SR_Reference* reference_special) {
+    const SR_Reference* reference_special,
+    const StripedSmithWaterman::Aligner& aligner,
+    SearchScratch* scratch) {
   
   uint32_t pos = 0;
-  SR_RefView* special_ref_view = SR_RefViewAlloc();
-  const int special_ref_id = GetHashId(region, kRequestedBases, reference_header, reference_special, &special_ref_view, &pos);
+  SR_RefView* special_ref_view = scratch->ref_view;
+  const int special_ref_id = GetHashId(region, kRequestedBases, reference_header, reference_special, special_ref_view, &pos);
 
-  if (special_ref_id == -1) {
-    SR_RefViewFree(special_ref_view);
-    return -1;
-  }
+  if (special_ref_id == -1) return -1;
 
   int forward_shift = 0;
   if (static_cast <int> (pos) < length) forward_shift = pos;
@@ -522,22 +630,236 @@ int GetAlignment(
   int begin = region.refBegins[0] - forward_shift;
   int end   = region.refBegins[0] + backward_shift;
 
-  StripedSmithWaterman::Alignment alignment;
+  StripedSmithWaterman::Alignment* alignment = &scratch->alignment;
   const char* ref = reference_special->sequence + begin;
   const int ref_length = end - begin + 1;
-  for(int i= begin; i< end; ++i) {
-  }
-  aligner_.Align(bases.c_str(), ref, ref_length, kFilter, &alignment);
+  aligner.Align(bases.c_str(), ref, ref_length, kFilter, alignment, &scratch->align_buffer);
 
   //int reauired_score = (bam_alignment.Length > 100) ? 140 : (bam_alignment.Length * 1.4);   
   int reauired_score = kRequiredMatch * 2; // 2 is the match score
-  if (alignment.sw_score < reauired_score) {
-    SR_RefViewFree(special_ref_view);
-    return -1;
-  } else {
-    SR_RefViewFree(special_ref_view);
-    return special_ref_id;
+  if (alignment->sw_score < reauired_score) return -1;
+  else return special_ref_id;
+}
+
+// Search a read and its reverse complement in the special references.
+// Return the id of the hit special reference; otherwise -1.
+int SearchSpecialReference(
+    const string& bases,
+    const SR_Reference* reference,
+    const SR_InHashTable* hash_table,
+    const SR_RefHeader* reference_header,
+    const StripedSmithWaterman::Aligner& aligner,
+    SearchScratch* scratch) {
+  ++scratch->num_searches;
+  int index = -1;
+  const Scissors::HashesCollection& hashes_collection = scratch->hashes_collection;
+  const bool get_hash = 
+    LoadHash(bases, reference, hash_table, scratch);
+  if (get_hash) {
+    const int id = hashes_collection.GetSize() - 1;
+    index = GetAlignment(bases, bases.size(), *(hashes_collection.Get(id)), reference_header, reference, aligner, scratch);
+  }
+
+  if (index == -1) { // try the reverse complement sequences
+    string& reverse = scratch->reverse;
+    const size_t capacity = reverse.capacity();
+    GetReverseComplement(bases, &reverse);
+    if (reverse.capacity() != capacity) ++scratch->num_allocs;
+    #ifdef TB_VERBOSE_DEBUG
+    fprintf(stderr, "%s\n", reverse.c_str());
+    #endif
+    const bool get_hash2 = 
+      LoadHash(reverse, reference, hash_table, scratch);
+    if (get_hash2) {
+      const int id = hashes_collection.GetSize() - 1;
+      index = GetAlignment(reverse, reverse.size(), *(hashes_collection.Get(id)), reference_header, reference, aligner, scratch);
+    }
   }
+
+  return index;
+}
+
+// The special-reference searching state owned by one worker of -p.
+struct AnnotationWorker {
+  pthread_t thread;
+  SearchScratch scratch;
+  StripedSmithWaterman::Aligner aligner;
+  struct AnnotationPool* pool;
+
+  AnnotationWorker()
+      : thread()
+      , scratch()
+      , aligner()
+      , pool(NULL)
+  {}
+};
+
+// Workers searching the problematic alignments of a batch in the special
+// references. A batch is handed out in chunks of kBatchChunk alignments
+// and the found special reference ids are written back by the position of
+// alignments in the batch, so the batch order is kept for the pairing stage.
+// The threads are created once and wait on batch_ready between batches.
+struct AnnotationPool {
+  const SR_Reference* reference;
+  const SR_InHashTable* hash_table;
+  const SR_RefHeader* reference_header;
+
+  AnnotationWorker* workers;
+  int num_workers;
+
+  // the batch being searched
+  const vector<BamTools::BamAlignment>* alignments;
+  vector<int>* indices;
+  int size;
+  int curr_idx;
+
+  // batch_id is bumped by Start(); num_done counts the workers finished with it
+  int batch_id;
+  int num_done;
+  bool quit;
+  pthread_mutex_t mutex;
+  pthread_cond_t batch_ready;
+  pthread_cond_t batch_done;
+
+  AnnotationPool(const int& num,
+                 const SR_Reference* ref,
+                 const SR_InHashTable* table,
+                 const SR_RefHeader* header)
+      : reference(ref)
+      , hash_table(table)
+      , reference_header(header)
+      , workers(new AnnotationWorker[num])
+      , num_workers(num)
+      , alignments(NULL)
+      , indices(NULL)
+      , size(0)
+      , curr_idx(0)
+      , batch_id(0)
+      , num_done(num)
+      , quit(false)
+  {
+    pthread_mutex_init(&mutex, NULL);
+    pthread_cond_init(&batch_ready, NULL);
+    pthread_cond_init(&batch_done, NULL);
+    for (int i = 0; i < num_workers; ++i) {
+      workers[i].pool = this;
+      if (pthread_create(&workers[i].thread, NULL, &AnnotationPool::StartThread, &workers[i]) != 0) {
+        fprintf(stderr, "ERROR: Unable to create threads.\n");
+        exit(1);
+      }
+    }
+  }
+
+  ~AnnotationPool() {
+    pthread_mutex_lock(&mutex);
+    quit = true;
+    pthread_cond_broadcast(&batch_ready);
+    pthread_mutex_unlock(&mutex);
+
+    for (int i = 0; i < num_workers; ++i) {
+      if (pthread_join(workers[i].thread, NULL) != 0) {
+        fprintf(stderr, "ERROR: Unable to join threads.\n");
+        exit(1);
+      }
+    }
+
+    pthread_cond_destroy(&batch_done);
+    pthread_cond_destroy(&batch_ready);
+    pthread_mutex_destroy(&mutex);
+    delete [] workers;
+  }
+
+  void Start(const vector<BamTools::BamAlignment>& batch, const int& batch_size, vector<int>* batch_indices);
+  void Join(void);
+  void AddScratchCounters(int64_t* num_allocs, int64_t* num_ssw_allocs, int64_t* num_searches) const {
+    for (int i = 0; i < num_workers; ++i) {
+      *num_allocs     += workers[i].scratch.GetNumAllocs();
+      *num_ssw_allocs += workers[i].scratch.GetNumSswAllocs();
+      *num_searches   += workers[i].scratch.num_searches;
+    }
+  }
+  static void* StartThread(void* worker_data);
+
+ private:
+  AnnotationPool (const AnnotationPool&);
+  AnnotationPool& operator= (const AnnotationPool&);
+};
+
+void* AnnotationPool::StartThread(void* worker_data) {
+  AnnotationWorker* worker = static_cast<AnnotationWorker*>(worker_data);
+  AnnotationPool* pool = worker->pool;
+  int last_batch_id = 0;
+
+  while (true) {
+    // wait for the next batch or for the pool to be destroyed
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->batch_id == last_batch_id && !pool->quit)
+      pthread_cond_wait(&pool->batch_ready, &pool->mutex);
+    if (pool->quit) {
+      pthread_mutex_unlock(&pool->mutex);
+      break;
+    }
+    last_batch_id = pool->batch_id;
+    pthread_mutex_unlock(&pool->mutex);
+
+    while (true) {
+      pthread_mutex_lock(&pool->mutex);
+      const int begin = pool->curr_idx;
+      pool->curr_idx += kBatchChunk;
+      pthread_mutex_unlock(&pool->mutex);
+
+      if (begin >= pool->size) break;
+      const int end = (begin + kBatchChunk < pool->size) ? (begin + kBatchChunk) : pool->size;
+
+      for (int i = begin; i < end; ++i) {
+        const BamTools::BamAlignment& bam_alignment = (*pool->alignments)[i];
+        int index = -1;
+        if (IsProblematicAlignment(bam_alignment))
+          index = SearchSpecialReference(bam_alignment.QueryBases, pool->reference, pool->hash_table,
+                                         pool->reference_header, worker->aligner, &worker->scratch);
+        (*pool->indices)[i] = index;
+      }
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    ++pool->num_done;
+    if (pool->num_done == pool->num_workers) pthread_cond_signal(&pool->batch_done);
+    pthread_mutex_unlock(&pool->mutex);
+  }
+
+  pthread_exit(NULL);
+}
+
+// Start searching a batch; Join() must be called before the batch is touched again.
+void AnnotationPool::Start(
+    const vector<BamTools::BamAlignment>& batch,
+    const int& batch_size,
+    vector<int>* batch_indices) {
+  pthread_mutex_lock(&mutex);
+  alignments = &batch;
+  indices    = batch_indices;
+  size       = batch_size;
+  curr_idx   = 0;
+  num_done   = 0;
+  ++batch_id;
+  pthread_cond_broadcast(&batch_ready);
+  pthread_mutex_unlock(&mutex);
+}
+
+// Wait until every worker is done with the current batch.
+void AnnotationPool::Join(void) {
+  pthread_mutex_lock(&mutex);
+  while (num_done < num_workers)
+    pthread_cond_wait(&batch_done, &mutex);
+  pthread_mutex_unlock(&mutex);
+}
+
+// Read up to kBatchSize alignments into batch and return the number read.
+int ReadBatch(BamTools::BamReader* reader, vector<BamTools::BamAlignment>* batch) {
+  int size = 0;
+  while (size < kBatchSize && reader->GetNextAlignment((*batch)[size])) ++size;
+
+  return size;
 }
 
 void LoadAlignmentsNotInTargetChr(
@@ -547,7 +869,8 @@ void LoadAlignmentsNotInTargetChr(
     const SR_RefHeader* reference_header,
     const SpecialReference& s_ref,
     BamTools::BamReader* reader,
-    vector<map<string, Alignment> >* al_maps) {
+    vector<PairTable>* al_maps,
+    SearchScratch* scratch) {
   
   BamTools::BamRegion region1, region2;
   bool has_region1 = false, has_region2 = false;
@@ -581,128 +904,157 @@ void LoadAlignmentsNotInTargetChr(
 
   // Load alignments in region1
   if (has_region1 && reader->SetRegion(region1)) {
-    HashRegionTable* hashes = HashRegionTableAlloc();
     while (reader->GetNextAlignment(bam_alignment)) {
       int index = -1;
       if (bam_alignment.MateRefID == target_ref_id) {
-        Scissors::HashesCollection hashes_collection;
-        const bool get_hash = 
-          LoadHash(bam_alignment.QueryBases, reference, hash_table, hashes, &hashes_collection);
-        if (get_hash) {
-          const int id = hashes_collection.GetSize() - 1;
-          //index = GetHashId(*(hashes_collection.Get(id)), kRequestedBases, reference_header, reference);
-          index = GetAlignment(bam_alignment.QueryBases, bam_alignment.QueryBases.size(), *(hashes_collection.Get(id)), reference_header, reference);
-        }
-        //Align(bam_alignment.QueryBases, aligner, &alignment);
-        //index = PickBestAlignment(bam_alignment.Length, alignment, s_ref);
-        if (index == -1) { // try the reverse complement sequences
-          string reverse;
-          GetReverseComplement(bam_alignment.QueryBases, &reverse);
-	  //bam_alignment.QueryBases = reverse;
-          #ifdef TB_VERBOSE_DEBUG
-          fprintf(stderr, "%s\n", reverse.c_str());
-          #endif
-          Scissors::HashesCollection hashes_collection2;
-          const bool get_hash = 
-            LoadHash(reverse, reference, hash_table, hashes, &hashes_collection2);
-          if (get_hash) {
-            const int id = hashes_collection2.GetSize() - 1;
-            //index = GetHashId(*(hashes_collection2.Get(id)), kRequestedBases, reference_header, reference);
-            index = GetAlignment(reverse, reverse.size(), *(hashes_collection2.Get(id)), reference_header, reference);
-          }
-          //Align(reverse, aligner, &alignment);
-          //index = PickBestAlignment(bam_alignment.Length, alignment, s_ref);
-        } // end if (index == -1)
+        index = SearchSpecialReference(bam_alignment.QueryBases, reference, hash_table, reference_header, aligner_, scratch);
       
       al.Clear();
       al.bam_alignment = bam_alignment;
       al.hit_insertion = (index == -1) ? false: true;
       al.ins_prefix    = (index == -1) ? "" : s_ref.ref_names[index].substr(8,2);
-      StoreInBuffer(&al, al_maps);
 
       #ifdef TB_VERBOSE_DEBUG
       fprintf(stderr, "SP mapped: %c\tSP:%s\n", (index == -1) ? 'F' : 'T', al.ins_prefix.c_str());
       #endif
+      StoreInBuffer(&al, al_maps);
       } // end of
     }
-    HashRegionTableFree(hashes);
   }
 
   // Load alignments in region2
   if (has_region2&& reader->SetRegion(region2)) {
-    HashRegionTable* hashes = HashRegionTableAlloc();
     while (reader->GetNextAlignment(bam_alignment)) {
       int index = -1;
       if (bam_alignment.MateRefID == target_ref_id) {
-        Scissors::HashesCollection hashes_collection;
-        const bool get_hash = 
-          LoadHash(bam_alignment.QueryBases, reference, hash_table, hashes, &hashes_collection);
-        if (get_hash) {
-          const int id = hashes_collection.GetSize() - 1;
-          //index = GetHashId(*(hashes_collection.Get(id)), kRequestedBases, reference_header, reference);
-          index = GetAlignment(bam_alignment.QueryBases, bam_alignment.QueryBases.size(), *(hashes_collection.Get(id)), reference_header, reference);
-        }
-        //Align(bam_alignment.QueryBases, aligner, &alignment);
-        //index = PickBestAlignment(bam_alignment.Length, alignment, s_ref);
-        if (index == -1) { // try the reverse complement sequences
-          string reverse;
-          GetReverseComplement(bam_alignment.QueryBases, &reverse);
-	  //bam_alignment.QueryBases = reverse;
-          #ifdef TB_VERBOSE_DEBUG
-          fprintf(stderr, "%s\n", reverse.c_str());
-          #endif
-          Scissors::HashesCollection hashes_collection2;
-          const bool get_hash = 
-            LoadHash(reverse, reference, hash_table, hashes, &hashes_collection2);
-          if (get_hash) {
-            const int id = hashes_collection2.GetSize() - 1;
-            //index = GetHashId(*(hashes_collection2.Get(id)), kRequestedBases, reference_header, reference);
-            index = GetAlignment(reverse, reverse.size(), *(hashes_collection2.Get(id)), reference_header, reference);
-          }
-          //Align(reverse, aligner, &alignment);
-          //index = PickBestAlignment(bam_alignment.Length, alignment, s_ref);
-        } // end if (index == -1)
+        index = SearchSpecialReference(bam_alignment.QueryBases, reference, hash_table, reference_header, aligner_, scratch);
       al.Clear();
       al.bam_alignment = bam_alignment;
       al.hit_insertion = (index == -1) ? false: true;
       al.ins_prefix    = (index == -1) ? "" : s_ref.ref_names[index].substr(8,2);
-      StoreInBuffer(&al, al_maps);
 
       #ifdef TB_VERBOSE_DEBUG
       fprintf(stderr, "SP mapped: %c\tSP:%s\n", (index == -1) ? 'F' : 'T', al.ins_prefix.c_str());
       #endif
+      StoreInBuffer(&al, al_maps);
       } // end if
     }
-    HashRegionTableFree(hashes);
   }
 }
 
 void MoveAlInAlmapToAlmaps(
-    map<string, Alignment>* al_map1,
-    map<string, Alignment>* al_map2,
-    vector<map<string, Alignment> >* al_maps,
+    PairTable* al_map1,
+    PairTable* al_map2,
+    vector<PairTable>* al_maps,
     BamTools::BamWriter* writer) {
-  for (map<string, Alignment>::iterator ite = al_map1->begin();
-       ite != al_map1->end(); ++ite) {
-    const int32_t ref_id = ite->second.bam_alignment.RefID;
-    const int32_t mate_ref_id = ite->second.bam_alignment.MateRefID;
+  vector<Alignment*> sorted;
+  al_map1->GetSorted(&sorted);
+  for (vector<Alignment*>::iterator ite = sorted.begin();
+       ite != sorted.end(); ++ite) {
+    const int32_t ref_id = (*ite)->bam_alignment.RefID;
+    const int32_t mate_ref_id = (*ite)->bam_alignment.MateRefID;
     if (mate_ref_id > ref_id) 
-      ((*al_maps)[ref_id])[ite->second.bam_alignment.Name] = ite->second;
+      (*al_maps)[ref_id].Insert(*ite);
     else
-      WriteAlignment(&(ite->second), writer);
+      WriteAlignment(*ite, writer);
   }
-  al_map1->clear();
+  al_map1->Clear();
 
-  for (map<string, Alignment>::iterator ite = al_map2->begin();
-       ite != al_map2->end(); ++ite) {
-    const int32_t ref_id = ite->second.bam_alignment.RefID;
-    const int32_t mate_ref_id = ite->second.bam_alignment.MateRefID;
+  al_map2->GetSorted(&sorted);
+  for (vector<Alignment*>::iterator ite = sorted.begin();
+       ite != sorted.end(); ++ite) {
+    const int32_t ref_id = (*ite)->bam_alignment.RefID;
+    const int32_t mate_ref_id = (*ite)->bam_alignment.MateRefID;
     if (mate_ref_id > ref_id) 
-      ((*al_maps)[ref_id])[ite->second.bam_alignment.Name] = ite->second;
+      (*al_maps)[ref_id].Insert(*ite);
     else
-      WriteAlignment(&(ite->second), writer);
+      WriteAlignment(*ite, writer);
+  }
+  al_map2->Clear();
+}
+
+// Return true if the mate of a buffered alignment sits in a chromosome
+// that has been passed, so the alignment can never be paired.
+struct IsMatePassed {
+  int32_t ref_id;
+  explicit IsMatePassed(const int32_t& id) : ref_id(id) {}
+  bool operator()(const Alignment& al) const {
+    return al.bam_alignment.MateRefID < ref_id;
+  }
+};
+
+// Release the buffered cross-chromosome alignments whose mates are in the
+// chromosomes before ref_id. Such alignments were never written out before
+// either; releasing them keeps al_maps from growing for the whole run.
+void ReleasePassedMates(const int32_t& ref_id, vector<PairTable>* al_maps) {
+  if (ref_id < 0) return;
+  for (vector<PairTable>::iterator ite = al_maps->begin(); ite != al_maps->end(); ++ite)
+    ite->EraseIf(IsMatePassed(ref_id));
+}
+
+// The mate-pairing stage: attach the special reference hit, pair the
+// alignment with its mate and write them out.
+void PairAlignment(
+    const BamTools::BamAlignment& bam_alignment,
+    const int& index,
+    const SpecialReference& s_ref,
+    int* previous_ref_id,
+    int* target_ref_id,
+    PairTable* al_map1,
+    PairTable* al_map2,
+    PairTable*& al_map_cur,
+    PairTable*& al_map_pre,
+    vector<PairTable>* al_maps,
+    Alignment* al,
+    BamTools::BamWriter* writer) {
+  if (bam_alignment.RefID != *previous_ref_id) { // BAM is in the next chromosome
+    #ifdef TB_VERBOSE_DEBUG
+    fprintf(stderr, "BAM jumps from chrID: %d to chrID: %d\n", *previous_ref_id, bam_alignment.RefID);
+    #endif
+    MoveAlInAlmapToAlmaps(al_map1, al_map2, al_maps, writer);
+    ReleasePassedMates(bam_alignment.RefID, al_maps);
+    al_map_cur = al_map1;
+    al_map_pre = al_map2;
+    *previous_ref_id = bam_alignment.RefID;
+    *target_ref_id = bam_alignment.RefID;
   }
-  al_map2->clear();
+    
+  #ifdef TB_VERBOSE_DEBUG
+  fprintf(stderr, "SP mapped: %c\n", (index == -1) ? 'F' : 'T');
+  #endif
+
+  al->Clear();
+  al->bam_alignment = bam_alignment;
+  al->hit_insertion = (index == -1) ? false: true;
+  al->ins_prefix    = (index == -1) ? "" : s_ref.ref_names[index].substr(0,2);
+  if (bam_alignment.RefID == *target_ref_id) {
+    if (!bam_alignment.IsPaired()) {
+      WriteAlignment(al, writer);
+    } else { //bam_alignment.IsPaired
+      if (bam_alignment.RefID == bam_alignment.MateRefID)
+        StoreAlignment(al, al_map_cur, al_map_pre, writer);
+      else
+        StoreAlignment(al, al_maps, writer);
+    }
+  } // end if 
+}
+
+// Hash the special references in the fasta and keep them in an index file
+// which later runs map by -x instead of hashing again.
+bool WriteSpecialIndex(const Param& param) {
+  SpecialHasher sp_hasher;
+  sp_hasher.SetFastaName(param.ref_fasta.c_str());
+  if (!sp_hasher.Load()) {
+    fprintf(stderr,"ERROR: The program cannot load special references.\n");
+    return false;
+  }
+
+  FastaReference fasta;
+  LoadReference(param.ref_fasta.c_str(), &fasta);
+  SpecialReference s_ref;
+  ConcatenateSpecialReference(&fasta, &s_ref);
+
+  return sp_hasher.WriteIndex(param.write_index.c_str(), s_ref.ref_names, s_ref.ref_lens);
 }
 
 int main(int argc, char** argv) {
@@ -710,6 +1062,9 @@ int main(int argc, char** argv) {
   
   if (!ParseArguments(argc, argv, &param)) return 1;
 
+  if (!param.write_index.empty()) 
+    return WriteSpecialIndex(param) ? 0 : 1;
+
   // Open input bam
   string infilename = param.in_bam;
   string outfilename = param.out_bam;
@@ -721,7 +1076,7 @@ int main(int argc, char** argv) {
   int target_ref_id = -1;
   int previous_ref_id = -1;
   //bool region_set = false;
-  vector<map<string, Alignment> > al_maps(reader.GetReferenceCount());
+  vector<PairTable> al_maps(reader.GetReferenceCount());
   if (!param.target_ref_name.empty()) {
     target_ref_id = reader.GetReferenceID(param.target_ref_name);
     previous_ref_id = target_ref_id;
@@ -730,23 +1085,30 @@ int main(int argc, char** argv) {
 
   // Special hash
   SpecialHasher sp_hasher;
-  sp_hasher.SetFastaName(param.ref_fasta.c_str());
-  if (!sp_hasher.Load()) {
-    fprintf(stderr,"ERROR: The program cannot load special references.\n");
-    return 1;
+  SpecialReference s_ref;
+  if (!param.ref_index.empty()) {
+    if (!sp_hasher.LoadIndex(param.ref_index.c_str(), &s_ref.ref_names, &s_ref.ref_lens)) {
+      fprintf(stderr,"ERROR: The program cannot load the special reference index.\n");
+      return 1;
+    }
+  } else {
+    sp_hasher.SetFastaName(param.ref_fasta.c_str());
+    if (!sp_hasher.Load()) {
+      fprintf(stderr,"ERROR: The program cannot load special references.\n");
+      return 1;
+    }
+
+    // Open fasta
+    FastaReference fasta;
+    LoadReference(param.ref_fasta.c_str(), &fasta);
+
+    // Build SSW aligners for every reference in fasta
+    ConcatenateSpecialReference(&fasta, &s_ref);
   }
   const SR_Reference* reference = sp_hasher.GetReference();
   const SR_InHashTable* hash_table = sp_hasher.GetHashTable();
   const SR_RefHeader* reference_header = sp_hasher.GetReferenceHeader();
-  HashRegionTable* hashes = HashRegionTableAlloc();
-
-  // Open fasta
-  FastaReference fasta;
-  LoadReference(param.ref_fasta.c_str(), &fasta);
-
-  // Build SSW aligners for every reference in fasta
-  SpecialReference s_ref;
-  ConcatenateSpecialReference(&fasta, &s_ref);
+  SearchScratch scratch;
 
   // Build SSW aligner
   //StripedSmithWaterman::Aligner aligner;
@@ -754,8 +1116,8 @@ int main(int argc, char** argv) {
 
   // CORE ALGORITHM
   BamTools::BamAlignment bam_alignment;
-  map<string, Alignment> al_map1, al_map2;
-  map<string, Alignment> *al_map_cur = &al_map1, *al_map_pre = &al_map2;
+  PairTable al_map1, al_map2;
+  PairTable *al_map_cur = &al_map1, *al_map_pre = &al_map2;
   StripedSmithWaterman::Alignment alignment;
   Alignment al;
 
@@ -767,7 +1129,7 @@ int main(int argc, char** argv) {
       reader.CreateIndex();
       fprintf(stderr, "Warning: %s has been created.\n", indexfilename.c_str());
     }
-    LoadAlignmentsNotInTargetChr(target_ref_id, reference, hash_table, reference_header, s_ref, &reader, &al_maps);
+    LoadAlignmentsNotInTargetChr(target_ref_id, reference, hash_table, reference_header, s_ref, &reader, &al_maps, &scratch);
     const BamTools::RefVector& references = reader.GetReferenceData();
     const BamTools::RefData& ref_data = references.at(target_ref_id);
     reader.SetRegion(target_ref_id, 0, target_ref_id, ref_data.RefLength);
@@ -776,75 +1138,73 @@ int main(int argc, char** argv) {
     previous_ref_id = 0;
   }
 
-  while (reader.GetNextAlignment(bam_alignment)) {
-    if (bam_alignment.RefID != previous_ref_id) { // BAM is in the next chromosome
+  if (param.num_threads == 1) {
+    while (reader.GetNextAlignment(bam_alignment)) {
       #ifdef TB_VERBOSE_DEBUG
-      fprintf(stderr, "BAM jumps from chrID: %d to chrID: %d\n", previous_ref_id, bam_alignment.RefID);
+      fprintf(stderr, "%s\n%s\n", bam_alignment.Name.c_str(), bam_alignment.QueryBases.c_str());
       #endif
-      MoveAlInAlmapToAlmaps(&al_map1, &al_map2, &al_maps, &writer);
-      al_map_cur = &al_map1;
-      al_map_pre = &al_map2;
-      previous_ref_id = bam_alignment.RefID;
-      target_ref_id = bam_alignment.RefID;
+      int index = -1;
+      if (IsProblematicAlignment(bam_alignment))
+        index = SearchSpecialReference(bam_alignment.QueryBases, reference, hash_table, reference_header, aligner_, &scratch);
+
+      PairAlignment(bam_alignment, index, s_ref, &previous_ref_id, &target_ref_id,
+                    &al_map1, &al_map2, al_map_cur, al_map_pre, &al_maps, &al, &writer);
     }
-    #ifdef TB_VERBOSE_DEBUG
-    fprintf(stderr, "%s\n%s\n", bam_alignment.Name.c_str(), bam_alignment.QueryBases.c_str());
-    #endif
-    int index = -1;
-    if (IsProblematicAlignment(bam_alignment)) {
-      Scissors::HashesCollection hashes_collection;
-      const bool get_hash = 
-        LoadHash(bam_alignment.QueryBases, reference, hash_table, hashes, &hashes_collection);
-      if (get_hash) {
-        const int id = hashes_collection.GetSize() - 1;
-        //index = GetHashId(*(hashes_collection.Get(id)), kRequestedBases, reference_header, reference);
-        index = GetAlignment(bam_alignment.QueryBases, bam_alignment.QueryBases.size(), *(hashes_collection.Get(id)), reference_header, reference);
-      }
-      if (index == -1) { // try the reverse complement sequences
-        string reverse;
-        GetReverseComplement(bam_alignment.QueryBases, &reverse);
-	//bam_alignment.QueryBases = reverse;
-        #ifdef TB_VERBOSE_DEBUG
-        fprintf(stderr, "%s\n", reverse.c_str());
-        #endif
-        Scissors::HashesCollection hashes_collection2;
-        const bool get_hash2 = 
-          LoadHash(reverse, reference, hash_table, hashes, &hashes_collection2);
-        if (get_hash2) {
-          const int id = hashes_collection2.GetSize() - 1;
-          //index = GetHashId(*(hashes_collection2.Get(id)), kRequestedBases, reference_header, reference);
-          index = GetAlignment(reverse, reverse.size(), *(hashes_collection2.Get(id)), reference_header, reference);
-        }
-      }
+  } else {
+    // Two batches take turns: the workers search one of them in the special
+    // references while the other one is paired, written and then refilled.
+    AnnotationPool pool(param.num_threads, reference, hash_table, reference_header);
+    vector<BamTools::BamAlignment> batches[2];
+    vector<int> indices[2];
+    int sizes[2] = {0, 0};
+    for (int i = 0; i < 2; ++i) {
+      batches[i].resize(kBatchSize);
+      indices[i].resize(kBatchSize);
     }
-      
-    #ifdef TB_VERBOSE_DEBUG
-    fprintf(stderr, "SP mapped: %c\n", (index == -1) ? 'F' : 'T');
-    #endif
 
-    al.Clear();
-    al.bam_alignment = bam_alignment;
-    al.hit_insertion = (index == -1) ? false: true;
-    al.ins_prefix    = (index == -1) ? "" : s_ref.ref_names[index].substr(0,2);
-    if (bam_alignment.RefID == target_ref_id) {
-      if (!bam_alignment.IsPaired()) {
-        WriteAlignment(&al, &writer);
-      } else { //bam_alignment.IsPaired
-        if (bam_alignment.RefID == bam_alignment.MateRefID)
-	  StoreAlignment(&al, al_map_cur, al_map_pre, &writer);
-	else
-	  StoreAlignment(&al, &al_maps, &writer);
-      }
-    } // end if 
+    int running = 0, ready = 1;
+    sizes[running] = ReadBatch(&reader, &batches[running]);
+    if (sizes[running] > 0) pool.Start(batches[running], sizes[running], &indices[running]);
+
+    while (true) {
+      for (int i = 0; i < sizes[ready]; ++i)
+        PairAlignment(batches[ready][i], indices[ready][i], s_ref, &previous_ref_id, &target_ref_id,
+                      &al_map1, &al_map2, al_map_cur, al_map_pre, &al_maps, &al, &writer);
+
+      if (sizes[running] == 0) break;
+
+      sizes[ready] = ReadBatch(&reader, &batches[ready]);
+      pool.Join();
+
+      std::swap(running, ready);
+      if (sizes[running] > 0) pool.Start(batches[running], sizes[running], &indices[running]);
+    }
+
+    pool.AddScratchCounters(&scratch.num_allocs, &scratch.num_ssw_allocs, &scratch.num_searches);
   }
 
   // Close
   WriteAlignment(&al_map1, &writer);
   WriteAlignment(&al_map2, &writer);
-  al_map1.clear();
-  al_map2.clear();
+
+  #ifdef TB_VERBOSE_DEBUG
+  size_t al_maps_bytes = 0;
+  int al_maps_peak = 0;
+  for (vector<PairTable>::const_iterator ite = al_maps.begin(); ite != al_maps.end(); ++ite) {
+    al_maps_bytes += ite->GetMemoryUsage();
+    al_maps_peak  += ite->GetPeakSize();
+  }
+  fprintf(stderr, "Mate buffers: peak %d + %d alignments, %zu + %zu bytes; cross-chromosome: peak %d alignments, %zu bytes\n",
+          al_map1.GetPeakSize(), al_map2.GetPeakSize(), al_map1.GetMemoryUsage(), al_map2.GetMemoryUsage(),
+          al_maps_peak, al_maps_bytes);
+  #endif
+
+  if (param.show_stats)
+    fprintf(stderr, "Search scratch: %lld heap allocations for %lld searched reads, %lld more inside SSW (profiles, results and kernel scratch)\n",
+            (long long) scratch.GetNumAllocs(), (long long) scratch.num_searches, (long long) scratch.GetNumSswAllocs());
+
+  al_map1.Clear();
+  al_map2.Clear();
   reader.Close();
   writer.Close();
-
-  HashRegionTableFree(hashes);
 }
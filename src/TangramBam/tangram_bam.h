@@ -1,6 +1,7 @@
 #ifndef TANGRAM_BAM_H_
 #define TANGRAM_BAM_H_
 
+#include <algorithm>
 #include <string>
 
 #include "api/BamAlignment.h"
@@ -23,23 +24,57 @@ struct Alignment {
     hit_insertion = false;
     ins_prefix.clear();
   }
+
+  // Swap the contents with other by exchanging buffers instead of copying.
+  // The private support data of BamAlignment stays; it only matters for
+  // core-only alignments, which tangram_bam never reads.
+  void Swap(Alignment* other) {
+    BamTools::BamAlignment& a = bam_alignment;
+    BamTools::BamAlignment& b = other->bam_alignment;
+    a.Name.swap(b.Name);
+    a.QueryBases.swap(b.QueryBases);
+    a.AlignedBases.swap(b.AlignedBases);
+    a.Qualities.swap(b.Qualities);
+    a.TagData.swap(b.TagData);
+    a.CigarData.swap(b.CigarData);
+    a.Filename.swap(b.Filename);
+    std::swap(a.Length, b.Length);
+    std::swap(a.RefID, b.RefID);
+    std::swap(a.Position, b.Position);
+    std::swap(a.Bin, b.Bin);
+    std::swap(a.MapQuality, b.MapQuality);
+    std::swap(a.AlignmentFlag, b.AlignmentFlag);
+    std::swap(a.MateRefID, b.MateRefID);
+    std::swap(a.MatePosition, b.MatePosition);
+    std::swap(a.InsertSize, b.InsertSize);
+    std::swap(hit_insertion, other->hit_insertion);
+    ins_prefix.swap(other->ins_prefix);
+  }
 };
 
 struct Param {
   string in_bam; // -i
   string out_bam; // -o
   string ref_fasta; // -r
+  string ref_index; // -x, the special reference index
+  string write_index; // -w, build the special reference index and exit
   string command_line;
   string target_ref_name; // -t, the target chromosome
   int required_match; // -m
+  int num_threads; // -p
+  bool show_stats; // -s
 
   Param()
       : in_bam("stdin")
       , out_bam("stdout")
       , ref_fasta()
+      , ref_index()
+      , write_index()
       , command_line()
       , target_ref_name("-1")
       , required_match(50)
+      , num_threads(1)
+      , show_stats(false)
   {}
 };
 
@@ -32,9 +32,16 @@
 #include "TGM_Sequence.h"
 #include "TGM_Aligner.h"
 #include "TGM_FirstMapThread.h"
+#include "TGM_TaskPool.h"
 
 using namespace Tangram;
 
+// maximum number of orphans in a chunk of the first map tasks
+#define FIRST_MAP_CHUNK_SIZE 64
+
+// maximum number of split events in a chunk of the second map tasks
+#define SECOND_MAP_CHUNK_SIZE 4
+
 static int ComparePartial(const void* a, const void* b)
 {
     const PrtlAlgnmnt* pPartialOne = (const PrtlAlgnmnt*) a;
@@ -117,8 +124,8 @@ static int CompareSplitEvent(const void* a, const void* b)
     }
 }
 
-Aligner::Aligner(Detector& detector, BamPairTable& bamPairTable, const AlignerPars& alignerPars, const Reference& ref, const LibTable& libTable)
-                 : detector(detector), bamPairTable(bamPairTable), pars(alignerPars), ref(ref), libTable(libTable)
+Aligner::Aligner(Detector& detector, BamPairTable& bamPairTable, const AlignerPars& alignerPars, const Reference& ref, const ChromView& chrom, const LibTable& libTable)
+                 : detector(detector), bamPairTable(bamPairTable), pars(alignerPars), ref(ref), chrom(chrom), libTable(libTable)
 {
 
 }
@@ -173,8 +180,7 @@ void Aligner::Map(void)
 
 void Aligner::FirstMap(void)
 {
-    Array<OrphanPair>& orphanPairs = bamPairTable.orphanPairs;
-    unsigned int orphanSize = orphanPairs.Size();
+    unsigned int orphanSize = bamPairTable.orphanPairs.Size();
     unsigned int softSize = bamPairTable.softPairs.Size();
     unsigned int partialSize = orphanSize + softSize;
 
@@ -196,29 +202,16 @@ void Aligner::FirstMap(void)
     if (firstMapData == NULL)
         TGM_ErrQuit("ERROR: Not enough memory for the first split mapping data.\n");
 
-    unsigned int orphanStart = 0;
-    unsigned int shareSize = orphanSize / pars.numThread;
-    unsigned int shareRemainder = orphanSize % pars.numThread;
-
-    FirstMapThread firstMapThread(pars, libTable, bamPairTable, ref);
+    FirstMapThread firstMapThread(pars, libTable, bamPairTable, chrom);
+    TaskPool taskPool(orphanSize, pars.numThread, FIRST_MAP_CHUNK_SIZE);
 
     for (int i = 0; i != pars.numThread; ++i)
     {
         firstMapData[i].idx = i;
         firstMapData[i].pFirstMapThread = &firstMapThread;
-        firstMapData[i].orphanStart = orphanStart;
-        firstMapData[i].firstPartials = firstPartials.GetPointer(orphanStart);
-        firstMapData[i].refRegions = refRegions.GetPointer(orphanStart);
-        firstMapData[i].orphanPairs = orphanPairs.GetPointer(orphanStart);
-        firstMapData[i].orphanSize = shareSize;
-
-        if (shareRemainder != 0)
-        {
-            firstMapData[i].orphanSize += 1;
-            --shareRemainder;
-        }
-
-        orphanStart += firstMapData[i].orphanSize;
+        firstMapData[i].pTaskPool = &taskPool;
+        firstMapData[i].firstPartials = firstPartials.GetPointer(0);
+        firstMapData[i].refRegions = refRegions.GetPointer(0);
 
         int ret = pthread_create(&(firstMapData[i].thread), &attr, &FirstMapThread::StartThread, (void*) &(firstMapData[i]));
         if (ret != 0)
@@ -234,13 +227,16 @@ void Aligner::FirstMap(void)
             TGM_ErrQuit("ERROR: Unable to join threads.\n");
     }
 
+    if (pars.showThreadTime)
+        taskPool.Report(stderr, "first map");
+
     free(firstMapData);
 
     unsigned int j = orphanSize;
     for (unsigned int i = 0; i != softSize; ++i, ++j)
-        InsertSoft(firstPartials, bamPairTable.softPairs[i], i, j);
+        InsertSoft(firstPartials, bamPairTable.softPairs, i, j);
 
-    firstPartials.Sort(ComparePartial);
+    firstPartials.StableSort(ComparePartial);
     CleanFirstPartials(firstPartials);
 
     if (firstPartials.Size() == 0)
@@ -276,29 +272,34 @@ void Aligner::InsertFirstPartial(Array<PrtlAlgnmnt>& firstPartials, const s_alig
     firstPartials.Increment();
 }
 
-void Aligner::InsertSoft(Array<PrtlAlgnmnt>& firstPartials, const SoftPair& softPair, unsigned int origIdx, unsigned int idx) const
+void Aligner::InsertSoft(Array<PrtlAlgnmnt>& firstPartials, SoftPairs& softPairs, unsigned int origIdx, unsigned int idx) const
 {
     PrtlAlgnmnt& partial = firstPartials[idx];
 
-    partial.refPos = softPair.pos;
-    partial.refEnd = softPair.end;
+    // the cigar points into the cigar buffer of the bam pair table
+    uint32_t* cigar = softPairs.GetCigar(origIdx);
+    unsigned int cigarLen = softPairs.cigarLens[origIdx];
+    const SoftAttrbt& attrbt = softPairs.attrbts[origIdx];
+
+    partial.refPos = softPairs.pos[origIdx];
+    partial.refEnd = softPairs.ends[origIdx];
 
     partial.readPos = 0;
-    partial.readEnd = softPair.read.len - 1;
-    if ((softPair.cigar[0] & BAM_CIGAR_MASK) == BAM_CSOFT_CLIP)
-        partial.readPos += ((softPair.cigar[0] >> BAM_CIGAR_SHIFT));
+    partial.readEnd = softPairs.reads.GetLen(origIdx) - 1;
+    if ((cigar[0] & BAM_CIGAR_MASK) == BAM_CSOFT_CLIP)
+        partial.readPos += ((cigar[0] >> BAM_CIGAR_SHIFT));
 
-    unsigned int cigarEnd = softPair.cigarLen - 1;
-    if ((softPair.cigar[cigarEnd] & BAM_CIGAR_MASK) == BAM_CSOFT_CLIP)
-        partial.readEnd -= ((softPair.cigar[cigarEnd] >> BAM_CIGAR_SHIFT));
+    unsigned int cigarEnd = cigarLen - 1;
+    if ((cigar[cigarEnd] & BAM_CIGAR_MASK) == BAM_CSOFT_CLIP)
+        partial.readEnd -= ((cigar[cigarEnd] >> BAM_CIGAR_SHIFT));
 
-    partial.cigar = softPair.cigar;
-    partial.cigarLen = softPair.cigarLen ;
+    partial.cigar = cigar;
+    partial.cigarLen = cigarLen;
 
     partial.origIdx = origIdx;
-    partial.isReversed = softPair.sStrand == 1 ? 1 : 0;
+    partial.isReversed = attrbt.sStrand == 1 ? 1 : 0;
     partial.isSoft = 1;
-    partial.partialType = softPair.readPairType == PT_SOFT3 ? PARTIAL_3 : PARTIAL_5;
+    partial.partialType = attrbt.readPairType == PT_SOFT3 ? PARTIAL_3 : PARTIAL_5;
 }
 
 void Aligner::CleanFirstPartials(Array<PrtlAlgnmnt>& firstPartials)
@@ -422,16 +423,9 @@ void Aligner::InsertNewSplitEvent(const Array<PrtlAlgnmnt>& firstPartials, const
     {
         int readLen = 0;
         if (firstPartials[j].isSoft)
-        {
-            const SoftPair& softPair = bamPairTable.softPairs[firstPartials[j].origIdx];
-            readLen = softPair.read.len;
-        }
+            readLen = bamPairTable.softPairs.reads.GetLen(firstPartials[j].origIdx);
         else
-        {
-            const OrphanPair& orphanPair = bamPairTable.orphanPairs[firstPartials[j].origIdx];
-            readLen = orphanPair.read.len;
-
-        }
+            readLen = bamPairTable.orphanPairs.reads.GetLen(firstPartials[j].origIdx);
 
         int alignedLen = firstPartials[j].readEnd - firstPartials[j].readPos + 1;
 
@@ -489,7 +483,7 @@ void Aligner::Print(const PrtlAlgnmnt& partialAlignment, const TGM_Sequence& rea
             case BAM_CDEL:
             case BAM_CSOFT_CLIP:
                 for (int j = 0; j != length; ++j)
-                    printf("%c", char_table[ref.refSeq[refPos++]]);
+                    printf("%c", char_table[chrom.GetRefBase(refPos++)]);
                 break;
             case BAM_CINS:
                 for (int j = 0; j != length; ++j)
@@ -543,9 +537,9 @@ void Aligner::PrintSplitEvent(void)
             pPartial = &(splitEvents[i].first5[0]);
 
         if (pPartial->isSoft)
-            refID = bamPairTable.softPairs[pPartial->origIdx].refID;
+            refID = bamPairTable.softPairs.attrbts[pPartial->origIdx].refID;
         else
-            refID = bamPairTable.orphanPairs[pPartial->origIdx].refID;
+            refID = bamPairTable.orphanPairs.attrbts[pPartial->origIdx].refID;
 
         // printf("chr%d\t%d\t%d\t%d\n", refID + 1, pPartial->refPos, pPartial->refEnd + 1, numFrag);
         printf("%d\t%d\t%d\n", splitEvents[i].refID, splitEvents[i].pos, splitEvents[i].len);
@@ -557,8 +551,9 @@ void Aligner::PrintSplitEvent(void)
 void Aligner::SecondMap(void)
 {
     SecondMapData mapData;
-    SecondMapThread secondMapThread(splitEvents, pars, libTable, bamPairTable, ref);
-    InitSecondMapData(mapData, secondMapThread);
+    SecondMapThread secondMapThread(splitEvents, pars, libTable, bamPairTable, ref, chrom);
+    TaskPool taskPool(splitEvents.Size(), pars.numThread, SECOND_MAP_CHUNK_SIZE);
+    InitSecondMapData(mapData, secondMapThread, taskPool);
 
     // make the thread joinable
     pthread_attr_t attr;
@@ -567,7 +562,7 @@ void Aligner::SecondMap(void)
 
     for (int i = 0; i != pars.numThread; ++i)
     {
-        int ret = pthread_create(&(mapData.pTags[i].thread), &attr, &SecondMapThread::StartThread, (void*) &(mapData));
+        int ret = pthread_create(&(mapData.pTags[i].thread), &attr, &SecondMapThread::StartThread, (void*) &(mapData.pTags[i]));
         if (ret != 0)
             TGM_ErrQuit("ERROR: Unable to create threads.\n");
     }
@@ -581,37 +576,38 @@ void Aligner::SecondMap(void)
     }
 
     pthread_attr_destroy(&attr);
+
+    if (pars.showThreadTime)
+        taskPool.Report(stderr, "second map");
+
     DestroySecondMapData(mapData);
 }
 
-void Aligner::InitSecondMapData(SecondMapData& mapData, SecondMapThread& secondMapThread)
+void Aligner::InitSecondMapData(SecondMapData& mapData, SecondMapThread& secondMapThread, TaskPool& taskPool)
 {
-    mapData.currIdx = 0;
-    mapData.totalWorks = splitEvents.Size();
     mapData.pSecondMap = &secondMapThread;
+    mapData.pTaskPool = &taskPool;
 
     mapData.pTags = (SecondMapTag*) malloc(pars.numThread * sizeof(SecondMapTag));
     if (mapData.pTags == NULL)
         TGM_ErrQuit("ERROR: Not enough memory for the seoncd map tags.\n");
 
     for (int i = 0; i != pars.numThread; ++i)
+    {
         mapData.pTags[i].idx = i;
-
-    int status = pthread_mutex_init(&(mapData.mutex), NULL);
-    if (status != 0)
-        TGM_ErrQuit("ERROR: Cannot initiate the mutex of second map data.\n");
+        mapData.pTags[i].pMapData = &mapData;
+    }
 }
 
 void Aligner::DestroySecondMapData(SecondMapData& mapData)
 {
     free(mapData.pTags);
-    pthread_mutex_destroy(&(mapData.mutex));
 }
 
 void Aligner::Merge(void)
 {
     CountSplitEvents();
-    splitEvents.Sort(CompareSplitEvent);
+    splitEvents.StableSort(CompareSplitEvent);
 
     for (unsigned int i = SV_DELETION; i <= SV_INTER_CHR_TRNSLCTN; ++i)
     {
@@ -27,6 +27,7 @@
 #include "TGM_Parameters.h"
 #include "TGM_SplitData.h"
 #include "TGM_SecondMapThread.h"
+#include "TGM_TaskPool.h"
 
 namespace Tangram
 {
@@ -36,7 +37,7 @@ namespace Tangram
 
         public:
 
-            Aligner(Detector& detector, BamPairTable& bamPairTable, const AlignerPars& alignerPars, const Reference& ref, const LibTable& libTable);
+            Aligner(Detector& detector, BamPairTable& bamPairTable, const AlignerPars& alignerPars, const Reference& ref, const ChromView& chrom, const LibTable& libTable);
 
             ~Aligner();
 
@@ -96,7 +97,7 @@ namespace Tangram
             void InsertFirstPartial(Array<PrtlAlgnmnt>& firstPartials, const s_align* pAlignment, const RefRegion& refRegion, 
                                     unsigned int idx, bool isUpStream, PartialType partialType);
 
-            void InsertSoft(Array<PrtlAlgnmnt>& firstPartials, const SoftPair& softPair, unsigned int origIdx, unsigned int idx) const;
+            void InsertSoft(Array<PrtlAlgnmnt>& firstPartials, SoftPairs& softPairs, unsigned int origIdx, unsigned int idx) const;
 
             void CleanFirstPartials(Array<PrtlAlgnmnt>& firstPartials);
 
@@ -114,7 +115,7 @@ namespace Tangram
 
             void SecondMap(void);
 
-            void InitSecondMapData(SecondMapData& mapData, SecondMapThread& secondMap);
+            void InitSecondMapData(SecondMapData& mapData, SecondMapThread& secondMap, TaskPool& taskPool);
 
             void DestroySecondMapData(SecondMapData& mapData);
 
@@ -140,6 +141,8 @@ namespace Tangram
 
             const Reference& ref;
 
+            const ChromView& chrom;
+
             const LibTable& libTable;
 
             Array<int> svCount;
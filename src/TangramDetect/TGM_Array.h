@@ -41,6 +41,9 @@ namespace Tangram
             void ResizeNoCopy(unsigned int newCap);
             void Resize(unsigned int newCap);
 
+            // copy elements to the end of the array, the capacity is doubled when necessary
+            void Append(const T* src, unsigned int num);
+
             inline void Increment(void);
             inline void SetSize(unsigned int newSize);
             inline void Clear(void);
@@ -50,6 +53,11 @@ namespace Tangram
 
             void Sort(CompareFunc compare);
 
+            // stable natural merge sort, linear time on input that is already (nearly) sorted.
+            // equal elements keep their input order. qsort (Sort) does not promise that, so
+            // the order of ties may differ from what Sort gives with a given C library
+            void StableSort(CompareFunc compare);
+
             inline T& Last(void)
             {
                 return data[size - 1];
@@ -153,6 +161,19 @@ namespace Tangram
             size = newCap;
     }
 
+    template <class T> void Array<T>::Append(const T* src, unsigned int num)
+    {
+        if (num == 0)
+            return;
+
+        unsigned int newSize = size + num;
+        if (newSize > capacity)
+            Resize(newSize * 2);
+
+        memcpy(data + size, src, sizeof(T) * num);
+        size = newSize;
+    }
+
     template <class T> inline void Array<T>::Increment(void)
     {
         ++size;
@@ -184,6 +205,75 @@ namespace Tangram
         qsort(data, size, sizeof(T), compare);
     }
 
+    template <class T> void Array<T>::StableSort(CompareFunc compare)
+    {
+        unsigned int runEnd = 1;
+        while (runEnd < size && compare(data + runEnd - 1, data + runEnd) <= 0)
+            ++runEnd;
+
+        if (runEnd >= size)
+            return;
+
+        T* buffer = (T*) malloc(sizeof(T) * size);
+        if (buffer == NULL)
+        {
+            std::cerr << "ERROR: Not enough memory for sorting the array.\n";
+            exit(1);
+        }
+
+        T* src = data;
+        T* dst = buffer;
+        unsigned int numRuns = 0;
+
+        // merge the neighbouring ascending runs until only one is left
+        do
+        {
+            numRuns = 0;
+            for (unsigned int start = 0; start < size; ++numRuns)
+            {
+                unsigned int mid = start + 1;
+                while (mid < size && compare(src + mid - 1, src + mid) <= 0)
+                    ++mid;
+
+                unsigned int end = mid;
+                if (end < size)
+                {
+                    ++end;
+                    while (end < size && compare(src + end - 1, src + end) <= 0)
+                        ++end;
+                }
+
+                // take from the left run on ties to keep the sort stable
+                unsigned int i = start;
+                unsigned int j = mid;
+                unsigned int k = start;
+                while (i < mid && j < end)
+                {
+                    if (compare(src + j, src + i) < 0)
+                        dst[k++] = src[j++];
+                    else
+                        dst[k++] = src[i++];
+                }
+
+                memcpy(dst + k, src + i, sizeof(T) * (mid - i));
+                k += mid - i;
+                memcpy(dst + k, src + j, sizeof(T) * (end - j));
+
+                start = end;
+            }
+
+            T* temp = src;
+            src = dst;
+            dst = temp;
+
+        }while (numRuns > 1);
+
+        if (src != data)
+            memcpy(data, src, sizeof(T) * size);
+
+        free(buffer);
+    }
+
     template <class T> inline bool Array<T>::IsFull(void) const 
     {
         return (size == capacity);
@@ -23,8 +23,13 @@
 #define __STDC_LIMIT_MACROS
 #endif
 
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+
 #include <stdlib.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <cmath>
 #include <cstring>
 
@@ -58,26 +63,173 @@ BamPairTable::BamPairTable(const DetectPars& detectPars, const LibTable& inLibTa
     softPairs.Init(10);
 
     numInverted3 = 0;
+
+    numAlignments = 0;
+    numTagDecoded = 0;
+    numCharDecoded = 0;
+
+    lastReadGrpID = -1;
+    zaStr = NULL;
 }
 
 BamPairTable::~BamPairTable()
 {
     // kh_destroy(name, (khash_t(name)*) readNameHash);
-    unsigned int size = orphanPairs.Size();
-    for (unsigned int i = 0; i != size; ++i)
-        TGM_SeqClean(&(orphanPairs[i].read));
+}
+
+// move the elements of one pair array to the end of another one
+template <class T> static void MovePairs(Array<T>& dst, Array<T>& src)
+{
+    dst.Append(src.GetPointer(0), src.Size());
+    src.Clear();
+}
+
+// transfer a cigar operation into the bam format
+static uint32_t TransferCigarOp(const CigarOp& cigarOp)
+{
+    uint32_t cigar = cigarOp.Length;
+    cigar = cigar << BAM_CIGAR_SHIFT;
 
-    size = softPairs.Size();
-    for (unsigned int i = 0; i != size; ++i)
+    switch(cigarOp.Type)
     {
-        free(softPairs[i].cigar);
-        TGM_SeqClean(&(softPairs[i].read));
+        case 'D':
+            cigar |= BAM_CDEL;
+            break;
+        case 'H':
+            cigar |= BAM_CHARD_CLIP;
+            break;
+        case 'I':
+            cigar |= BAM_CINS;
+            break;
+        case 'M':
+            cigar |= BAM_CMATCH;
+            break;
+        case 'N':
+            cigar |= BAM_CREF_SKIP;
+            break;
+        case 'P':
+            cigar |= BAM_CPAD;
+            break;
+        case 'S':
+            cigar |= BAM_CSOFT_CLIP;
+            break;
+        default:
+            break;
     }
+
+    return cigar;
+}
+
+void OrphanPairs::Init(unsigned int capacity)
+{
+    readGrpIDs.Init(capacity);
+    anchorPos.Init(capacity);
+    anchorEnds.Init(capacity);
+    attrbts.Init(capacity);
+    reads.Init(capacity, capacity * 32);
+}
+
+void OrphanPairs::Add(int32_t readGrpID, int32_t pos, int32_t end, const OrphanAttrbt& attrbt, const string& read, bool isRevComp)
+{
+    readGrpIDs.Append(&readGrpID, 1);
+    anchorPos.Append(&pos, 1);
+    anchorEnds.Append(&end, 1);
+    attrbts.Append(&attrbt, 1);
+    reads.Add(read.c_str(), read.size(), isRevComp);
 }
 
-void BamPairTable::Update(const BamAlignment& alignment)
+void OrphanPairs::Append(OrphanPairs& other)
+{
+    MovePairs(readGrpIDs, other.readGrpIDs);
+    MovePairs(anchorPos, other.anchorPos);
+    MovePairs(anchorEnds, other.anchorEnds);
+    MovePairs(attrbts, other.attrbts);
+    reads.Append(other.reads);
+}
+
+void SoftPairs::Init(unsigned int capacity)
+{
+    readGrpIDs.Init(capacity);
+    pos.Init(capacity);
+    ends.Init(capacity);
+    matePos.Init(capacity);
+    attrbts.Init(capacity);
+    cigarOffsets.Init(capacity);
+    cigarLens.Init(capacity);
+    cigars.Init(capacity * 4);
+    reads.Init(capacity, capacity * 32);
+}
+
+void SoftPairs::Add(int32_t readGrpID, int32_t position, int32_t end, int32_t matePosition, const SoftAttrbt& attrbt,
+                    const vector<CigarOp>& cigarData, const string& read)
+{
+    readGrpIDs.Append(&readGrpID, 1);
+    pos.Append(&position, 1);
+    ends.Append(&end, 1);
+    matePos.Append(&matePosition, 1);
+    attrbts.Append(&attrbt, 1);
+
+    uint32_t cigarOffset = cigars.Size();
+    int32_t cigarLen = cigarData.size();
+    cigarOffsets.Append(&cigarOffset, 1);
+    cigarLens.Append(&cigarLen, 1);
+
+    for (int i = 0; i != cigarLen; ++i)
+    {
+        uint32_t cigar = TransferCigarOp(cigarData[i]);
+        cigars.Append(&cigar, 1);
+    }
+
+    reads.Add(read.c_str(), read.size(), false);
+}
+
+void SoftPairs::Append(SoftPairs& other)
+{
+    uint32_t shift = cigars.Size();
+    unsigned int start = cigarOffsets.Size();
+
+    MovePairs(readGrpIDs, other.readGrpIDs);
+    MovePairs(pos, other.pos);
+    MovePairs(ends, other.ends);
+    MovePairs(matePos, other.matePos);
+    MovePairs(attrbts, other.attrbts);
+    MovePairs(cigarOffsets, other.cigarOffsets);
+    MovePairs(cigarLens, other.cigarLens);
+    MovePairs(cigars, other.cigars);
+    reads.Append(other.reads);
+
+    unsigned int size = cigarOffsets.Size();
+    for (unsigned int i = start; i != size; ++i)
+        cigarOffsets[i] += shift;
+}
+
+void BamPairTable::Merge(BamPairTable& other)
+{
+    MovePairs(longPairs, other.longPairs);
+    MovePairs(shortPairs, other.shortPairs);
+    MovePairs(reversedPairs, other.reversedPairs);
+    MovePairs(invertedPairs, other.invertedPairs);
+    MovePairs(specialPairs, other.specialPairs);
+    orphanPairs.Append(other.orphanPairs);
+    softPairs.Append(other.softPairs);
+    coverage.Merge(other.coverage);
+
+    numInverted3 += other.numInverted3;
+    other.numInverted3 = 0;
+
+    numAlignments += other.numAlignments;
+    numTagDecoded += other.numTagDecoded;
+    numCharDecoded += other.numCharDecoded;
+
+    other.numAlignments = 0;
+    other.numTagDecoded = 0;
+    other.numCharDecoded = 0;
+}
+
+void BamPairTable::Update(BamAlignment& alignment)
 {
     pAlignment = &alignment;
+    ++numAlignments;
 
     if (BamPairFilter())
     {
@@ -87,6 +239,13 @@ void BamPairTable::Update(const BamAlignment& alignment)
         }
         else if (SetPairStat())
         {
+            if (coverage.IsOn() && pAlignment->RefID == pAlignment->MateRefID)
+            {
+                unsigned int sampleID = 0;
+                if (libTable.GetSampleID(sampleID, pairStat.readGrpID))
+                    coverage.Add(*pAlignment, sampleID, pairStat.readPairType);
+            }
+
             switch (pairStat.readPairType)
             {
                 case PT_NORMAL:
@@ -126,9 +285,10 @@ void BamPairTable::Update(const BamAlignment& alignment)
     }
 }
 
-PairType BamPairTable::CheckPairType(int32_t& readGrpID, const BamAlignment& alignment)
+PairType BamPairTable::CheckPairType(int32_t& readGrpID, BamAlignment& alignment)
 {
     pAlignment = &alignment;
+    ++numAlignments;
 
     if (BamPairFilter())
     {
@@ -148,6 +308,29 @@ PairType BamPairTable::CheckPairType(int32_t& readGrpID, const BamAlignment& ali
         return PT_UNKNOWN;
 }
 
+void BamPairTable::InitCoverage(const GenotypePars& genotypePars)
+{
+    if (genotypePars.doGenotype && genotypePars.binSize > 0)
+        coverage.Init(genotypePars.binSize, genotypePars.minMQ, genotypePars.minCrossLen, libTable.GetFragLenMax(), libTable.GetNumSamples());
+}
+
+void BamPairTable::ReportDecode(FILE* fpOutput, const char* name) const
+{
+    double tagRate = 0.0;
+    double charRate = 0.0;
+    if (numAlignments != 0)
+    {
+        tagRate = (double) numTagDecoded / numAlignments * 100.0;
+        charRate = (double) numCharDecoded / numAlignments * 100.0;
+    }
+
+    fprintf(fpOutput, "%s: %" PRIu64 " alignments, %" PRIu64 " tags decoded (%.2f%%), %" PRIu64 " sequences decoded (%.2f%%)\n", 
+            name, numAlignments, numTagDecoded, tagRate, numCharDecoded, charRate);
+
+    if (coverage.IsOn())
+        fprintf(fpOutput, "%s: %.2f MB of genotype counts in bins of %d bp\n", name, coverage.GetMemSize() / 1048576.0, coverage.GetBinSize());
+}
+
 bool BamPairTable::BamPairFilter(void) const
 {
     // filter out those alignment that:
@@ -157,13 +340,12 @@ bool BamPairTable::BamPairFilter(void) const
     // 4. failed the quality control
     // 5. is duplcated marked
     // 6. is not primary alignment
-    // 7. name is not valid
+    // only the core fields are checked here, the read name is checked after the tags are decoded
     if (!(*pAlignment).IsPaired() 
         || (!pAlignment->IsMapped() && !pAlignment->IsMateMapped()) 
         || (*pAlignment).RefID < 0 || pAlignment->MateRefID < 0
         // || pAlignment->IsFailedQC() || pAlignment->IsDuplicate() || !pAlignment->IsPrimaryAlignment()
-        || pAlignment->IsFailedQC() || pAlignment->IsDuplicate()
-        || pAlignment->Name == "0" || pAlignment->Name == "*") 
+        || pAlignment->IsFailedQC() || pAlignment->IsDuplicate())
     {
         return false;
     }
@@ -171,8 +353,35 @@ bool BamPairTable::BamPairFilter(void) const
     return true;
 }
 
+bool BamPairTable::LoadTagData(void)
+{
+    // the raw tags are only swapped by the full decoding
+    if (BamTools::SystemIsBigEndian() && !pAlignment->BuildCharData())
+        return false;
+
+    ++numTagDecoded;
+
+    // filter out those alignments whose name is not valid
+    const char* name = pAlignment->GetRawName();
+    if (strcmp(name, "0") == 0 || strcmp(name, "*") == 0)
+        return false;
+
+    return true;
+}
+
+void BamPairTable::LoadCharData(void)
+{
+    if (!pAlignment->BuildCharData())
+        TGM_ErrQuit("ERROR: Cannot decode the bam alignment: %s\n", pAlignment->GetErrorString().c_str());
+
+    ++numCharDecoded;
+}
+
 bool BamPairTable::SetPairStat(void)
 {
+    if (!LoadTagData())
+        return false;
+
     // initialize the special reference name
     pairStat.spRef[0][0] = ' ';
     pairStat.spRef[1][0] = ' ';
@@ -192,7 +401,7 @@ bool BamPairTable::SetPairStat(void)
         isUpMate = false;
 
     // parse the ZA string
-    if (pAlignment->GetTag("ZA", zaStr))
+    if ((zaStr = FindStringTag("ZA")) != NULL)
     {
         ParseZAstr(isUpMate);
     }
@@ -210,11 +419,8 @@ bool BamPairTable::SetPairStat(void)
     if (pairStat.orient == TGM_BAD_PAIR_MODE)
         return false;
 
-    if (pAlignment->GetTag("RG", readGrpName))
+    if (SetReadGrpID())
     {
-        if (!libTable.GetReadGrpID(pairStat.readGrpID, readGrpName.c_str()))
-            return false;
-
         // filter out those pairs whose libraries are not good
         unsigned int fragLenMedian = libTable.GetFragLenMedian(pairStat.readGrpID);
         if (fragLenMedian == 0)
@@ -237,11 +443,102 @@ bool BamPairTable::SetPairStat(void)
     return true;
 }
 
+const char* BamPairTable::FindStringTag(const char tag[2]) const
+{
+    unsigned int tagDataLength = 0;
+    const char* pTagData = pAlignment->GetRawTagData(tagDataLength);
+    const char* pTagEnd = pTagData + tagDataLength;
+
+    while (pTagData + 3 <= pTagEnd)
+    {
+        char type = pTagData[2];
+        bool isFound = (pTagData[0] == tag[0] && pTagData[1] == tag[1]);
+        pTagData += 3;
+
+        switch (type)
+        {
+            case 'A':
+            case 'c':
+            case 'C':
+                pTagData += 1;
+                break;
+            case 's':
+            case 'S':
+                pTagData += 2;
+                break;
+            case 'i':
+            case 'I':
+            case 'f':
+                pTagData += 4;
+                break;
+            case 'Z':
+            case 'H':
+                {
+                    const char* pStrEnd = (const char*) memchr(pTagData, '\0', pTagEnd - pTagData);
+                    if (pStrEnd == NULL)
+                        return NULL;
+
+                    if (isFound)
+                        return pTagData;
+
+                    pTagData = pStrEnd + 1;
+                }
+                break;
+            case 'B':
+                {
+                    if (pTagData + 5 > pTagEnd)
+                        return NULL;
+
+                    int32_t numElmnts = 0;
+                    memcpy(&numElmnts, pTagData + 1, sizeof(int32_t));
+
+                    unsigned int elmntSize = 4;
+                    if (pTagData[0] == 'c' || pTagData[0] == 'C')
+                        elmntSize = 1;
+                    else if (pTagData[0] == 's' || pTagData[0] == 'S')
+                        elmntSize = 2;
+
+                    pTagData += 5 + (int64_t) numElmnts * elmntSize;
+                }
+                break;
+            default:
+                return NULL;
+        }
+
+        // only the string tags are looked for
+        if (isFound)
+            return NULL;
+    }
+
+    return NULL;
+}
+
+bool BamPairTable::SetReadGrpID(void)
+{
+    const char* readGrpName = FindStringTag("RG");
+    if (readGrpName == NULL)
+        return false;
+
+    // the alignments of a bam file mostly come from the same read group one after another
+    if (lastReadGrpID < 0 || strcmp(readGrpName, lastReadGrpName.c_str()) != 0)
+    {
+        uint32_t readGrpID = 0;
+        if (!libTable.GetReadGrpID(readGrpID, readGrpName))
+            return false;
+
+        lastReadGrpName.assign(readGrpName);
+        lastReadGrpID = readGrpID;
+    }
+
+    pairStat.readGrpID = lastReadGrpID;
+    return true;
+}
+
 void BamPairTable::ParseZAstr(bool isUpMate)
 {
     unsigned char whichMate = 0;
     int numMappings = 0;
-    const char* currFieldPos = zaStr.c_str() + 1;
+    const char* currFieldPos = zaStr + 1;
     char mateSimbol = *currFieldPos;
 
     if ((*currFieldPos == '&' && isUpMate) || (*currFieldPos == '@' && !isUpMate))
@@ -317,7 +614,7 @@ void BamPairTable::ParseZAstr(bool isUpMate)
         else
         {
             pairStat.numMM[whichMate] = 0;
-            pairStat.end[whichMate] = pAlignment->MatePosition + pAlignment->QueryBases.length() - 1;
+            pairStat.end[whichMate] = pAlignment->MatePosition + pAlignment->Length - 1;
         }
     }
 
@@ -395,7 +692,7 @@ void BamPairTable::ParseZAstr(bool isUpMate)
         else
         {
             pairStat.numMM[whichMate] = 0;
-            pairStat.end[whichMate] = pAlignment->MatePosition + pAlignment->QueryBases.length() - 1;
+            pairStat.end[whichMate] = pAlignment->MatePosition + pAlignment->Length - 1;
         }
     }
 }
@@ -418,10 +715,10 @@ int BamPairTable::GetNumMismatchFromBam(int softSize[2])
         }
     }
 
-    string mdStr;
-    if (pAlignment->GetTag("MD", mdStr))
+    const char* mdStr = FindStringTag("MD");
+    if (mdStr != NULL)
     {
-        const char* mdFieldPos = mdStr.c_str();
+        const char* mdFieldPos = mdStr;
         while (mdFieldPos != NULL && *mdFieldPos != '\0')
         {
             if (isdigit(*mdFieldPos))
@@ -699,10 +996,7 @@ void BamPairTable::UpdateOrphanPair(void)
 
     if (!pAlignment->IsMapped())
     {
-        if (!pAlignment->GetTag("RG", readGrpName))
-            return;
-
-        if (!libTable.GetReadGrpID(pairStat.readGrpID, readGrpName.c_str()))
+        if (!LoadTagData() || !SetReadGrpID())
             return;
 
         // filter out those pairs whose libraries are not good
@@ -711,7 +1005,7 @@ void BamPairTable::UpdateOrphanPair(void)
             return;
 
         bool isUpMate = false;
-        if (pAlignment->GetTag("ZA", zaStr))
+        if ((zaStr = FindStringTag("ZA")) != NULL)
             ParseZAstr(isUpMate);
         else
             return;
@@ -719,41 +1013,31 @@ void BamPairTable::UpdateOrphanPair(void)
         if (pairStat.bestMQ[0] < detectPars.minMQ)
             return;
 
-        if (orphanPairs.IsFull())
-        {
-            orphanPairs.Resize(orphanPairs.Size() * 2);
-            orphanPairs.InitToEnd();
-        }
-
-        OrphanPair& newOrphanPair = orphanPairs.End();
-
-        newOrphanPair.bestMQ = pairStat.bestMQ[0];
-        newOrphanPair.readGrpID = pairStat.readGrpID;
-
-        newOrphanPair.anchorPos = pAlignment->MatePosition;
-        newOrphanPair.anchorEnd = pairStat.end[0];
-        newOrphanPair.refID = pAlignment->RefID;
+        OrphanAttrbt attrbt;
+        attrbt.bestMQ = pairStat.bestMQ[0];
+        attrbt.refID = pAlignment->RefID;
 
         if (pAlignment->IsSecondMate())
         {
             if (pAlignment->IsMateReverseStrand())
-                newOrphanPair.aOrient = TGM_1R;
+                attrbt.aOrient = TGM_1R;
             else
-                newOrphanPair.aOrient = TGM_1F;
+                attrbt.aOrient = TGM_1F;
         }
         else
         {
             if (pAlignment->IsMateReverseStrand())
-                newOrphanPair.aOrient = TGM_2R;
+                attrbt.aOrient = TGM_2R;
             else
-                newOrphanPair.aOrient = TGM_2F;
+                attrbt.aOrient = TGM_2F;
         }
 
-        TGM_SeqCpy(&(newOrphanPair.read), pAlignment->QueryBases.c_str(), pAlignment->QueryBases.size());
-	if (pAlignment->IsReverseStrand())
-	  TGM_SeqRevComp(&(newOrphanPair.read));
+        // the read is stored in the orientation of the split alignment:
+        // as it was sequenced, reverse complemented when the anchor mate is on the forward strand
+        bool isRevComp = (pAlignment->IsReverseStrand() != !pAlignment->IsMateReverseStrand());
 
-        orphanPairs.Increment();
+        LoadCharData();
+        orphanPairs.Add(pairStat.readGrpID, pAlignment->MatePosition, pairStat.end[0], attrbt, pAlignment->QueryBases, isRevComp);
     }
 }
 
@@ -867,10 +1151,8 @@ void BamPairTable::UpdateLocalPair(Array<LocalPair>& localPairs)
     newLocalPair.bestMQ[0] = pairStat.bestMQ[0];
     newLocalPair.bestMQ[1] = pairStat.bestMQ[1];
 
-    uint32_t fragLenMedian = libTable.GetFragLenMedian(pairStat.readGrpID);
-
     if (pairStat.readPairType != PT_REVERSED)
-        newLocalPair.fragLenQual = fragLenTable.GetQuality(pairStat.readGrpID, pairStat.fragLen, fragLenMedian);
+        newLocalPair.fragLenQual = fragLenTable.GetQuality(pairStat.readGrpID, pairStat.fragLen);
     else
         newLocalPair.fragLenQual = INVALID_FRAG_LEN_QUAL;
 
@@ -942,93 +1224,37 @@ void BamPairTable::UpdateCrossPair(void)
 
 void BamPairTable::UpdateSoftPair(void)
 {
-    if (softPairs.IsFull())
-    {
-        softPairs.Resize(softPairs.Size() * 2);
-        softPairs.InitToEnd();
-    }
-
-    SoftPair& newSoftPair = softPairs.End();
-
-    newSoftPair.readGrpID = pairStat.readGrpID;
-    newSoftPair.refID = pAlignment->RefID;
-
-    newSoftPair.pos = pAlignment->Position;
-    newSoftPair.matePos = pAlignment->MatePosition;
-
-    if (newSoftPair.pos <= newSoftPair.matePos)
+    int32_t end = 0;
+    if (pAlignment->Position <= pAlignment->MatePosition)
     {
         if (pairStat.bestMQ[1] < detectPars.minMQ)
             return;
 
-        newSoftPair.end = pairStat.end[0];
+        end = pairStat.end[0];
     }
     else
     {
         if (pairStat.bestMQ[0] < detectPars.minMQ)
             return;
 
-        newSoftPair.end = pairStat.end[1];
+        end = pairStat.end[1];
     }
 
-    newSoftPair.readPairType = pairStat.readPairType;
-    newSoftPair.orient = pairStat.orient;
+    SoftAttrbt attrbt;
+    attrbt.refID = pAlignment->RefID;
+    attrbt.readPairType = pairStat.readPairType;
+    attrbt.orient = pairStat.orient;
 
     if (pAlignment->IsReverseStrand())
-        newSoftPair.sStrand = 1;
+        attrbt.sStrand = 1;
     else
-        newSoftPair.sStrand = 0;
+        attrbt.sStrand = 0;
 
     if (pAlignment->IsMateReverseStrand())
-        newSoftPair.aStrand = 1;
+        attrbt.aStrand = 1;
     else
-        newSoftPair.aStrand = 0;
-
-    newSoftPair.cigarLen = pAlignment->CigarData.size();
-    newSoftPair.cigar = TransferCigar(pAlignment->CigarData);
-
-    TGM_SeqCpy(&(newSoftPair.read), pAlignment->QueryBases.c_str(), pAlignment->QueryBases.size());
-    softPairs.Increment();
-}
-
-uint32_t* BamPairTable::TransferCigar(const std::vector<BamTools::CigarOp>& cigarData)
-{
-    uint32_t* cigar = (uint32_t*) malloc(sizeof(uint32_t) * cigarData.size());
-    if (cigar == NULL)
-        TGM_ErrQuit("ERROR: Not enough memory for the cigar string.\n");
-
-    for (unsigned int i = 0; i != cigarData.size(); ++i)
-    {
-        cigar[i] = cigarData[i].Length;
-        cigar[i] = cigar[i] << BAM_CIGAR_SHIFT;
+        attrbt.aStrand = 0;
 
-        switch(cigarData[i].Type)
-        {
-            case 'D':
-                cigar[i] |= BAM_CDEL;
-                break;
-            case 'H':
-                cigar[i] |= BAM_CHARD_CLIP;
-                break;
-            case 'I':
-                cigar[i] |= BAM_CINS;
-                break;
-            case 'M':
-                cigar[i] |= BAM_CMATCH;
-                break;
-            case 'N':
-                cigar[i] |= BAM_CREF_SKIP;
-                break;
-            case 'P':
-                cigar[i] |= BAM_CPAD;
-                break;
-            case 'S':
-                cigar[i] |= BAM_CSOFT_CLIP;
-                break;
-            default:
-                break;
-        }
-    }
-
-    return cigar;
+    LoadCharData();
+    softPairs.Add(pairStat.readGrpID, pAlignment->Position, end, pAlignment->MatePosition, attrbt, pAlignment->CigarData, pAlignment->QueryBases);
 }
@@ -26,7 +26,9 @@
 #include "TGM_Parameters.h"
 #include "TGM_LibTable.h"
 #include "TGM_Sequence.h"
+#include "TGM_ReadArena.h"
 #include "TGM_FragLenTable.h"
+#include "TGM_FragCoverage.h"
 
 #define BAM_CIGAR_SHIFT 4
 #define BAM_CIGAR_MASK  ((1 << BAM_CIGAR_SHIFT) - 1)
@@ -221,37 +223,92 @@ namespace Tangram
         uint32_t specialID:16, pairType:8, orient:6, aStrand:1, sStrand:1;   // special reference ID, pair type, pair orientation, anchor mate strand, mutiple mate strand
     };
 
-    // orphan pair structure (one mate is unique the other mate is unmapped)
-    struct OrphanPair
+    // attributes of an orphan pair
+    struct OrphanAttrbt
     {
-        int32_t readGrpID;                        // read group ID
+        int32_t refID:20, aOrient:4, bestMQ:8;    // reference ID, anchor mate orientation, mapping quality
+    };
+
+    // orphan pairs (one mate is unique the other mate is unmapped) stored column by column
+    class OrphanPairs
+    {
+        public:
+            void Init(unsigned int capacity);
 
-        int32_t anchorPos;                        // mapping position of the anchor mate
+            void Add(int32_t readGrpID, int32_t pos, int32_t end, const OrphanAttrbt& attrbt, const std::string& read, bool isRevComp);
 
-        int32_t anchorEnd;                        // mapping end of the anchor mate
+            // move the pairs of another table to the end of this one
+            void Append(OrphanPairs& other);
 
-        int32_t refID:20, aOrient:4, bestMQ:8;    // reference ID, anchor mate orientation, mapping quality
+            inline unsigned int Size(void) const
+            {
+                return readGrpIDs.Size();
+            }
+
+        public:
+            Array<int32_t> readGrpIDs;                // read group ID
+
+            Array<int32_t> anchorPos;                 // mapping position of the anchor mate
+
+            Array<int32_t> anchorEnds;                // mapping end of the anchor mate
 
-        TGM_Sequence read;                        // read sequence of the orphan read
+            Array<OrphanAttrbt> attrbts;              // reference ID, anchor mate orientation, mapping quality
+
+            ReadArena reads;                          // sequence of the orphan read, oriented for the split alignment
     };
 
-    struct SoftPair
+    // attributes of a soft pair
+    struct SoftAttrbt
     {
-        int32_t readGrpID;                                                    // read group ID
-
         uint32_t refID:16, readPairType:8, orient:6, aStrand:1, sStrand:1;    // reference ID, read pair type, pair orientation, anchor mate strand, soft mate strand
+    };
+
+    // soft pairs (one mate is unique the other mate is soft clipped) stored column by column
+    class SoftPairs
+    {
+        public:
+            void Init(unsigned int capacity);
+
+            void Add(int32_t readGrpID, int32_t position, int32_t end, int32_t matePosition, const SoftAttrbt& attrbt,
+                     const std::vector<BamTools::CigarOp>& cigarData, const std::string& read);
+
+            // move the pairs of another table to the end of this one
+            void Append(SoftPairs& other);
+
+            inline unsigned int Size(void) const
+            {
+                return readGrpIDs.Size();
+            }
 
-        int32_t pos;                                                          // mapping position of anchor mate
+            // cigar of the soft mate (bam format)
+            inline uint32_t* GetCigar(unsigned int idx)
+            {
+                return cigars.GetPointer(cigarOffsets[idx]);
+            }
+
+            inline const uint32_t* GetCigar(unsigned int idx) const
+            {
+                return cigars.GetPointer(cigarOffsets[idx]);
+            }
+
+        public:
+            Array<int32_t> readGrpIDs;                // read group ID
+
+            Array<int32_t> pos;                       // mapping position of anchor mate
+
+            Array<int32_t> ends;                      // mapping end of the anchor mate
 
-        int32_t end;                                                          // mapping end of the anchor mate
+            Array<int32_t> matePos;                   // mapping position of the soft mate
 
-        int32_t matePos;                                                      // mapping position of the soft mate
+            Array<SoftAttrbt> attrbts;                // reference ID, read pair type, pair orientation, strands
 
-        uint32_t* cigar;                                                      // cigar information of the soft mate
+            Array<uint32_t> cigarOffsets;             // offset of the cigar of the soft mate in the cigar buffer
 
-        int32_t cigarLen;                                                     // cigar length
+            Array<int32_t> cigarLens;                 // cigar length
 
-        TGM_Sequence read;                                                    // read sequence of the soft mate
+            Array<uint32_t> cigars;                   // cigars of all the soft mates
+
+            ReadArena reads;                          // sequence of the soft mate
     };
 
     typedef struct
@@ -269,9 +326,21 @@ namespace Tangram
             ~BamPairTable();
 
             // update the bam pair table with the incoming alignment
-            void Update(const BamTools::BamAlignment& alignment);
+            // the alignment may be a core-only one (BamMultiReader::GetNextAlignmentCore)
+            // its tags and sequence are only decoded when they are needed
+            void Update(BamTools::BamAlignment& alignment);
+
+            PairType CheckPairType(int32_t& readGrpID, BamTools::BamAlignment& alignment);
+
+            // count the genotyping fragments while the table is updated (genotype bin size -gb)
+            void InitCoverage(const GenotypePars& genotypePars);
 
-            PairType CheckPairType(int32_t& readGrpID, const BamTools::BamAlignment& alignment);
+            // print the number of alignments read and decoded by this table
+            void ReportDecode(FILE* fpOutput, const char* name) const;
+
+            // move all the pairs of another table to the end of this table
+            // the other table is left empty and keeps its memory for reuse
+            void Merge(BamPairTable& other);
 
         private:
 
@@ -287,9 +356,21 @@ namespace Tangram
                 return false;
             }
 
+            // check the read name of the alignment, its tags are then read in place by FindStringTag
+            bool LoadTagData(void);
+
+            // decode the sequence of the alignment
+            void LoadCharData(void);
+
             // set the pair status with the information from a bam alignment
             bool SetPairStat(void);
 
+            // find a string tag in the raw tag data of the bam alignment without copying it
+            const char* FindStringTag(const char tag[2]) const;
+
+            // set the read group ID of the pair from the RG tag
+            bool SetReadGrpID(void);
+
             // parse the za tag in the bam alignment
             void ParseZAstr(bool isUpMate);
 
@@ -323,9 +404,6 @@ namespace Tangram
             // update the soft pair array
             void UpdateSoftPair(void);
 
-            // transfer the cigar format
-            uint32_t* TransferCigar(const std::vector<BamTools::CigarOp>& cigarData);
-
         public:
             // long pair array (deletions)
             Array<LocalPair> longPairs;
@@ -342,14 +420,26 @@ namespace Tangram
             // special pair array (MEI insertions)
             Array<SpecialPair> specialPairs;
 
-            // orphan pair array (candidates for split read algorithm)
-            Array<OrphanPair> orphanPairs;
+            // orphan pairs (candidates for split read algorithm)
+            OrphanPairs orphanPairs;
 
-            // soft pair array (candidates for split read algorithm)
-            Array<SoftPair> softPairs;
+            // soft pairs (candidates for split read algorithm)
+            SoftPairs softPairs;
+
+            // binned counts of the fragments used for genotyping
+            FragCoverage coverage;
 
             int numInverted3;
 
+            // number of alignments passed to this table
+            uint64_t numAlignments;
+
+            // number of alignments whose read name and tags are decoded
+            uint64_t numTagDecoded;
+
+            // number of alignments whose sequence is decoded
+            uint64_t numCharDecoded;
+
         private:
 
             // void* readNameHash;
@@ -368,16 +458,18 @@ namespace Tangram
             const FragLenTable& fragLenTable;
 
             // pointer to the incoming bam alignment
-            const BamTools::BamAlignment* pAlignment;
+            BamTools::BamAlignment* pAlignment;
 
             // bam pair status
             BamPairStat pairStat;
 
-            // read group name
-            std::string readGrpName;
+            // the read group found in the last alignment and its ID (-1 if there is none yet)
+            std::string lastReadGrpName;
+
+            int64_t lastReadGrpID;
 
-            // ZA string
-            std::string zaStr;
+            // ZA string in the tag data of the current alignment
+            const char* zaStr;
     };
 };
 
@@ -0,0 +1,154 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_BamPairThread.cpp
+ *
+ *    Description:  Fill the bam pair table with multiple threads
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 03:35:56 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+#include <stdlib.h>
+#include <new>
+
+#include "TGM_Error.h"
+#include "TGM_BamPairThread.h"
+
+using namespace std;
+using namespace BamTools;
+using namespace Tangram;
+
+BamPairThread::BamPairThread(const DetectPars& detectPars, const LibTable& libTable, const FragLenTable& fragLenTable)
+{
+    numThread = detectPars.numThread;
+
+    bamPairData = (BamPairData*) malloc(numThread * sizeof(BamPairData));
+    if (bamPairData == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the bam pair thread data.\n");
+
+    for (int i = 0; i != numThread; ++i)
+    {
+        bamPairData[i].alignments = NULL;
+        bamPairData[i].size = 0;
+        bamPairData[i].pBamPairTable = new (std::nothrow) BamPairTable(detectPars, libTable, fragLenTable);
+        if (bamPairData[i].pBamPairTable == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the bam pair table of a thread.\n");
+    }
+
+    for (unsigned int i = 0; i != 2; ++i)
+    {
+        batches[i] = new (std::nothrow) BamAlignment[DEFAULT_BAM_BATCH_SIZE];
+        if (batches[i] == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the batch of bam alignments.\n");
+    }
+}
+
+BamPairThread::~BamPairThread()
+{
+    for (int i = 0; i != numThread; ++i)
+        delete bamPairData[i].pBamPairTable;
+
+    free(bamPairData);
+
+    delete [] batches[0];
+    delete [] batches[1];
+}
+
+void BamPairThread::Load(BamPairTable& bamPairTable, BamMultiReader& bamMultiReader)
+{
+    // the thread tables count the genotyping fragments like the final one
+    const FragCoverage& coverage = bamPairTable.coverage;
+    if (coverage.IsOn())
+    {
+        for (int i = 0; i != numThread; ++i)
+            bamPairData[i].pBamPairTable->coverage.Init(coverage.GetBinSize(), coverage.GetMinMQ(), coverage.GetMinCrossLen(),
+                                                             coverage.GetMaxGap(), coverage.GetNumSamples());
+    }
+
+    unsigned int curr = 0;
+    unsigned int batchSize = ReadBatch(batches[curr], bamMultiReader);
+
+    while (batchSize > 0)
+    {
+        StartBatch(batches[curr], batchSize);
+
+        // read the next batch while the current one is classified
+        curr = 1 - curr;
+        batchSize = ReadBatch(batches[curr], bamMultiReader);
+
+        FinishBatch(bamPairTable);
+    }
+}
+
+void* BamPairThread::StartThread(void* threadData)
+{
+    BamPairData* pData = (BamPairData*) threadData;
+
+    for (unsigned int i = 0; i != pData->size; ++i)
+    {
+        pData->pBamPairTable->Update(pData->alignments[i]);
+    }
+
+    pthread_exit(NULL);
+}
+
+unsigned int BamPairThread::ReadBatch(BamAlignment* alignments, BamMultiReader& bamMultiReader)
+{
+    unsigned int size = 0;
+    while (size != DEFAULT_BAM_BATCH_SIZE && bamMultiReader.GetNextAlignmentCore(alignments[size]))
+        ++size;
+
+    return size;
+}
+
+void BamPairThread::StartBatch(BamAlignment* alignments, unsigned int batchSize)
+{
+    // make the thread joinable
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+
+    unsigned int start = 0;
+    unsigned int shareSize = batchSize / numThread;
+    unsigned int shareRemainder = batchSize % numThread;
+
+    for (int i = 0; i != numThread; ++i)
+    {
+        bamPairData[i].alignments = alignments + start;
+        bamPairData[i].size = shareSize;
+
+        if (shareRemainder != 0)
+        {
+            bamPairData[i].size += 1;
+            --shareRemainder;
+        }
+
+        start += bamPairData[i].size;
+
+        int ret = pthread_create(&(bamPairData[i].thread), &attr, &BamPairThread::StartThread, (void*) &(bamPairData[i]));
+        if (ret != 0)
+            TGM_ErrQuit("ERROR: Unable to create threads.\n");
+    }
+
+    pthread_attr_destroy(&attr);
+}
+
+void BamPairThread::FinishBatch(BamPairTable& bamPairTable)
+{
+    for (int i = 0; i != numThread; ++i)
+    {
+        void* status;
+        int ret = pthread_join(bamPairData[i].thread, &status);
+        if (ret != 0)
+            TGM_ErrQuit("ERROR: Unable to join threads.\n");
+    }
+
+    // merge in the order of the segments to keep the order of a serial scan
+    for (int i = 0; i != numThread; ++i)
+        bamPairTable.Merge(*(bamPairData[i].pBamPairTable));
+}
@@ -0,0 +1,82 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_BamPairThread.h
+ *
+ *    Description:  Fill the bam pair table with multiple threads
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 03:35:56 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+#ifndef  TGM_BAMPAIRTHREAD_H
+#define  TGM_BAMPAIRTHREAD_H
+
+#include <pthread.h>
+
+#include "api/BamMultiReader.h"
+
+#include "TGM_BamPair.h"
+#include "TGM_Parameters.h"
+#include "TGM_LibTable.h"
+#include "TGM_FragLenTable.h"
+
+namespace Tangram
+{
+    // number of alignments read in one batch
+    static const unsigned int DEFAULT_BAM_BATCH_SIZE = 32768;
+
+    typedef struct
+    {
+        pthread_t thread;
+
+        BamTools::BamAlignment* alignments;
+
+        unsigned int size;
+
+        BamPairTable* pBamPairTable;
+
+    }BamPairData;
+
+    // The main thread reads the alignments batch by batch, and only the core
+    // data of an alignment is decoded at that point. While the next batch is
+    // being read, the classifier threads split the current batch into
+    // contiguous segments, decode the rest of their alignments (name, bases,
+    // qualities and tags) and classify them into their own bam pair tables.
+    // These tables are then merged into the output table in the order of the
+    // segments, so the result is the same as a serial scan.
+    class BamPairThread
+    {
+        public:
+            BamPairThread(const DetectPars& detectPars, const LibTable& libTable, const FragLenTable& fragLenTable);
+            ~BamPairThread();
+
+            void Load(BamPairTable& bamPairTable, BamTools::BamMultiReader& bamMultiReader);
+
+            static void* StartThread(void* threadData);
+
+        private:
+
+            unsigned int ReadBatch(BamTools::BamAlignment* alignments, BamTools::BamMultiReader& bamMultiReader);
+
+            void StartBatch(BamTools::BamAlignment* alignments, unsigned int batchSize);
+
+            void FinishBatch(BamPairTable& bamPairTable);
+
+        private:
+
+            int numThread;
+
+            // classifier thread data and their own bam pair tables
+            BamPairData* bamPairData;
+
+            // two batches take turns: one is read while the other is classified
+            BamTools::BamAlignment* batches[2];
+    };
+};
+
+#endif  /*TGM_BAMPAIRTHREAD_H*/
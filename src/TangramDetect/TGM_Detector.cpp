@@ -254,7 +254,7 @@ void Detector::MakeInversions(void)
         }
     }
 
-    invEvents[0].Sort(CompareInversion);
+    invEvents[0].StableSort(CompareInversion);
 
     // loop over the 5' clusters (5' of the fragment is in the inverted region)
     for (unsigned int i = 0; i != numEvents5; ++i)
@@ -361,7 +361,7 @@ void Detector::MakeInversions(void)
         }
     }
 
-    invEvents[1].Sort(CompareInversion);
+    invEvents[1].StableSort(CompareInversion);
 }
 
 bool Detector::IsInvOverlapped(const Inversion& prevInv, const Inversion& newInv)
@@ -662,7 +662,7 @@ void Detector::MakeSpecialEvents(Array<SpecialEvent>& specialEvents)
         pSpecialEvent->posUncertainty = DoubleRoundToInt((double) ((endMax5 - posMin5) + (endMax3 - posMin3)) / (double) (2 * pClusterElmnt->numReadPair));
     }
 
-    specialEvents.Sort(CompareSpecialEvents);
+    specialEvents.StableSort(CompareSpecialEvents);
 }
 
 void Detector::MergeSpecialEvents(Array<SpecialEvent>& specialEvents)
@@ -705,7 +705,7 @@ void Detector::MergeSpecialEvents(Array<SpecialEvent>& specialEvents)
     }
 
     specialEvents.SetSize(newSize);
-    specialEvents.Sort(CompareSpecialEvents);
+    specialEvents.StableSort(CompareSpecialEvents);
 }
 
 void Detector::DoSpecialMerge(SpecialEvent* pMergedEvent, const SpecialEvent* pHeadEvent, const SpecialEvent* pTailEvent)
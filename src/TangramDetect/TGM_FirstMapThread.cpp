@@ -25,6 +25,7 @@
 #endif
 
 #include <limits.h>
+#include "TGM_ProfilePool.h"
 #include "TGM_FirstMapThread.h"
 
 using namespace Tangram;
@@ -58,8 +59,8 @@ static void CigarToString(std::string& cigarStr, const uint32_t* cigar, unsigned
 
 #endif
 
-FirstMapThread::FirstMapThread(const AlignerPars& pars, const LibTable& libInfoTable, const BamPairTable& pairTable, const Reference& reference)
-                              : alignerPars(pars), libTable(libInfoTable), bamPairTable(pairTable), ref(reference)
+FirstMapThread::FirstMapThread(const AlignerPars& pars, const LibTable& libInfoTable, const BamPairTable& pairTable, const ChromView& chrom)
+                              : alignerPars(pars), libTable(libInfoTable), bamPairTable(pairTable), chrom(chrom)
 {
 
 }
@@ -84,128 +85,143 @@ void* FirstMapThread::StartThread(void* threadData)
 #endif
 
     RescuePartial rescuePartial(firstMap.alignerPars);
+    ProfilePool profilePool(firstMap.alignerPars.mat);
 
-    for (unsigned int i = 0; i != mapData->orphanSize; ++i)
-    {
-        OrphanPair& orphanPair = mapData->orphanPairs[i];
-        RefRegion& refRegion = mapData->refRegions[i];
+    // the reference region of a packed reference is unpacked here
+    Array<int8_t> refBuffer;
 
-        switch (orphanPair.aOrient)
-        {
-            case TGM_1F:
-            case TGM_2F:
-                isUpStream = false;
-                TGM_SeqRevComp(&(orphanPair.read));
-                isOK = firstMap.SetFirstRefRegion(refRegion, orphanPair.anchorPos, orphanPair.anchorEnd, orphanPair.readGrpID, orphanPair.read.len, isUpStream);
-                break;
-            case TGM_1R:
-            case TGM_2R:
-                isUpStream = true;
-                isOK = firstMap.SetFirstRefRegion(refRegion, orphanPair.anchorPos, orphanPair.anchorEnd, orphanPair.readGrpID, orphanPair.read.len, isUpStream);
-                break;
-            default:
-                isOK = false;
-                break;
-        }
+    const OrphanPairs& orphanPairs = firstMap.bamPairTable.orphanPairs;
 
-        const AlignerPars& alignerPars = firstMap.alignerPars;
-        PrtlAlgnmnt& partial = mapData->firstPartials[i];
+    unsigned int chunkBegin = 0;
+    unsigned int chunkEnd = 0;
 
-        if (isOK)
+    while (mapData->pTaskPool->GetChunk(chunkBegin, chunkEnd, mapData->idx))
+    {
+        for (unsigned int i = chunkBegin; i != chunkEnd; ++i)
         {
-            s_profile* pProfile = ssw_init(orphanPair.read.seq, orphanPair.read.len, alignerPars.mat, 5, 2);
-            s_align* pAlignment = ssw_align(pProfile, refRegion.pRef, refRegion.len, alignerPars.gapOpen, 
-                                            alignerPars.gapExt, alignerPars.flag, alignerPars.scoreFilter, alignerPars.distFilter, orphanPair.read.len);
+            RefRegion& refRegion = mapData->refRegions[i];
 
-            PartialType partialType;
-            bool isRescued = false;
+            int32_t anchorPos = orphanPairs.anchorPos[i];
+            int32_t anchorEnd = orphanPairs.anchorEnds[i];
+            int32_t readGrpID = orphanPairs.readGrpIDs[i];
+            unsigned int readLen = orphanPairs.reads.GetLen(i);
 
-            bool passFilter = firstMap.FirstFilter(partialType, isRescued, rescuePartial, pAlignment, orphanPair, refRegion);
-            
-            if (passFilter)
+            // the read is already reverse complemented in the arena for a downstream alignment
+            switch (orphanPairs.attrbts[i].aOrient)
+            {
+                case TGM_1F:
+                case TGM_2F:
+                    isUpStream = false;
+                    isOK = firstMap.SetFirstRefRegion(refRegion, refBuffer, anchorPos, anchorEnd, readGrpID, readLen, isUpStream);
+                    break;
+                case TGM_1R:
+                case TGM_2R:
+                    isUpStream = true;
+                    isOK = firstMap.SetFirstRefRegion(refRegion, refBuffer, anchorPos, anchorEnd, readGrpID, readLen, isUpStream);
+                    break;
+                default:
+                    isOK = false;
+                    break;
+            }
+
+            const AlignerPars& alignerPars = firstMap.alignerPars;
+            PrtlAlgnmnt& partial = mapData->firstPartials[i];
+
+            if (isOK)
             {
-                if (!isRescued)
+                const s_profile* pProfile = profilePool.GetProfile(orphanPairs.reads, i, 0);
+                s_align* pAlignment = ssw_align(pProfile, refRegion.pRef, refRegion.len, alignerPars.gapOpen, 
+                                                alignerPars.gapExt, alignerPars.flag, alignerPars.scoreFilter, alignerPars.distFilter, readLen);
+
+                PartialType partialType;
+                bool isRescued = false;
+
+                const int8_t* readSeq = profilePool.GetSeq(orphanPairs.reads, i, 0);
+                bool passFilter = firstMap.FirstFilter(partialType, isRescued, rescuePartial, pAlignment, readSeq, readLen, refRegion);
+            
+                if (passFilter)
                 {
-                    partial.refPos = pAlignment->ref_begin1 + refRegion.start;
-                    partial.refEnd = pAlignment->ref_end1 + refRegion.start;
-                    partial.readPos = pAlignment->read_begin1;
-                    partial.readEnd = pAlignment->read_end1;
-                    partial.cigar = pAlignment->cigar;
-                    partial.cigarLen = pAlignment->cigarLen;
+                    if (!isRescued)
+                    {
+                        partial.refPos = pAlignment->ref_begin1 + refRegion.start;
+                        partial.refEnd = pAlignment->ref_end1 + refRegion.start;
+                        partial.readPos = pAlignment->read_begin1;
+                        partial.readEnd = pAlignment->read_end1;
+                        partial.cigar = pAlignment->cigar;
+                        partial.cigarLen = pAlignment->cigarLen;
+
+#ifdef DEBUG
+                    CigarToString(cigarStr, pAlignment->cigar, pAlignment->cigarLen);
+                    printf("chr%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%s\n", orphanPairs.attrbts[i].refID + 1, anchorPos, anchorEnd + 1, refRegion.start, 
+                            refRegion.start + refRegion.len, pAlignment->ref_begin1 + refRegion.start, pAlignment->ref_end1 + refRegion.start, pAlignment->read_begin1, 
+                            pAlignment->read_end1, pAlignment->score1, cigarStr.c_str());
+#endif
+
+                        free(pAlignment);
+                    }
+                    else
+                    {
 
 #ifdef DEBUG
-                CigarToString(cigarStr, pAlignment->cigar, pAlignment->cigarLen);
-                printf("chr%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%s\n", orphanPair.refID + 1, orphanPair.anchorPos, orphanPair.anchorEnd + 1, refRegion.start, 
-                        refRegion.start + refRegion.len, pAlignment->ref_begin1 + refRegion.start, pAlignment->ref_end1 + refRegion.start, pAlignment->read_begin1, 
-                        pAlignment->read_end1, pAlignment->score1, cigarStr.c_str());
+                        CigarToString(cigarStr, pAlignment->cigar, pAlignment->cigarLen);
+                        printf("chr%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%s\t", orphanPairs.attrbts[i].refID + 1, anchorPos, anchorEnd + 1, refRegion.start, 
+                                refRegion.start + refRegion.len, pAlignment->ref_begin1 + refRegion.start, pAlignment->ref_end1 + refRegion.start, pAlignment->read_begin1, 
+                                pAlignment->read_end1, pAlignment->score1, cigarStr.c_str());
+
+                        CigarToString(cigarStr, rescuePartial.cigar, rescuePartial.cigarLen);
+                        printf("%s\n", cigarStr.c_str());
 #endif
 
-                    free(pAlignment);
+                        align_destroy(pAlignment);
+
+                        partial.refPos = rescuePartial.refPos + refRegion.start;
+                        partial.refEnd = rescuePartial.refEnd + refRegion.start;
+                        partial.readPos = rescuePartial.readPos;
+                        partial.readEnd = rescuePartial.readEnd;
+                        partial.cigar = rescuePartial.cigar;
+                        partial.cigarLen = rescuePartial.cigarLen;
+
+                        isRescued = false;
+                        rescuePartial.Clear();
+                    }
+
+                    partial.origIdx = i;
+                    partial.isReversed = isUpStream ? 0 : 1;
+                    partial.isSoft = 0;
+                    partial.partialType = partialType;
+
                 }
                 else
                 {
 
 #ifdef DEBUG
                     CigarToString(cigarStr, pAlignment->cigar, pAlignment->cigarLen);
-                    printf("chr%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%s\t", orphanPair.refID + 1, orphanPair.anchorPos, orphanPair.anchorEnd + 1, refRegion.start, 
+                    printf("chr%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%s\n", orphanPairs.attrbts[i].refID + 1, anchorPos, anchorEnd + 1, refRegion.start, 
                             refRegion.start + refRegion.len, pAlignment->ref_begin1 + refRegion.start, pAlignment->ref_end1 + refRegion.start, pAlignment->read_begin1, 
                             pAlignment->read_end1, pAlignment->score1, cigarStr.c_str());
-
-                    CigarToString(cigarStr, rescuePartial.cigar, rescuePartial.cigarLen);
-                    printf("%s\n", cigarStr.c_str());
 #endif
 
+                    partial.cigar = NULL;
+                    partial.refPos = INT32_MAX;
                     align_destroy(pAlignment);
-
-                    partial.refPos = rescuePartial.refPos + refRegion.start;
-                    partial.refEnd = rescuePartial.refEnd + refRegion.start;
-                    partial.readPos = rescuePartial.readPos;
-                    partial.readEnd = rescuePartial.readEnd;
-                    partial.cigar = rescuePartial.cigar;
-                    partial.cigarLen = rescuePartial.cigarLen;
-
-                    isRescued = false;
-                    rescuePartial.Clear();
                 }
-
-                partial.origIdx = i + mapData->orphanStart;
-                partial.isReversed = isUpStream ? 0 : 1;
-                partial.isSoft = 0;
-                partial.partialType = partialType;
-
             }
             else
             {
-
-#ifdef DEBUG
-                CigarToString(cigarStr, pAlignment->cigar, pAlignment->cigarLen);
-                printf("chr%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%d\t%s\n", orphanPair.refID + 1, orphanPair.anchorPos, orphanPair.anchorEnd + 1, refRegion.start, 
-                        refRegion.start + refRegion.len, pAlignment->ref_begin1 + refRegion.start, pAlignment->ref_end1 + refRegion.start, pAlignment->read_begin1, 
-                        pAlignment->read_end1, pAlignment->score1, cigarStr.c_str());
-#endif
-
                 partial.cigar = NULL;
                 partial.refPos = INT32_MAX;
-                align_destroy(pAlignment);
             }
-
-            init_destroy(pProfile);
-        }
-        else
-        {
-            partial.cigar = NULL;
-            partial.refPos = INT32_MAX;
         }
     }
 
     pthread_exit(NULL);
 }
 
-bool FirstMapThread::SetFirstRefRegion(RefRegion& refRegion, int32_t anchorPos, int32_t anchorEnd, int32_t readGrpID, uint32_t readLen, bool isUpStream) const
+bool FirstMapThread::SetFirstRefRegion(RefRegion& refRegion, Array<int8_t>& refBuffer, int32_t anchorPos, int32_t anchorEnd, int32_t readGrpID, uint32_t readLen, bool isUpStream) const
 {
     uint32_t fragLenHigh = libTable.GetFragLenHigh(readGrpID);
     // uint32_t fragLenLow = libTable.GetFragLenLow(readGrpID);
-    int32_t refEnd = ref.pos + ref.refSeq.Size() - 1;
+    int32_t refEnd = chrom.pos + chrom.GetRefLen() - 1;
 
     if (!isUpStream)
     {
@@ -223,7 +239,7 @@ bool FirstMapThread::SetFirstRefRegion(RefRegion& refRegion, int32_t anchorPos,
         if (regionLen <= 0 || regionLen < (int) readLen)
             return false;
 
-        refRegion.pRef = ref.refSeq.GetPointer(start - ref.pos);
+        refRegion.pRef = chrom.GetRefSeq(refBuffer, start, regionLen);
         refRegion.len = regionLen;
         refRegion.start = start;
     }
@@ -245,7 +261,7 @@ bool FirstMapThread::SetFirstRefRegion(RefRegion& refRegion, int32_t anchorPos,
         if (regionLen <= 0 || regionLen < (int) readLen)
             return false;
 
-        refRegion.pRef = ref.refSeq.GetPointer(start - ref.pos);
+        refRegion.pRef = chrom.GetRefSeq(refBuffer, start, regionLen);
         refRegion.len = regionLen;
         refRegion.start = start;
     }
@@ -254,7 +270,7 @@ bool FirstMapThread::SetFirstRefRegion(RefRegion& refRegion, int32_t anchorPos,
 }
 
 bool FirstMapThread::FirstFilter(PartialType& partialType, bool& isRescued, RescuePartial& rescuePartial,
-                                 const s_align* pAlignment, const OrphanPair& orphanPair, const RefRegion& refRegion) const
+                                 const s_align* pAlignment, const int8_t* readSeq, int readLen, const RefRegion& refRegion) const
 {
     isRescued = false;
 
@@ -266,13 +282,12 @@ bool FirstMapThread::FirstFilter(PartialType& partialType, bool& isRescued, Resc
 
     // length filter
     int alignedReadLen = pAlignment->read_end1 - pAlignment->read_begin1 + 1;
-    int readLen = orphanPair.read.len;
 
     if (alignedReadLen < alignerPars.minAlignedLen)
         return false;
 
     double scoreRate = (double) pAlignment->score1 / (alignerPars.mat[0] * alignedReadLen);
-    partialType = GetPartialType(pAlignment->read_begin1, pAlignment->read_end1, orphanPair.read.len);
+    partialType = GetPartialType(pAlignment->read_begin1, pAlignment->read_end1, readLen);
 
     if (scoreRate >= alignerPars.minScoreRate && pAlignment->cigarLen < 3)
     {
@@ -284,7 +299,7 @@ bool FirstMapThread::FirstFilter(PartialType& partialType, bool& isRescued, Resc
     }
     else
     {
-        isRescued = rescuePartial.RescueLowScore(partialType, pAlignment, orphanPair.read.seq, orphanPair.read.len, refRegion);
+        isRescued = rescuePartial.RescueLowScore(partialType, pAlignment, readSeq, readLen, refRegion);
         if (!isRescued)
             return false;
     }
@@ -27,6 +27,7 @@
 #include "TGM_LibTable.h"
 #include "TGM_Reference.h"
 #include "TGM_RescuePartial.h"
+#include "TGM_TaskPool.h"
 
 namespace Tangram
 {
@@ -40,15 +41,12 @@ namespace Tangram
 
         PrtlAlgnmnt* firstPartials;
 
-        OrphanPair* orphanPairs;
-
         RefRegion* refRegions;
 
         FirstMapThread* pFirstMapThread;
 
-        unsigned int orphanSize;
-
-        unsigned int orphanStart;
+        // the orphans are handed out by the task pool
+        TaskPool* pTaskPool;
 
     }FirstMapData;
 
@@ -56,7 +54,7 @@ namespace Tangram
     {
         public:
 
-            FirstMapThread(const AlignerPars& pars, const LibTable& libTable, const BamPairTable& bamPairTable, const Reference& ref);
+            FirstMapThread(const AlignerPars& pars, const LibTable& libTable, const BamPairTable& bamPairTable, const ChromView& chrom);
 
             ~FirstMapThread();
 
@@ -64,10 +62,10 @@ namespace Tangram
 
         private:
 
-            bool SetFirstRefRegion(RefRegion& refRegion, int32_t pos, int32_t end, int32_t readGrpID, uint32_t readLen, bool isUp) const;
+            bool SetFirstRefRegion(RefRegion& refRegion, Array<int8_t>& refBuffer, int32_t pos, int32_t end, int32_t readGrpID, uint32_t readLen, bool isUp) const;
             
             bool FirstFilter(PartialType& partialType, bool& isRescued, RescuePartial& rescuePartial,
-                             const s_align* pAlignment, const OrphanPair& orphanPair, const RefRegion& refRegion) const;
+                             const s_align* pAlignment, const int8_t* readSeq, int readLen, const RefRegion& refRegion) const;
 
         private:
 
@@ -77,7 +75,7 @@ namespace Tangram
 
             const BamPairTable& bamPairTable;
 
-            const Reference& ref;
+            const ChromView& chrom;
     };
 };
 
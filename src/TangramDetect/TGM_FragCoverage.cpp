@@ -0,0 +1,327 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_FragCoverage.cpp
+ *
+ *    Description:  Binned counts of the fragments used for genotyping
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 05:05:36 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+#include <string.h>
+
+#include "TGM_Error.h"
+#include "TGM_BamPair.h"
+#include "TGM_FragCoverage.h"
+
+using namespace BamTools;
+using namespace Tangram;
+
+// initial number of entries in the count lists
+#define MIN_COUNT_CAPACITY 1024
+
+// largest number of entries in a count list (16 GB of pair counts)
+#define MAX_COUNT_CAPACITY (1u << 30)
+
+// integer division rounded down, the dividend may be negative
+static inline int32_t FloorDiv(int32_t a, int32_t b)
+{
+    return (a >= 0 ? a / b : -((-a + b - 1) / b));
+}
+
+static int CompareCross(const void* a, const void* b)
+{
+    const CrossCount* first = (const CrossCount*) a;
+    const CrossCount* second = (const CrossCount*) b;
+
+    if (first->sampleID != second->sampleID)
+        return (first->sampleID < second->sampleID ? -1 : 1);
+    else if (first->bin != second->bin)
+        return (first->bin < second->bin ? -1 : 1);
+    else
+        return 0;
+}
+
+static int CompareSpan(const void* a, const void* b)
+{
+    const SpanCount* first = (const SpanCount*) a;
+    const SpanCount* second = (const SpanCount*) b;
+
+    if (first->group != second->group)
+        return (first->group < second->group ? -1 : 1);
+    else if (first->upperBin != second->upperBin)
+        return (first->upperBin < second->upperBin ? -1 : 1);
+    else if (first->mateBin != second->mateBin)
+        return (first->mateBin < second->mateBin ? -1 : 1);
+    else
+        return 0;
+}
+
+// sort the read differences and add up the ones in the same bin
+// the bins whose differences cancel out are dropped
+static void CompactCross(Array<CrossCount>& cross)
+{
+    unsigned int size = cross.Size();
+    if (size == 0)
+        return;
+
+    cross.Sort(CompareCross);
+
+    unsigned int newSize = 0;
+    for (unsigned int i = 0; i != size; ++i)
+    {
+        if (newSize > 0 && CompareCross(&cross[newSize - 1], &cross[i]) == 0)
+            cross[newSize - 1].count += cross[i].count;
+        else
+            cross[newSize++] = cross[i];
+
+        if (cross[newSize - 1].count == 0)
+            --newSize;
+    }
+
+    cross.SetSize(newSize);
+}
+
+// sort the pair counts and add up the ones in the same bins
+static void CompactSpans(Array<SpanCount>& spans)
+{
+    unsigned int size = spans.Size();
+    if (size == 0)
+        return;
+
+    spans.Sort(CompareSpan);
+
+    unsigned int newSize = 1;
+    for (unsigned int i = 1; i != size; ++i)
+    {
+        if (CompareSpan(&spans[newSize - 1], &spans[i]) == 0)
+            spans[newSize - 1].count += spans[i].count;
+        else
+            spans[newSize++] = spans[i];
+    }
+
+    spans.SetSize(newSize);
+}
+
+// make room for num more entries
+// a full list is compacted first and only grows if it stays more than half full
+template <class T> static void Reserve(Array<T>& counts, unsigned int num, void (*Compact)(Array<T>&))
+{
+    if ((uint64_t) counts.Size() + num <= counts.Capacity())
+        return;
+
+    Compact(counts);
+
+    uint64_t newCap = ((uint64_t) counts.Size() + num) * 2;
+    if (newCap <= counts.Capacity())
+        return;
+
+    if (newCap < MIN_COUNT_CAPACITY)
+        newCap = MIN_COUNT_CAPACITY;
+
+    if (newCap > MAX_COUNT_CAPACITY)
+        TGM_ErrQuit("ERROR: Too many genotype counts in one region. Please use a larger genotype bin size (-gb).\n");
+
+    counts.Resize((unsigned int) newCap);
+}
+
+// index of the first entry that is not less than the key
+template <class T> static unsigned int LowerBound(const Array<T>& counts, const T& key, CompareFunc Compare)
+{
+    unsigned int first = 0;
+    unsigned int last = counts.Size();
+    while (first < last)
+    {
+        unsigned int mid = first + (last - first) / 2;
+        if (Compare(counts.GetPointer(mid), &key) < 0)
+            first = mid + 1;
+        else
+            last = mid;
+    }
+
+    return first;
+}
+
+FragCoverage::FragCoverage()
+{
+    binSize = 0;
+    numGaps = 0;
+    maxGap = 0;
+    minMQ = 0;
+    minCrossLen = 0;
+    numSamples = 0;
+}
+
+FragCoverage::~FragCoverage()
+{
+
+}
+
+void FragCoverage::Init(int32_t binSize, unsigned char minMQ, int minCrossLen, int32_t maxGap, unsigned int numSamples)
+{
+    this->binSize = binSize;
+    this->minMQ = minMQ;
+    this->minCrossLen = minCrossLen;
+    this->maxGap = maxGap;
+    this->numSamples = numSamples;
+
+    numGaps = maxGap / binSize + 2;
+
+    cross.Clear();
+    spans.Clear();
+}
+
+void FragCoverage::Add(const BamAlignment& alignment, unsigned int sampleID, int8_t pairType)
+{
+    // the same fragments are counted as in Genotype::CountWindow()
+    int32_t alignEnd = alignment.GetEndPosition(false, true);
+    bool isUpperMate = (alignment.Position < alignment.MatePosition);
+
+    int32_t fragEnd = alignEnd;
+    if (isUpperMate)
+        fragEnd = alignment.Position + alignment.InsertSize - 1;
+
+    // reads that cross a precise locus with more than minCrossLen bases on each side
+    if (alignment.MapQuality >= minMQ && pairType != PT_SOFT3 && pairType != PT_SOFT5)
+    {
+        int32_t begin = alignment.Position + (minCrossLen > 0 ? minCrossLen : 1);
+        int32_t end = alignEnd - (minCrossLen > 0 ? minCrossLen : 1);
+        if (end > fragEnd)
+            end = fragEnd;
+
+        AddCross(sampleID, begin, end);
+    }
+
+    // only count the upper mate to prevent double counting
+    if (isUpperMate && (pairType == PT_NORMAL || pairType == PT_SHORT))
+    {
+        int32_t matePos = alignment.MatePosition;
+        if (matePos > fragEnd)
+            matePos = fragEnd;
+
+        if (matePos >= alignEnd)
+            AddSpan(sampleID, alignEnd, matePos, pairType == PT_SHORT);
+    }
+}
+
+void FragCoverage::Merge(FragCoverage& other)
+{
+    unsigned int size = other.cross.Size();
+    if (size > 0)
+    {
+        Reserve(cross, size, CompactCross);
+        cross.Append(other.cross.GetPointer(0), size);
+        other.cross.Clear();
+    }
+
+    size = other.spans.Size();
+    if (size > 0)
+    {
+        Reserve(spans, size, CompactSpans);
+        spans.Append(other.spans.GetPointer(0), size);
+        other.spans.Clear();
+    }
+}
+
+void FragCoverage::Finish(void)
+{
+    CompactCross(cross);
+    CompactSpans(spans);
+
+    unsigned int size = cross.Size();
+    for (unsigned int i = 1; i < size; ++i)
+    {
+        if (cross[i].sampleID == cross[i - 1].sampleID)
+            cross[i].count += cross[i - 1].count;
+    }
+}
+
+int32_t FragCoverage::GetCross(unsigned int sampleID, int32_t pos) const
+{
+    // the last bin of the sample at or before the bin of pos
+    CrossCount key;
+    key.sampleID = sampleID;
+    key.bin = FloorDiv(pos, binSize) + 1;
+
+    unsigned int index = LowerBound(cross, key, CompareCross);
+    if (index == 0 || cross[index - 1].sampleID != sampleID)
+        return 0;
+
+    return cross[index - 1].count;
+}
+
+int32_t FragCoverage::GetSpan(unsigned int sampleID, int32_t posUpper, int32_t posLower, bool isShort) const
+{
+    int32_t upperBin = FloorDiv(posUpper, binSize);
+    int32_t lowerBin = FloorDiv(posLower, binSize);
+
+    // the upper mate ends in the bin of posUpper or before
+    // and the lower mate starts in the bin of posLower or after
+    // the lower mate bin is at most numGaps - 1 bins after the upper mate bin
+    SpanCount key;
+    key.group = sampleID * 2 + (isShort ? 1 : 0);
+    key.upperBin = lowerBin - numGaps + 1;
+    key.mateBin = INT32_MIN;
+
+    int32_t count = 0;
+    unsigned int size = spans.Size();
+    for (unsigned int i = LowerBound(spans, key, CompareSpan); i != size; ++i)
+    {
+        const SpanCount& span = spans[i];
+        if (span.group != key.group || span.upperBin > upperBin)
+            break;
+
+        if (span.mateBin >= lowerBin)
+            count += span.count;
+    }
+
+    return count;
+}
+
+void FragCoverage::AddCross(unsigned int sampleID, int32_t begin, int32_t end)
+{
+    // bins whose centre (bin * binSize + binSize / 2) is in [begin, end]
+    int32_t half = binSize / 2;
+    int32_t first = -FloorDiv(half - begin, binSize);
+    int32_t last = FloorDiv(end - half, binSize);
+    if (first > last)
+        return;
+
+    Reserve(cross, 2, CompactCross);
+
+    CrossCount& firstCount = cross.End();
+    firstCount.sampleID = sampleID;
+    firstCount.bin = first;
+    firstCount.count = 1;
+    cross.Increment();
+
+    CrossCount& lastCount = cross.End();
+    lastCount.sampleID = sampleID;
+    lastCount.bin = last + 1;
+    lastCount.count = -1;
+    cross.Increment();
+}
+
+void FragCoverage::AddSpan(unsigned int sampleID, int32_t alignEnd, int32_t matePos, bool isShort)
+{
+    int32_t bin = FloorDiv(alignEnd, binSize);
+    int32_t gap = FloorDiv(matePos, binSize) - bin;
+
+    // the longer pairs span everything that is told apart
+    if (gap >= numGaps)
+        gap = numGaps - 1;
+
+    Reserve(spans, 1, CompactSpans);
+
+    SpanCount& span = spans.End();
+    span.group = sampleID * 2 + (isShort ? 1 : 0);
+    span.upperBin = bin;
+    span.mateBin = bin + gap;
+    span.count = 1;
+    spans.Increment();
+}
@@ -0,0 +1,148 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_FragCoverage.h
+ *
+ *    Description:  Binned counts of the fragments used for genotyping
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 05:05:36 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+#ifndef  TGM_FRAGCOVERAGE_H
+#define  TGM_FRAGCOVERAGE_H
+
+#include <stdint.h>
+
+#include "api/BamAlignment.h"
+#include "TGM_Array.h"
+
+namespace Tangram
+{
+    // reads crossing a bin: the difference to the previous bin of the sample
+    // before the counts are finished and the count itself afterwards
+    struct CrossCount
+    {
+        uint32_t sampleID;
+        int32_t bin;
+        int32_t count;
+    };
+
+    // pairs whose upper mate ends in upperBin and lower mate starts in mateBin
+    struct SpanCount
+    {
+        uint32_t group;      // sampleID * 2, plus 1 for the short pairs
+        int32_t upperBin;
+        int32_t mateBin;
+        uint32_t count;
+    };
+
+    // The genotype module counts the reads that cross a locus and the pairs
+    // whose mates are on the two sides of it. Instead of reading the bam files
+    // again for every locus, these counts can be collected while the bam files
+    // are read for detection.
+    //
+    // A read adds one to the bins whose centre it crosses and a pair is kept by
+    // the bins of the end of its upper mate and the start of its lower mate, so
+    // a pair spanning a whole interval can still be told apart from two pairs
+    // spanning half of it each. The counts are kept as sorted lists and the
+    // entries falling in the same bins are merged, so the memory grows with the
+    // number of reads and pairs rather than with the region length. With a bin
+    // size of 1 the counts are exact, larger bins merge more entries.
+    class FragCoverage
+    {
+        public:
+            FragCoverage();
+            ~FragCoverage();
+
+            // pairs longer than maxGap are counted as spanning everything within maxGap
+            void Init(int32_t binSize, unsigned char minMQ, int minCrossLen, int32_t maxGap, unsigned int numSamples);
+
+            // add an alignment whose mate is on the same chromosome, pairType is a PairType
+            void Add(const BamTools::BamAlignment& alignment, unsigned int sampleID, int8_t pairType);
+
+            // add the counts of another coverage with the same settings
+            // the other coverage is left empty and keeps its memory for reuse
+            void Merge(FragCoverage& other);
+
+            // sort the counts and turn the read differences into counts, no more alignments can be added after this
+            void Finish(void);
+
+            // number of reads that cross a precise locus
+            int32_t GetCross(unsigned int sampleID, int32_t pos) const;
+
+            // number of normal (or short) pairs whose upper mate ends before posUpper and lower mate starts after posLower
+            int32_t GetSpan(unsigned int sampleID, int32_t posUpper, int32_t posLower, bool isShort) const;
+
+            inline bool IsOn(void) const
+            {
+                return binSize > 0;
+            }
+
+            inline int32_t GetBinSize(void) const
+            {
+                return binSize;
+            }
+
+            inline unsigned char GetMinMQ(void) const
+            {
+                return minMQ;
+            }
+
+            inline int GetMinCrossLen(void) const
+            {
+                return minCrossLen;
+            }
+
+            inline int32_t GetMaxGap(void) const
+            {
+                return maxGap;
+            }
+
+            inline unsigned int GetNumSamples(void) const
+            {
+                return numSamples;
+            }
+
+            // memory used by the counts (bytes)
+            inline uint64_t GetMemSize(void) const
+            {
+                return (uint64_t) cross.Capacity() * sizeof(CrossCount) + (uint64_t) spans.Capacity() * sizeof(SpanCount);
+            }
+
+        private:
+
+            // add one to the reads crossing the bins whose centre is in [begin, end]
+            void AddCross(unsigned int sampleID, int32_t begin, int32_t end);
+
+            // add one to the pairs whose upper mate ends at alignEnd and lower mate starts at matePos
+            void AddSpan(unsigned int sampleID, int32_t alignEnd, int32_t matePos, bool isShort);
+
+        private:
+
+            // read differences by sample and bin
+            Array<CrossCount> cross;
+
+            // pair counts by group, upper mate bin and lower mate bin
+            Array<SpanCount> spans;
+
+            int32_t binSize;
+
+            // number of bins told apart between the two mates
+            int32_t numGaps;
+
+            int32_t maxGap;
+
+            unsigned char minMQ;
+
+            int minCrossLen;
+
+            unsigned int numSamples;
+    };
+};
+
+#endif  /*TGM_FRAGCOVERAGE_H*/
@@ -19,6 +19,7 @@
 #include <cstdlib>
 #include <cstdio>
 #include <cmath>
+#include <cstring>
 
 #include "TGM_Error.h"
 #include "TGM_Utilities.h"
@@ -28,6 +29,7 @@ using namespace Tangram;
 
 FragLenTable::FragLenTable()
 {
+    qualTableSize = 0;
 
 }
 
@@ -36,7 +38,16 @@ FragLenTable::~FragLenTable()
 
 }
 
-void FragLenTable::Read(FILE* fpHistInput)
+static inline int FragLenQuality(double cdf)
+{
+    if (cdf <= 0.0)
+        return MAX_FRAG_LEN_QUAL;
+
+    int quality = DoubleRoundToInt(-10.0 * log10(cdf));
+    return (quality > MAX_FRAG_LEN_QUAL ? MAX_FRAG_LEN_QUAL : quality);
+}
+
+void FragLenTable::Read(FILE* fpHistInput, const LibTable& libTable)
 {
     uint32_t numHist = 0;
     
@@ -47,6 +58,13 @@ void FragLenTable::Read(FILE* fpHistInput)
     fragLenTable.Init(numHist);
     fragLenTable.SetSize(numHist);
 
+    medians.Init(numHist);
+    medians.SetSize(numHist);
+    qualTableSize = 0;
+
+    // number of read groups without a quality lookup table
+    unsigned int numSearched = 0;
+
     for (unsigned int i = 0; i != numHist; ++i)
     {
         uint32_t numElmnt = 0;
@@ -83,10 +101,53 @@ void FragLenTable::Read(FILE* fpHistInput)
             fragLenTable[i].freq = NULL;
             fragLenTable[i].size = 0;
         }
+
+        medians[i] = libTable.GetFragLenMedian(i);
+        if (!BuildQualTable(fragLenTable[i], medians[i]))
+            ++numSearched;
+    }
+
+    if (numSearched > 0)
+    {
+        TGM_ErrMsg("WARNING: The fragment length quality tables reach the memory limit (%llu bytes). "
+                   "The qualities of %u read groups will be searched from their histograms.\n", (unsigned long long) MAX_FRAG_LEN_QUAL_TABLE_SIZE, numSearched);
+    }
+}
+
+// The quality of every fragment length between the shortest and the longest
+// ones in the histogram is computed once here, so a lookup is a single load.
+// The lengths not in the histogram are marked as invalid.
+bool FragLenTable::BuildQualTable(FragLenHist& hist, uint32_t median)
+{
+    hist.qual = NULL;
+    if (hist.size == 0)
+        return true;
+
+    uint64_t range = hist.fragLen[hist.size - 1] - hist.fragLen[0] + 1;
+    if (qualTableSize + range > MAX_FRAG_LEN_QUAL_TABLE_SIZE)
+        return false;
+
+    hist.qual = (uint8_t*) malloc(sizeof(uint8_t) * range);
+    if (hist.qual == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the fragment length quality table.\n");
+
+    memset(hist.qual, INVALID_FRAG_LEN_QUAL, sizeof(uint8_t) * range);
+    qualTableSize += range;
+
+    double totalFreq = hist.freq[hist.size - 1];
+    for (unsigned int i = 0; i != hist.size; ++i)
+    {
+        double cdf = hist.freq[i] / totalFreq;
+        if (hist.fragLen[i] > median)
+            cdf = 1.0 - cdf;
+
+        hist.qual[hist.fragLen[i] - hist.fragLen[0]] = FragLenQuality(cdf);
     }
+
+    return true;
 }
 
-int FragLenTable::GetQuality(uint32_t readGrpID, uint32_t targetFragLen, uint32_t median) const 
+int FragLenTable::SearchQuality(uint32_t readGrpID, uint32_t targetFragLen) const
 {
     const uint32_t* pFragLen = fragLenTable[readGrpID].fragLen;
     const uint64_t* pFreq = fragLenTable[readGrpID].freq;
@@ -101,10 +162,10 @@ int FragLenTable::GetQuality(uint32_t readGrpID, uint32_t targetFragLen, uint32_
         uint64_t totalFreq = pFreq[size - 1];
         double cdf = (double) pFreq[index] / totalFreq;
 
-        if (targetFragLen > median)
+        if (targetFragLen > medians[readGrpID])
             cdf = 1.0 - cdf;
 
-        quality = DoubleRoundToInt(-10.0 * log10(cdf));
+        quality = FragLenQuality(cdf);
     }
 
     return quality;
@@ -117,5 +178,6 @@ void FragLenTable::Destory(void)
     {
         free(fragLenTable[i].fragLen);
         free(fragLenTable[i].freq);
+        free(fragLenTable[i].qual);
     }
 }
@@ -22,9 +22,16 @@
 #include <vector>
 #include <stdint.h>
 #include "TGM_Array.h"
+#include "TGM_LibTable.h"
 
 #define INVALID_FRAG_LEN_QUAL 255
 
+// the quality of the fragment lengths at the far end of a histogram (p value 0) is clamped to this value
+#define MAX_FRAG_LEN_QUAL 254
+
+// upper limit of the memory (bytes) used by the quality lookup tables of all the read groups
+#define MAX_FRAG_LEN_QUAL_TABLE_SIZE (64 * 1024 * 1024)
+
 inline int CompareFragLen(const void* a, const void* b)
 {
     const uint32_t* pFragLen1 = (const uint32_t*) a;
@@ -46,6 +53,8 @@ namespace Tangram
         uint64_t* freq;
 
         uint32_t size;
+
+        uint8_t* qual;      // quality of each fragment length from fragLen[0] to fragLen[size - 1] (NULL if the table is over the memory limit)
     };
 
     class FragLenTable
@@ -54,15 +63,44 @@ namespace Tangram
             FragLenTable();
             ~FragLenTable();
 
-            void Read(FILE* fpHistInput);
+            // read the histograms and build the quality lookup tables with the medians of the libraries
+            void Read(FILE* fpHistInput, const LibTable& libTable);
 
             void Destory(void);
 
-            int GetQuality(uint32_t readGrpID, uint32_t targetFragLen, uint32_t median) const;
+            // quality of a fragment length, -1 if the fragment length is never seen in the library
+            inline int GetQuality(uint32_t readGrpID, uint32_t targetFragLen) const
+            {
+                const FragLenHist& hist = fragLenTable[readGrpID];
+                if (hist.qual == NULL)
+                    return SearchQuality(readGrpID, targetFragLen);
+
+                if (hist.size == 0 || targetFragLen < hist.fragLen[0] || targetFragLen > hist.fragLen[hist.size - 1])
+                    return -1;
+
+                uint8_t qual = hist.qual[targetFragLen - hist.fragLen[0]];
+                return (qual == INVALID_FRAG_LEN_QUAL ? -1 : qual);
+            }
+
+            // memory (bytes) used by the quality lookup tables
+            inline uint64_t GetQualTableSize(void) const
+            {
+                return qualTableSize;
+            }
+
+        private:
+
+            int SearchQuality(uint32_t readGrpID, uint32_t targetFragLen) const;
+
+            bool BuildQualTable(FragLenHist& hist, uint32_t median);
 
         private:
 
             Array<FragLenHist> fragLenTable;
+
+            Array<uint32_t> medians;
+
+            uint64_t qualTableSize;
     };
 };
 
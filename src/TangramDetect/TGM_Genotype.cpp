@@ -24,9 +24,11 @@ using namespace Tangram;
 Genotype::Genotype(BamMultiReader& reader, const GenotypePars& genotypePars, const LibTable& libTable, BamPairTable& bamPairTable)
           : reader(reader), genotypePars(genotypePars), libTable(libTable), bamPairTable(bamPairTable)
 {
-    lastChr = -1;
-    lastPos = -1;
-    lastEnd = -1;
+    fragHead = 0;
+    winChr = -1;
+    winBegin = -1;
+    lastReadPos = -1;
+    isWinEnd = true;
 
     specialPrior[0] = 1.0/3.0;
     specialPrior[1] = 1.0/3.0;
@@ -44,6 +46,12 @@ void Genotype::Init(void)
 
     sampleCount.Init(numSamples);
     sampleCount.SetSize(numSamples);
+
+    // the fragments were counted while the bam files were read for detection
+    if (bamPairTable.coverage.IsOn())
+        bamPairTable.coverage.Finish();
+    else
+        frags.Init(1000);
 }
 
 void Genotype::SetSpecialPrior(const double* prior)
@@ -85,15 +93,6 @@ bool Genotype::Special(const SpecialEvent* pRpSpecial, const SplitEvent* pSplitE
         if (!SpecialFilter(pRpSpecial, pSplitEvent))
             return false;
 
-        // where should we jump to 
-        int32_t fragLenMax = libTable.GetFragLenMax();
-        int32_t jumpPos = pos - fragLenMax;
-        if (jumpPos < 0)
-            jumpPos = 0;
-
-        if (!Jump(chr, jumpPos))
-            return false;
-
         int32_t posUpper = pos;
         int32_t posLower = pos;
 
@@ -105,67 +104,29 @@ bool Genotype::Special(const SpecialEvent* pRpSpecial, const SplitEvent* pSplitE
             posLower += pRpSpecial->posUncertainty / 2;
         }
 
-        // counting the non-support fragments
-        BamAlignment alignment;
-        while (reader.GetNextAlignment(alignment))
+        if (bamPairTable.coverage.IsOn())
         {
-            if (alignment.Position > pos + 100)
-                break;
-
-            // end position of this fragment
-            int32_t fragEnd = 0;
-            // end position of this aligned mate
-            int32_t alignEnd = alignment.GetEndPosition(false, true);
-
-            bool isUpperMate = false;
-            if (alignment.RefID != alignment.MateRefID)
-                continue;
-            else if (alignment.Position < alignment.MatePosition)
-            {
-                isUpperMate = true;
-                fragEnd = alignment.Position + alignment.InsertSize - 1;
-            }
-            else
-            {
-                fragEnd = alignEnd;
-                if (!isPresice)
-                    continue;
-            }
-
-            if (fragEnd < posUpper)
-                continue;
-
-            int32_t readGrpID = -1;
-            PairType pairType = bamPairTable.CheckPairType(readGrpID, alignment);
-
-            if (isPresice)
-            {
-                if (alignment.Position < pos && alignEnd > pos && alignment.MapQuality >= genotypePars.minMQ && pairType != PT_SOFT3 && pairType != PT_SOFT5)
-                {
-                    int upLen = pos - alignment.Position + 1;
-                    int downLen = alignEnd - pos + 1;
-                    if (upLen > genotypePars.minCrossLen && downLen > genotypePars.minCrossLen)
-                        UpdateNonSupport(readGrpID);
-                }
-            }
-
-            // only count the upper mate to prevent double counting
-            if (isUpperMate)
-            {
-                if (pairType == PT_NORMAL && alignEnd <= posUpper && alignment.MatePosition >= posLower)
-                    UpdateNonSupport(readGrpID);
-                else if (pairType == PT_SHORT && alignEnd <= posUpper && alignment.MatePosition >= posLower)
-                    UpdateSupport(readGrpID);
-            }
+            // the fragments were counted with the detection pass
+            CountCoverage(pos, posUpper, posLower, isPresice);
+        }
+        else
+        {
+            // where should we jump to 
+            int32_t fragLenMax = libTable.GetFragLenMax();
+            int32_t jumpPos = pos - fragLenMax;
+            if (jumpPos < 0)
+                jumpPos = 0;
+
+            if (!SetWindow(chr, jumpPos))
+                return false;
+
+            // counting the non-support fragments
+            LoadWindow(pos + 100);
+            CountWindow(pos, posUpper, posLower, isPresice);
         }
 
         // set the likelihood for this locus
         SetLikelihood();
-
-        // update the bam file stream position
-        lastChr = chr;
-        lastPos = jumpPos;
-        lastEnd = alignment.Position;
     }
 
     return true;
@@ -193,29 +154,143 @@ bool Genotype::SpecialFilter(const SpecialEvent* pRpSpecial, const SplitEvent* p
     return true;
 }
 
-bool Genotype::Jump(int32_t refID, int32_t pos)
+bool Genotype::SetWindow(int32_t refID, int32_t begin)
 {
-    if (refID != lastChr || (genotypePars.minJumpLen > 0 && pos >= lastEnd + genotypePars.minJumpLen) || pos < lastEnd)
+    // we only do the jump when the next locus is on another chromosome, very far away
+    // or behind the window. otherwise we slide the window and read through the bam files
+    if (refID != winChr || begin < winBegin || (genotypePars.minJumpLen > 0 && begin >= lastReadPos + genotypePars.minJumpLen))
     {
-        // we only do the jump when the next locus is very far away
-        if (reader.Jump(refID, pos))
-            return true;
-        else
+        frags.Clear();
+        fragHead = 0;
+
+        winChr = -1;
+        if (!reader.Jump(refID, begin))
             return false;
+
+        winChr = refID;
+        winBegin = begin;
+        lastReadPos = -1;
+        isWinEnd = false;
+
+        return true;
     }
-    else
+
+    // drop the alignments that end before the window
+    winBegin = begin;
+    unsigned int size = frags.Size();
+    while (fragHead != size && frags[fragHead].pos < begin && frags[fragHead].alignEnd < begin)
+        ++fragHead;
+
+    // reuse the memory of the dropped alignments
+    if (fragHead > 0 && fragHead >= size / 2)
     {
-        // if the next locus is close we just read through the bam file
-        // until we reach that position
-        BamAlignment alignment;
-        while (reader.GetNextAlignment(alignment))
+        unsigned int numLeft = size - fragHead;
+        if (numLeft > 0)
+            memmove(frags.GetPointer(0), frags.GetPointer(fragHead), numLeft * sizeof(GenotypeFrag));
+
+        frags.SetSize(numLeft);
+        fragHead = 0;
+    }
+
+    return true;
+}
+
+void Genotype::LoadWindow(int32_t end)
+{
+    BamAlignment alignment;
+    while (!isWinEnd && lastReadPos <= end)
+    {
+        if (!reader.GetNextAlignmentCore(alignment) || alignment.RefID != winChr)
         {
-            if (alignment.Position >= pos)
-                break;
+            isWinEnd = true;
+            break;
         }
+
+        lastReadPos = alignment.Position;
+
+        // only the pairs with both mates on this chromosome count
+        if (alignment.RefID != alignment.MateRefID)
+            continue;
+
+        // the alignments that end before the window are streamed past
+        // instead of being kept, the window may read through a long gap
+        int32_t alignEnd = alignment.GetEndPosition(false, true);
+        if (alignEnd < winBegin)
+            continue;
+
+        GenotypeFrag frag;
+        frag.pos = alignment.Position;
+        frag.alignEnd = alignEnd;
+        frag.matePos = alignment.MatePosition;
+        frag.mapQ = alignment.MapQuality;
+        frag.isUpperMate = (alignment.Position < alignment.MatePosition);
+
+        if (frag.isUpperMate)
+            frag.fragEnd = alignment.Position + alignment.InsertSize - 1;
+        else
+            frag.fragEnd = frag.alignEnd;
+
+        frag.readGrpID = -1;
+        frag.pairType = bamPairTable.CheckPairType(frag.readGrpID, alignment);
+
+        frags.Append(&frag, 1);
     }
+}
 
-    return true;
+void Genotype::CountWindow(int32_t pos, int32_t posUpper, int32_t posLower, bool isPresice)
+{
+    unsigned int size = frags.Size();
+    for (unsigned int i = fragHead; i != size; ++i)
+    {
+        const GenotypeFrag& frag = frags[i];
+        if (frag.pos > pos + 100)
+            break;
+
+        // the alignments should overlap the window (same as a jump in the bam files)
+        if (frag.pos < winBegin && frag.alignEnd < winBegin)
+            continue;
+
+        if (!frag.isUpperMate && !isPresice)
+            continue;
+
+        if (frag.fragEnd < posUpper)
+            continue;
+
+        if (isPresice)
+        {
+            if (frag.pos < pos && frag.alignEnd > pos && frag.mapQ >= genotypePars.minMQ && frag.pairType != PT_SOFT3 && frag.pairType != PT_SOFT5)
+            {
+                int upLen = pos - frag.pos + 1;
+                int downLen = frag.alignEnd - pos + 1;
+                if (upLen > genotypePars.minCrossLen && downLen > genotypePars.minCrossLen)
+                    UpdateNonSupport(frag.readGrpID);
+            }
+        }
+
+        // only count the upper mate to prevent double counting
+        if (frag.isUpperMate)
+        {
+            if (frag.pairType == PT_NORMAL && frag.alignEnd <= posUpper && frag.matePos >= posLower)
+                UpdateNonSupport(frag.readGrpID);
+            else if (frag.pairType == PT_SHORT && frag.alignEnd <= posUpper && frag.matePos >= posLower)
+                UpdateSupport(frag.readGrpID);
+        }
+    }
+}
+
+void Genotype::CountCoverage(int32_t pos, int32_t posUpper, int32_t posLower, bool isPresice)
+{
+    const FragCoverage& coverage = bamPairTable.coverage;
+
+    unsigned int size = sampleCount.Size();
+    for (unsigned int i = 0; i != size; ++i)
+    {
+        if (isPresice)
+            sampleCount[i].nonSupport += coverage.GetCross(i, pos);
+
+        sampleCount[i].nonSupport += coverage.GetSpan(i, posUpper, posLower, false);
+        sampleCount[i].support += coverage.GetSpan(i, posUpper, posLower, true);
+    }
 }
 
 void Genotype::SetSampleCountSpecial(const SpecialEvent& rpSpecial)
@@ -256,9 +331,9 @@ void Genotype::SetSampleCountSplit(const SplitEvent& splitEvent)
         unsigned int origIdx = splitEvent.first3[i].origIdx;
 
         if (splitEvent.first3[i].isSoft)
-            readGrpID = bamPairTable.softPairs[origIdx].readGrpID;
+            readGrpID = bamPairTable.softPairs.readGrpIDs[origIdx];
         else
-            readGrpID = bamPairTable.orphanPairs[origIdx].readGrpID;
+            readGrpID = bamPairTable.orphanPairs.readGrpIDs[origIdx];
 
         if (libTable.GetSampleID(sampleID, readGrpID))
         {
@@ -275,9 +350,9 @@ void Genotype::SetSampleCountSplit(const SplitEvent& splitEvent)
         unsigned int origIdx = splitEvent.first5[i].origIdx;
 
         if (splitEvent.first5[i].isSoft)
-            readGrpID = bamPairTable.softPairs[origIdx].readGrpID;
+            readGrpID = bamPairTable.softPairs.readGrpIDs[origIdx];
         else
-            readGrpID = bamPairTable.orphanPairs[origIdx].readGrpID;
+            readGrpID = bamPairTable.orphanPairs.readGrpIDs[origIdx];
 
         if (libTable.GetSampleID(sampleID, readGrpID))
         {
@@ -44,6 +44,29 @@ namespace Tangram
         uint32_t sr5;
     };
 
+    // compact summary of an alignment kept in the genotyping window
+    struct GenotypeFrag
+    {
+        int32_t pos;
+
+        // end position of the aligned mate
+        int32_t alignEnd;
+
+        // end position of the fragment
+        int32_t fragEnd;
+
+        int32_t matePos;
+
+        int32_t readGrpID;
+
+        int8_t pairType;
+
+        uint8_t mapQ;
+
+        // is this the mate at upstream
+        bool isUpperMate;
+    };
+
     class Genotype
     {
         public:
@@ -64,8 +87,17 @@ namespace Tangram
 
             bool SpecialFilter(const SpecialEvent* pRpSpecial, const SplitEvent* pSplitEvent) const;
 
-            // jump to a specific position in the bam file
-            bool Jump(int32_t refID, int32_t pos);
+            // move the window to start at a given position, jump in the bam files if required
+            bool SetWindow(int32_t refID, int32_t begin);
+
+            // read the alignments into the window until the given position is passed
+            void LoadWindow(int32_t end);
+
+            // count the fragments in the window for a locus
+            void CountWindow(int32_t pos, int32_t posUpper, int32_t posLower, bool isPresice);
+
+            // count the fragments for a locus from the counts collected with the detection pass
+            void CountCoverage(int32_t pos, int32_t posUpper, int32_t posLower, bool isPresice);
 
             // set the read-pair fragment count for each sample
             void SetSampleCountSpecial(const SpecialEvent& rpSpecial);
@@ -121,10 +153,22 @@ namespace Tangram
 
             BamPairTable& bamPairTable;
 
-            // used to keep track of the current stream position
-            int32_t lastChr;
-            int32_t lastPos;
-            int32_t lastEnd;
+            // alignments read from the bam files, sorted by position.
+            // the loci are genotyped in coordinate order so each alignment is read and parsed once
+            Array<GenotypeFrag> frags;
+
+            // first alignment in the window
+            unsigned int fragHead;
+
+            // chromosome and start of the window (-1 if there is no window)
+            int32_t winChr;
+            int32_t winBegin;
+
+            // position of the last alignment read from the bam files
+            int32_t lastReadPos;
+
+            // no more alignments on the window chromosome
+            bool isWinEnd;
 
             // prior probabilities for MEI insertions
             double specialPrior[3];
@@ -49,6 +49,27 @@ static int CompareAttrbt(const void* a, const void* b)
     }
 }
 
+// insert an attribute into an array kept sorted by the first attribute.
+// the special pairs come in the order of the bam file, so the new attribute
+// is usually appended or moved back by only a few slots. equal attributes
+// keep their insertion order, just like a stable sort would leave them.
+static void InsertAttrbt(Array<PairAttrbt>& attrbts, const PairAttrbt& attrbt)
+{
+    unsigned int attrbtSize = attrbts.Size();
+    if (attrbts.IsFull())
+        attrbts.Resize(attrbtSize * 2);
+
+    unsigned int i = attrbtSize;
+    while (i > 0 && attrbts[i - 1].firstAttrbt > attrbt.firstAttrbt)
+        --i;
+
+    if (i != attrbtSize)
+        memmove(attrbts.GetPointer(i + 1), attrbts.GetPointer(i), sizeof(PairAttrbt) * (attrbtSize - i));
+
+    attrbts[i] = attrbt;
+    attrbts.Increment();
+}
+
 PairAttrbtTable::PairAttrbtTable(const LibTable& libTable, const BamPairTable& bamPairTable)
                                 : libTable(libTable), bamPairTable(bamPairTable)
 {
@@ -124,8 +145,8 @@ void PairAttrbtTable::MakeInversion(void)
         ++(*pIdx);
     }
 
-    invertedAttrbts[0].Sort(CompareAttrbt);
-    invertedAttrbts[1].Sort(CompareAttrbt);
+    invertedAttrbts[0].StableSort(CompareAttrbt);
+    invertedAttrbts[1].StableSort(CompareAttrbt);
 }
 
 void PairAttrbtTable::MakeSpecial(void)
@@ -147,14 +168,8 @@ void PairAttrbtTable::MakeSpecial(void)
 
         int arrayIndex = pSpecialPair->specialID * 2 + pSpecialPair->pairType - PT_SPECIAL3;
 
-        unsigned int attrbtSize = pSpecialAttrbts[arrayIndex].Size();
-        if (pSpecialAttrbts[arrayIndex].IsFull())
-            pSpecialAttrbts[arrayIndex].Resize(attrbtSize * 2);
-
-        PairAttrbt* pAttrbt = pSpecialAttrbts[arrayIndex].GetPointer(attrbtSize);
-        pSpecialAttrbts[arrayIndex].Increment();
-
-        pAttrbt->origIndex = i;
+        PairAttrbt attrbt;
+        attrbt.origIndex = i;
 
         double halfMedian = (double) libTable.GetFragLenMedian(pSpecialPair->readGrpID) / 2.0;
         double halfMedians[2] = {halfMedian, -halfMedian};
@@ -162,17 +177,14 @@ void PairAttrbtTable::MakeSpecial(void)
 
         int posIndex = pSpecialPair->pairType - PT_SPECIAL3;
 
-        pAttrbt->firstAttrbt = pos[posIndex] + halfMedians[posIndex];
-        pAttrbt->secondAttrbt = 0;
+        attrbt.firstAttrbt = pos[posIndex] + halfMedians[posIndex];
+        attrbt.secondAttrbt = 0;
 
-        pAttrbt->firstBound = (double) (libTable.GetFragLenHigh(pSpecialPair->readGrpID) - libTable.GetFragLenLow(pSpecialPair->readGrpID)) * boundScale;
-        pAttrbt->secondBound = 1e-3;
-    }
+        attrbt.firstBound = (double) (libTable.GetFragLenHigh(pSpecialPair->readGrpID) - libTable.GetFragLenLow(pSpecialPair->readGrpID)) * boundScale;
+        attrbt.secondBound = 1e-3;
 
-    // sort the attribute arrays according to the first attribute
-    for (unsigned int i = 0; i != specialSize; i += 2)
-    {
-        pSpecialAttrbts[i].Sort(CompareAttrbt);
-        pSpecialAttrbts[i + 1].Sort(CompareAttrbt);
+        // each family and strand has its own array that stays sorted by
+        // the first attribute, so no sorting is needed afterwards
+        InsertAttrbt(pSpecialAttrbts[arrayIndex], attrbt);
     }
 }
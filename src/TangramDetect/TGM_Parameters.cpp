@@ -28,10 +28,10 @@ using namespace Tangram;
 using namespace BamTools;
 
 // total number of arguments we should expect for the split-read build program
-#define OPT_TOTAL_ARGS       22
+#define OPT_TOTAL_ARGS       27
 
 // total number of required arguments we should expect for the split-read build program
-#define OPT_REQUIRED_ARGS    5
+#define OPT_REQUIRED_ARGS    4
 
 enum Options
 {
@@ -56,7 +56,12 @@ enum Options
     OPT_GT_SR_MIN_FRAG,
     OPT_MIN_JUMP_LEN,
     OPT_THREAD_NUM,
-    OPT_OUTPUT             
+    OPT_OUTPUT,
+    OPT_SP_SEEDS,
+    OPT_THREAD_TIME,
+    OPT_DECODE_STAT,
+    OPT_WINDOW_SIZE,
+    OPT_GT_BIN_SIZE
 };
 
 /*  
@@ -154,6 +159,10 @@ DetectPars::DetectPars()
     minMQ = DEFAULT_MIN_MQ;
 
     spMinMQ = DEFAULT_SPECIAL_MIN_MQ;
+
+    showDecodeStat = false;
+
+    windowSize = 0;
 }
 
 DetectPars::~DetectPars()
@@ -207,6 +216,11 @@ void Parameters::Set(const char** argv, int argc)
         {"mjl",  NULL, FALSE},
         {"p",  NULL, FALSE},
         {"out",  NULL, FALSE},
+        {"seed",  NULL, FALSE},
+        {"tm",  NULL, FALSE},
+        {"ds",  NULL, FALSE},
+        {"win",  NULL, FALSE},
+        {"gb",  NULL, FALSE},
         {NULL,   NULL, FALSE}
     };
 
@@ -438,6 +452,57 @@ void Parameters::Set(const char** argv, int argc)
                 break;
             case OPT_OUTPUT:
                 detectPars.outputPrefix = opts[i].value;
+                break;
+            case OPT_SP_SEEDS:
+                if (opts[i].isFound)
+                {
+                    if (opts[i].value != NULL)
+                        TGM_ErrQuit("ERROR: -seed is a flag. No argument is needed.\n");
+
+                    alignerPars.useSpSeeds = true;
+                }
+
+                break;
+            case OPT_THREAD_TIME:
+                if (opts[i].isFound)
+                {
+                    if (opts[i].value != NULL)
+                        TGM_ErrQuit("ERROR: -tm is a flag. No argument is needed.\n");
+
+                    alignerPars.showThreadTime = true;
+                }
+
+                break;
+            case OPT_DECODE_STAT:
+                if (opts[i].isFound)
+                {
+                    if (opts[i].value != NULL)
+                        TGM_ErrQuit("ERROR: -ds is a flag. No argument is needed.\n");
+
+                    detectPars.showDecodeStat = true;
+                }
+
+                break;
+            case OPT_WINDOW_SIZE:
+                if (opts[i].value != NULL)
+                {
+                    detectPars.windowSize = atoi(opts[i].value);
+                    if (detectPars.windowSize < 0)
+                        TGM_ErrQuit("ERROR: Invalid window size: %s\n", opts[i].value);
+                }
+
+                break;
+            case OPT_GT_BIN_SIZE:
+                if (opts[i].value != NULL)
+                {
+                    if (!genotypePars.doGenotype)
+                        TGM_ErrQuit("ERROR: Please turn on the genotype module (-gt).\n");
+
+                    genotypePars.binSize = atoi(opts[i].value);
+                    if (genotypePars.binSize < 0)
+                        TGM_ErrQuit("ERROR: Invalid genotype bin size: %s\n", opts[i].value);
+                }
+
                 break;
             default:
                 TGM_ErrQuit("ERROR: Unrecognized argument.\n");
@@ -540,15 +605,15 @@ void Parameters::ShowHelp(void) const
     printf("\nProgram: tangram (Toolbox for structural variation detection)\n");
     printf("Version: %s\n\n", TGM_VERSION);
 
-    printf("Usage: tangram_detect [options] -lb <library_info> -ht <fragment_length_histogram> -in <bam_list> -rg <regions> -ref <ref_file>\n\n");
+    printf("Usage: tangram_detect [options] -lb <library_info> -ht <fragment_length_histogram> -in <bam_list> -ref <ref_file>\n\n");
 
     printf("Mandatory arguments: -lb   FILE   library information file\n");
     printf("                     -ht   FILE   fragment length histogram file\n");
     printf("                     -in   FILE   list of all input bam files\n");
-    printf("                     -rg   STRING chromosome region (all the bam files must be sorted by chromosome positions and indexed)\n");
     printf("                     -ref  FILE   transfered reference sequence, required for split alignment\n\n");
 
-    printf("Options:             -out  STR    prefix to the output files, including the path [stdout]\n");
+    printf("Options:             -rg   STRING chromosome region (all the bam files must be sorted by chromosome positions and indexed) [whole genome]\n");
+    printf("                     -out  STR    prefix to the output files, including the path [stdout]\n");
     printf("                     -cl   INT    check for invalid libraries\n");
     printf("                     -mcs  INT    minimum cluster size [2]\n");
     printf("                     -mel  INT    minimum event lenth [100]\n");
@@ -563,14 +628,23 @@ void Parameters::ShowHelp(void) const
     printf("                     -rpf  INT    minimum number of supporting read-pair fragments for genotype [2]\n");
     printf("                     -srf  INT    minimum number of supporting split-read fragments for genotype [5]\n");
     printf("                     -mjl  INT    minimum jumping (bam index jump) length for genotyping. Set to 0 to turn off the jump [50000000]\n");
+    printf("                     -gb   INT    count the genotyping fragments in bins of INT bp while the bam files are read for detection.\n");
+    printf("                                  Set to 0 to read the bam files again around each locus [0]\n");
     printf("                     -p    INT    number of processors (threads) [1]\n");
+    printf("                     -seed FLAG   align split reads only to the special references sharing an 11-mer with them. Faster,\n");
+    printf("                                  but the alignments without an exact 11-mer are missed [false]\n");
+    printf("                     -tm   FLAG   print the busy and idle time of each split-read mapping thread to stderr [false]\n");
+    printf("                     -ds   FLAG   print the number of bam records read and decoded by the read-pair classifier and the memory of the lookup tables to stderr [false]\n");
+    printf("                     -win  INT    call each chromosome in windows of INT bp to bound the memory usage. Set to 0 to call the whole chromosome at once [0]\n");
     printf("                     -help        print this help message\n");
 
     printf("Notes:\n\n");
 
     printf("  1. A region should be presented in one of the following formats:\n\
      `1', `2:1000' and `X:1000-2000' (1-based). When a region is specified,\n\
-     the input alignment file must be an indexed BAM file.\n\n");
+     the input alignment file must be an indexed BAM file. Without a region,\n\
+     the whole genome is called chromosome by chromosome with `-p' threads,\n\
+     the longest chromosomes first, and the results go to a single VCF file.\n\n");
 
     printf("  2. Detection set is a bit set to indicate which types of SV will be detected.\n");
     printf("     Each bit in this bit set corresponding to a type of SV event:\n\n");
@@ -589,7 +663,16 @@ void Parameters::ShowHelp(void) const
 
     printf("  4. Minimum number of supporting read-pair or split-read fragments are the thresholds to trigger genotype module.\n");
     printf("     For a given locus, if the number of both read-pair AND split-read supporting fragments are lower than the\n");
-    printf("     thresholds (-rpf -srf) this locus will not be submitted for genotyping.\n");
+    printf("     thresholds (-rpf -srf) this locus will not be submitted for genotyping.\n\n");
+
+    printf("  5. With a window size (-win) only the pairs of one window, plus an overlap of\n\
+     two maximum fragment lengths on each side, are held in memory at a time.\n\
+     Every event is reported by the window it starts in.\n\n");
+
+    printf("  6. With a genotype bin size (-gb) the bam files are only read once. The reads and\n\
+     the pairs around a locus are counted by the bins they fall in, so the counts are\n\
+     approximate. A bin size of 1 gives the exact counts of the second pass. The memory\n\
+     grows with the number of reads and pairs in a region; larger bins merge more of them.\n");
 
     exit(EXIT_SUCCESS);
 }
@@ -126,6 +126,12 @@ namespace Tangram
             unsigned char minMQ;
 
             unsigned char spMinMQ;
+
+            // print how many bam records were decoded by the read-pair classifier
+            bool showDecodeStat;
+
+            // call each chromosome in windows of this size, 0 for the whole chromosome at once
+            int32_t windowSize;
     };
 
     struct AlignerPars
@@ -158,6 +164,12 @@ namespace Tangram
 
         int numThread;
 
+        // align the second partials only to the special references with k-mer seed hits
+        bool useSpSeeds;
+
+        // print the busy and idle time of the mapping threads
+        bool showThreadTime;
+
         double minScoreRate;
 
         double minEntropy;
@@ -186,6 +198,8 @@ namespace Tangram
             minAlignedLen = DEFAULT_MIN_ALIGNED_LEN;
             minTriggerLen = DEFAULT_MIN_TRIGGER_LEN;
             numThread = DEFAULT_THREAD_NUM;
+            useSpSeeds = false;
+            showThreadTime = false;
             minScoreRate = DEFAULT_MIN_SCORE_RATE;
             minEntropy = DEFAULT_MIN_ENTROPY;
             maxMisMatchRate = DEFAULT_MAX_MISMATCH_RATE;
@@ -214,6 +228,9 @@ namespace Tangram
 
         int32_t minJumpLen;
 
+        // bin size of the fragment counts collected with the detection pass (0 to read the bam files again)
+        int32_t binSize;
+
         double p[3];  // parameters for calculating the binomial pdf
 
         GenotypePars()
@@ -230,6 +247,8 @@ namespace Tangram
 
             minJumpLen = DEFAULT_MIN_JUMP_LEN;
 
+            binSize = 0;
+
             // parameters for binominal distribution
             p[0] = 0.999;   // homozygous reference
             p[1] = 0.5;     // heterozygous
@@ -25,11 +25,18 @@ using namespace std;
 using namespace Tangram;
 
 
-Printer::Printer(const Detector* pDetector, const DetectPars& detectPars, const Aligner* pAligner, const Reference* pRef, 
+Printer::Printer(const Detector* pDetector, const DetectPars& detectPars, const Aligner* pAligner, const Reference* pRef, const ChromView* pChrom,
                  const LibTable& libTable, const BamPairTable& bamPairTable, const GenotypePars& genotypePars, Genotype& genotype)
-                : pDetector(pDetector), detectPars(detectPars), pAligner(pAligner), pRef(pRef), libTable(libTable), 
+                : pDetector(pDetector), detectPars(detectPars), pAligner(pAligner), pRef(pRef), pChrom(pChrom), libTable(libTable), 
                   bamPairTable(bamPairTable), genotypePars(genotypePars), genotype(genotype)
 {
+    fpOutput = NULL;
+
+    range[0] = -1;
+    range[1] = -1;
+
+    printHeader = true;
+
   #ifdef TD_VERBOSE_DEBUG
   fprintf(stderr, "familyMap:\n");
   for (unsigned int i = 0; i < pRef->familyMap.Size(); ++i) {
@@ -67,21 +74,28 @@ void Printer::Print(void)
     {
         element = *(printElmnts.begin());
         bool hasGenotype = false;
-        switch(element.svType)
-        {
-            case SV_SPECIAL:
-                PrintSpecial(element);
-                hasGenotype = genotype.Special(element.pRpSpecial, element.pSplitEvent);
 
-                if (genotypePars.doGenotype)
-                    PrintGenotype(genotype, hasGenotype);
-                else
-                    PrintSampleInfo(genotype);
-                break;
-            case SV_INVERSION:
-                break;
-            default:
-                break;
+        // the events out of the range are skipped without genotyping
+        bool isInRange = (range[0] < 0 || element.pos >= range[0]) && (range[1] < 0 || element.pos < range[1]);
+
+        if (isInRange)
+        {
+            switch(element.svType)
+            {
+                case SV_SPECIAL:
+                    PrintSpecial(element);
+                    hasGenotype = genotype.Special(element.pRpSpecial, element.pSplitEvent);
+
+                    if (genotypePars.doGenotype)
+                        PrintGenotype(genotype, hasGenotype);
+                    else
+                        PrintSampleInfo(genotype);
+                    break;
+                case SV_INVERSION:
+                    break;
+                default:
+                    break;
+            }
         }
 
         int road = element.subsetIdx;
@@ -272,7 +286,9 @@ void Printer::PrintHeader(void)
             case SV_SPECIAL:
                 if ((detectPars.detectSet & (1 << shiftSize)) != 0)
                 {
-                    if (detectPars.outputPrefix != NULL)
+                    if (fpOutput != NULL)
+                        outputGrp.fpSpecial = fpOutput;
+                    else if (detectPars.outputPrefix != NULL)
                     {
                         string outputFile(detectPars.outputPrefix);
                         outputFile += ".mei.vcf";
@@ -281,7 +297,8 @@ void Printer::PrintHeader(void)
                             TGM_ErrQuit("Error: Cannot open the MEI VCF file: %s\n", outputFile.c_str());
                     }
 
-                    PrintSpecialHeader();
+                    if (printHeader)
+                        PrintSpecialHeader();
                 }
                 break;
             case SV_INTER_CHR_TRNSLCTN:
@@ -412,7 +429,7 @@ void Printer::PrintSpecial(const PrintElmnt& element)
     }
 
     int splitFrag = features.splitFrag[0] + features.splitFrag[1];
-    char refChar = char_table[pRef->refSeq[features.pos - pRef->pos]];
+    char refChar = char_table[pChrom->GetRefBase(features.pos)];
 
     formatted.clear();
     formatted.str("");
@@ -106,7 +106,7 @@ namespace Tangram
     class Printer
     {
         public:
-            Printer(const Detector* pDetector, const DetectPars& detectPars, const Aligner* pAligner, const Reference* pRef, 
+            Printer(const Detector* pDetector, const DetectPars& detectPars, const Aligner* pAligner, const Reference* pRef, const ChromView* pChrom,
                     const LibTable& libTable, const BamPairTable& bamPairTable, const GenotypePars& genotypePars, Genotype& genotype);
 
             ~Printer();
@@ -115,6 +115,26 @@ namespace Tangram
 
             void Print();
 
+            // print into an opened file instead of the standard output or the prefixed output file
+            // the file is not closed by the printer
+            inline void SetOutput(FILE* fpOutput)
+            {
+                this->fpOutput = fpOutput;
+            }
+
+            // only print the events starting in [start, end)
+            inline void SetRange(int32_t start, int32_t end)
+            {
+                range[0] = start;
+                range[1] = end;
+            }
+
+            // turn off the VCF header when the output continues a previous one
+            inline void SetHeader(bool printHeader)
+            {
+                this->printHeader = printHeader;
+            }
+
         private:
 
             inline void InitOutputGrp(void)
@@ -159,13 +179,13 @@ namespace Tangram
 
             inline void CloseOutputGrp(void)
             {
-                if (outputGrp.fpDel != NULL)
+                if (outputGrp.fpDel != NULL && outputGrp.fpDel != fpOutput)
                     fclose(outputGrp.fpDel);
 
-                if (outputGrp.fpInv != NULL)
+                if (outputGrp.fpInv != NULL && outputGrp.fpInv != fpOutput)
                     fclose(outputGrp.fpInv);
 
-                if (outputGrp.fpSpecial != NULL)
+                if (outputGrp.fpSpecial != NULL && outputGrp.fpSpecial != fpOutput)
                     fclose(outputGrp.fpSpecial);
             }
 
@@ -195,6 +215,13 @@ namespace Tangram
 
             OutputGroup outputGrp;
 
+            FILE* fpOutput;
+
+            // range of the printed events, no limit if negative
+            int32_t range[2];
+
+            bool printHeader;
+
             PrintFeatures features;
 
             std::multiset<PrintElmnt> printElmnts;
@@ -211,6 +238,8 @@ namespace Tangram
 
             const Reference* pRef;
 
+            const ChromView* pChrom;
+
             const LibTable& libTable;
 
             const BamPairTable& bamPairTable;
@@ -0,0 +1,121 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_ProfilePool.cpp
+ *
+ *    Description:  Per-thread cache of the SSW query profiles of reads
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 03:48:55 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+#include <stdlib.h>
+
+#include "TGM_Error.h"
+#include "TGM_ProfilePool.h"
+
+using namespace Tangram;
+
+// the edge length of the substitution matrix
+#define SCORE_MATRIX_SIZE 5
+
+ProfilePool::ProfilePool(const int8_t* mat, unsigned int capacity) : mat(mat), capacity(capacity)
+{
+    bias = 0;
+    maxScore = 0;
+    for (unsigned int i = 0; i != SCORE_MATRIX_SIZE * SCORE_MATRIX_SIZE; ++i)
+    {
+        if (mat[i] < bias)
+            bias = mat[i];
+
+        if (mat[i] > maxScore)
+            maxScore = mat[i];
+    }
+
+    bias = abs(bias);
+
+    slots = (ReadProfile*) calloc(capacity, sizeof(ReadProfile));
+    if (slots == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the profile pool.\n");
+
+    next = 0;
+}
+
+ProfilePool::~ProfilePool()
+{
+    for (unsigned int i = 0; i != capacity; ++i)
+    {
+        for (unsigned int j = 0; j != 2; ++j)
+        {
+            TGM_SeqClean(&(slots[i].seqs[j]));
+
+            if (slots[i].profiles[j] != NULL)
+                init_destroy(slots[i].profiles[j]);
+        }
+    }
+
+    free(slots);
+}
+
+const int8_t* ProfilePool::GetSeq(const ReadArena& reads, unsigned int idx, uint8_t strand)
+{
+    ReadProfile& readProfile = Find(reads, idx);
+    if (!readProfile.hasSeq[0])
+    {
+        reads.Get(&(readProfile.seqs[0]), idx);
+        readProfile.hasSeq[0] = true;
+    }
+
+    if (strand == 1 && !readProfile.hasSeq[1])
+    {
+        TGM_SeqDup(&(readProfile.seqs[1]), &(readProfile.seqs[0]));
+        TGM_SeqRevComp(&(readProfile.seqs[1]));
+        readProfile.hasSeq[1] = true;
+    }
+
+    return readProfile.seqs[strand].seq;
+}
+
+const s_profile* ProfilePool::GetProfile(const ReadArena& reads, unsigned int idx, uint8_t strand)
+{
+    ReadProfile& readProfile = Find(reads, idx);
+    if (!readProfile.isBuilt[strand])
+    {
+        const int8_t* readSeq = GetSeq(reads, idx, strand);
+        int readLen = reads.GetLen(idx);
+
+        // the word profile is only needed when the byte score may overflow
+        int8_t scoreSize = readLen * maxScore + bias < 255 ? 0 : 2;
+
+        readProfile.profiles[strand] = ssw_reinit(readProfile.profiles[strand], readSeq, readLen, mat, SCORE_MATRIX_SIZE, scoreSize);
+        readProfile.isBuilt[strand] = true;
+    }
+
+    return readProfile.profiles[strand];
+}
+
+ReadProfile& ProfilePool::Find(const ReadArena& reads, unsigned int idx)
+{
+    for (unsigned int i = 0; i != capacity; ++i)
+    {
+        if (slots[i].pReads == &reads && slots[i].idx == idx)
+            return slots[i];
+    }
+
+    // replace the oldest read
+    ReadProfile& readProfile = slots[next];
+    next = (next + 1) % capacity;
+
+    readProfile.pReads = &reads;
+    readProfile.idx = idx;
+    readProfile.isBuilt[0] = false;
+    readProfile.isBuilt[1] = false;
+    readProfile.hasSeq[0] = false;
+    readProfile.hasSeq[1] = false;
+
+    return readProfile;
+}
@@ -0,0 +1,84 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_ProfilePool.h
+ *
+ *    Description:  Per-thread cache of the SSW query profiles of reads
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 03:48:55 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+#ifndef  TGM_PROFILEPOOL_H
+#define  TGM_PROFILEPOOL_H
+
+#include "../OutSources/stripedSW/ssw.h"
+#include "TGM_Sequence.h"
+#include "TGM_ReadArena.h"
+
+namespace Tangram
+{
+    // default number of reads whose profiles are kept by a thread
+    static const unsigned int DEFAULT_PROFILE_POOL_SIZE = 4;
+
+    // the query profiles of both strands of a read
+    struct ReadProfile
+    {
+        const ReadArena* pReads;     // the arena of the read these profiles are built for
+
+        unsigned int idx;            // index of the read in its arena
+
+        TGM_Sequence seqs[2];        // 0: the read as it is stored; 1: its reverse complement
+
+        s_profile* profiles[2];
+
+        bool isBuilt[2];
+
+        bool hasSeq[2];
+    };
+
+    // A thread keeps the profiles of the last few reads it aligned. A read
+    // is unpacked from its arena, and the profile and the reverse complement
+    // of a strand are built at most once for it. The sequence and profile
+    // buffers are recycled from one read to the next instead of being
+    // allocated for every alignment.
+    class ProfilePool
+    {
+        public:
+            ProfilePool(const int8_t* mat, unsigned int capacity = DEFAULT_PROFILE_POOL_SIZE);
+            ~ProfilePool();
+
+            // sequence of a strand of the read (0: as it is stored; 1: reverse complement)
+            const int8_t* GetSeq(const ReadArena& reads, unsigned int idx, uint8_t strand);
+
+            // query profile of a strand of the read
+            const s_profile* GetProfile(const ReadArena& reads, unsigned int idx, uint8_t strand);
+
+        private:
+
+            ReadProfile& Find(const ReadArena& reads, unsigned int idx);
+
+        private:
+
+            const int8_t* mat;
+
+            // the smallest matrix value, the bias of the byte profile
+            int bias;
+
+            // the largest matrix value
+            int maxScore;
+
+            ReadProfile* slots;
+
+            unsigned int capacity;
+
+            // next slot to be replaced
+            unsigned int next;
+    };
+};
+
+#endif  /*TGM_PROFILEPOOL_H*/
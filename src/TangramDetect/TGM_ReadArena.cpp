@@ -0,0 +1,139 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_ReadArena.cpp
+ *
+ *    Description:  Read sequences packed back to back in one buffer
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 04:32:28 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "TGM_Error.h"
+#include "TGM_ReadArena.h"
+
+using namespace Tangram;
+
+// numeric base at a position of a read, counted on the reverse complement if required
+static inline int8_t GetBase(const char* bases, unsigned int len, unsigned int i, bool isRevComp)
+{
+    if (isRevComp)
+        return rc_table[(int) nt_table[(int8_t) bases[len - 1 - i]]];
+
+    return nt_table[(int8_t) bases[i]];
+}
+
+ReadArena::ReadArena()
+{
+
+}
+
+ReadArena::~ReadArena()
+{
+
+}
+
+void ReadArena::Init(unsigned int numReads, unsigned int numBytes)
+{
+    reads.Init(numReads);
+    buffer.Init(numBytes);
+}
+
+void ReadArena::Add(const char* bases, unsigned int len, bool isRevComp)
+{
+    PackedRead packedRead;
+    packedRead.offset = buffer.Size();
+    packedRead.len = len;
+    packedRead.hasN = 0;
+
+    // an N is packed as an A and set later in the mask
+    uint8_t* pSeq = Expand((len + 3) / 4);
+    for (unsigned int i = 0; i != len; ++i)
+    {
+        int8_t base = GetBase(bases, len, i, isRevComp);
+        if (base > 3)
+            packedRead.hasN = 1;
+        else
+            pSeq[i >> 2] |= base << ((i & 3) << 1);
+    }
+
+    if (packedRead.hasN)
+    {
+        uint8_t* pMask = Expand((len + 7) / 8);
+        for (unsigned int i = 0; i != len; ++i)
+        {
+            if (GetBase(bases, len, i, isRevComp) > 3)
+                pMask[i >> 3] |= 1 << (i & 7);
+        }
+    }
+
+    reads.Append(&packedRead, 1);
+}
+
+void ReadArena::Get(TGM_Sequence* pRead, unsigned int idx) const
+{
+    const PackedRead& packedRead = reads[idx];
+    size_t len = packedRead.len;
+
+    if (len + 1 >= pRead->cap)
+    {
+        pRead->cap = len + 2;
+        kroundup32(pRead->cap);
+        pRead->seq = (int8_t*) realloc(pRead->seq, pRead->cap * sizeof(int8_t));
+        if (pRead->seq == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the sequence.\n");
+    }
+
+    const uint8_t* pSeq = buffer.GetPointer(packedRead.offset);
+    for (unsigned int i = 0; i != len; ++i)
+        pRead->seq[i] = (pSeq[i >> 2] >> ((i & 3) << 1)) & 3;
+
+    if (packedRead.hasN)
+    {
+        const uint8_t* pMask = pSeq + (len + 3) / 4;
+        for (unsigned int i = 0; i != len; ++i)
+        {
+            if ((pMask[i >> 3] >> (i & 7)) & 1)
+                pRead->seq[i] = 4;
+        }
+    }
+
+    pRead->len = len;
+}
+
+void ReadArena::Append(ReadArena& other)
+{
+    unsigned int shift = buffer.Size();
+    unsigned int start = reads.Size();
+
+    reads.Append(other.reads.GetPointer(0), other.reads.Size());
+    buffer.Append(other.buffer.GetPointer(0), other.buffer.Size());
+
+    unsigned int size = reads.Size();
+    for (unsigned int i = start; i != size; ++i)
+        reads[i].offset += shift;
+
+    other.Clear();
+}
+
+uint8_t* ReadArena::Expand(unsigned int num)
+{
+    unsigned int oldSize = buffer.Size();
+    unsigned int newSize = oldSize + num;
+    if (newSize > buffer.Capacity())
+        buffer.Resize(newSize * 2);
+
+    buffer.SetSize(newSize);
+
+    uint8_t* pBytes = buffer.GetPointer(oldSize);
+    memset(pBytes, 0, num);
+
+    return pBytes;
+}
@@ -0,0 +1,85 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_ReadArena.h
+ *
+ *    Description:  Read sequences packed back to back in one buffer
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 04:32:28 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+#ifndef  TGM_READARENA_H
+#define  TGM_READARENA_H
+
+#include <stdint.h>
+
+#include "TGM_Array.h"
+#include "TGM_Sequence.h"
+
+namespace Tangram
+{
+    // location of a read in the arena buffer
+    struct PackedRead
+    {
+        uint32_t offset;            // offset of the packed bases in the buffer (bytes)
+
+        uint32_t len:31, hasN:1;    // read length, whether an N mask follows the packed bases
+    };
+
+    // A read is stored with 2 bits per base (A:0, C:1, G:2, T:3). Only the
+    // reads with ambiguous bases are followed by a mask with 1 bit per base
+    // that marks the Ns. The arena is filled while the bam files are loaded and
+    // is read only afterwards, so the mapping threads can unpack reads concurrently.
+    class ReadArena
+    {
+        public:
+            ReadArena();
+            ~ReadArena();
+
+            void Init(unsigned int numReads, unsigned int numBytes);
+
+            // pack a read given in bam letters, reverse complemented if required
+            void Add(const char* bases, unsigned int len, bool isRevComp);
+
+            // unpack a read into numeric bases (A:0, C:1, G:2, T:3, N:4)
+            void Get(TGM_Sequence* pRead, unsigned int idx) const;
+
+            // move the reads of another arena to the end of this one
+            // the other arena is left empty and keeps its memory for reuse
+            void Append(ReadArena& other);
+
+            inline void Clear(void)
+            {
+                reads.Clear();
+                buffer.Clear();
+            }
+
+            inline unsigned int GetLen(unsigned int idx) const
+            {
+                return reads[idx].len;
+            }
+
+            inline unsigned int Size(void) const
+            {
+                return reads.Size();
+            }
+
+        private:
+
+            // grow the buffer by a number of zeroed bytes and return the first of them
+            uint8_t* Expand(unsigned int num);
+
+        private:
+
+            Array<PackedRead> reads;
+
+            Array<uint8_t> buffer;
+    };
+};
+
+#endif  /*TGM_READARENA_H*/
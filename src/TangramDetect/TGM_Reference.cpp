@@ -16,8 +16,12 @@
  * =====================================================================================
  */
 
+#include <pthread.h>
 #include <cstring>
 #include <map>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
 
 #include "../OutSources/util/md5.h"
 #include "kseq.h"
@@ -55,15 +59,260 @@ static void SeqTransfer(char* seq, unsigned int len)
     for (unsigned int i = 0; i != len; ++i)
         seq[i] = nt_table[ (int) seq[i]];
 }
+
+static bool CompareSpKmer(const SpKmer& a, const SpKmer& b)
+{
+    if (a.kmer != b.kmer)
+        return a.kmer < b.kmer;
+
+    return a.spRefID < b.spRefID;
+}
+
+static bool CompareSpKmerKey(const SpKmer& a, uint32_t kmer)
+{
+    return a.kmer < kmer;
+}
+
+static bool CompareRunEnd(const NRun& run, uint64_t pos)
+{
+    return (uint64_t) run.start + run.len <= pos;
+}
+
+// the four bases packed in every possible byte, so that a byte is unpacked with one copy
+static struct UnpackTable
+{
+    UnpackTable()
+    {
+        for (unsigned int i = 0; i != 256; ++i)
+        {
+            for (unsigned int j = 0; j != 4; ++j)
+                bases[i][j] = (i >> (j << 1)) & 3;
+        }
+    }
+
+    int8_t bases[256][4];
+
+} unpackTable;
+
+static void SetMd5String(char* md5String, const char* sequence, uint32_t seqLen)
+{
+    unsigned char MD5[MD5_CHECKSUM_LEN];
+    memset(MD5, 0, MD5_CHECKSUM_LEN);
+
+    MD5_CTX context;
+    MD5Init(&context);
+    MD5Update(&context, (unsigned char*) sequence, seqLen);
+    MD5Final(MD5, &context);
+
+    for (unsigned int i = 0; i != MD5_CHECKSUM_LEN; ++i)
+    {
+        sprintf(md5String, "%02X", MD5[i]);
+        md5String += 2;
+    }
+}
+
+// pack the bases with 2 bits each. an N is packed as an A and recorded in the run table
+static void PackBases(Array<uint8_t>& packed, Array<NRun>& nRuns, const int8_t* seq, uint64_t len)
+{
+    uint64_t numBytes = (len + 3) / 4;
+    packed.Init(numBytes);
+    packed.MemSet(0);
+    packed.SetSize(numBytes);
+
+    nRuns.Clear();
+
+    for (uint64_t i = 0; i != len; ++i)
+    {
+        if (seq[i] >= 0 && seq[i] <= 3)
+        {
+            packed[i >> 2] |= seq[i] << ((i & 3) << 1);
+            continue;
+        }
+
+        if (nRuns.Size() > 0 && nRuns.Last().start + nRuns.Last().len == i)
+            ++(nRuns.Last().len);
+        else
+        {
+            NRun nRun = {(uint32_t) i, 1};
+            nRuns.Append(&nRun, 1);
+        }
+    }
+}
+
+// record a packed sequence in the header and write its bases
+static void WritePacked(RefHeader& header, const Array<uint8_t>& packed, const Array<NRun>& nRuns, FILE* fpRefOutput)
+{
+    unsigned int numSeq = header.packedPos.Size();
+    if (header.packedPos.IsFull())
+    {
+        header.packedPos.Resize(numSeq * 2);
+        header.runBegins.Resize(numSeq * 2);
+    }
+
+    header.packedPos[numSeq] = ftello(fpRefOutput);
+    header.packedPos.Increment();
+
+    header.runBegins[numSeq] = header.nRuns.Size();
+    header.runBegins.Increment();
+
+    if (nRuns.Size() > 0)
+        header.nRuns.Append(nRuns.GetPointer(0), nRuns.Size());
+
+    uint64_t numBytes = packed.Size();
+    uint64_t writeSize = fwrite(packed.GetPointer(0), sizeof(uint8_t), numBytes, fpRefOutput);
+    if (writeSize != numBytes)
+        TGM_ErrQuit("ERROR: Cannot write the reference sequence into the file.\n");
+}
+
+enum ContigState
+{
+    CONTIG_EMPTY = 0,
+    CONTIG_READ,
+    CONTIG_DONE
+};
+
+// a contig on its way through the index pipeline
+struct ContigJob
+{
+    char* name;
+
+    char* seq;
+
+    uint64_t len;
+
+    char md5[MD5_STR_LEN + 1];
+
+    // packed format only
+    Array<uint8_t> packed;
+
+    Array<NRun> nRuns;
+
+    ContigState state;
+};
+
+// The contigs are read by one thread, encoded (MD5, base transfer and packing)
+// by the workers and written in the order of the fasta file by the thread that
+// builds the index. The jobs form a ring that bounds the number of contigs in memory.
+struct ContigPipeline
+{
+    ContigJob* jobs;
+
+    unsigned int numJobs;
+
+    // number of contigs read from the fasta file
+    uint64_t numRead;
+
+    // number of contigs taken by the workers
+    uint64_t numTaken;
+
+    // all the contigs are read
+    bool isEnd;
+
+    bool isPacked;
+
+    gzFile fpFastaInput;
+
+    pthread_mutex_t mutex;
+
+    pthread_cond_t cond;
+};
+
+static void* ReadContigs(void* data)
+{
+    ContigPipeline& pipeline = *((ContigPipeline*) data);
+    kseq_t* seq = kseq_init(pipeline.fpFastaInput);
+
+    while (kseq_read(seq) >= 0)
+    {
+        if (seq->name.l <= 0 || seq->seq.l <= 0)
+            continue;
+
+        ContigJob& job = pipeline.jobs[pipeline.numRead % pipeline.numJobs];
+
+        pthread_mutex_lock(&pipeline.mutex);
+        while (job.state != CONTIG_EMPTY)
+            pthread_cond_wait(&pipeline.cond, &pipeline.mutex);
+        pthread_mutex_unlock(&pipeline.mutex);
+
+        job.name = (char*) malloc((seq->name.l + 1) * sizeof(char));
+        if (job.name == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the reference name.\n");
+
+        strcpy(job.name, seq->name.s);
+
+        // take over the sequence buffer, kseq allocates a new one for the next contig
+        job.seq = seq->seq.s;
+        job.len = seq->seq.l;
+        seq->seq.s = NULL;
+        seq->seq.m = 0;
+
+        pthread_mutex_lock(&pipeline.mutex);
+        job.state = CONTIG_READ;
+        ++(pipeline.numRead);
+        pthread_cond_broadcast(&pipeline.cond);
+        pthread_mutex_unlock(&pipeline.mutex);
+    }
+
+    kseq_destroy(seq);
+
+    pthread_mutex_lock(&pipeline.mutex);
+    pipeline.isEnd = true;
+    pthread_cond_broadcast(&pipeline.cond);
+    pthread_mutex_unlock(&pipeline.mutex);
+
+    pthread_exit(NULL);
+}
+
+static void* EncodeContigs(void* data)
+{
+    ContigPipeline& pipeline = *((ContigPipeline*) data);
+
+    while (true)
+    {
+        pthread_mutex_lock(&pipeline.mutex);
+        while (pipeline.numTaken == pipeline.numRead && !pipeline.isEnd)
+            pthread_cond_wait(&pipeline.cond, &pipeline.mutex);
+
+        if (pipeline.numTaken == pipeline.numRead)
+        {
+            pthread_mutex_unlock(&pipeline.mutex);
+            break;
+        }
+
+        ContigJob& job = pipeline.jobs[pipeline.numTaken % pipeline.numJobs];
+        ++(pipeline.numTaken);
+        pthread_mutex_unlock(&pipeline.mutex);
+
+        SetMd5String(job.md5, job.seq, job.len);
+        SeqTransfer(job.seq, job.len);
+
+        if (pipeline.isPacked)
+            PackBases(job.packed, job.nRuns, (const int8_t*) job.seq, job.len);
+
+        pthread_mutex_lock(&pipeline.mutex);
+        job.state = CONTIG_DONE;
+        pthread_cond_broadcast(&pipeline.cond);
+        pthread_mutex_unlock(&pipeline.mutex);
+    }
+
+    pthread_exit(NULL);
+}
 } // end namespace Tangram
 
 Reference::Reference()
 {
+    formatVersion = 1;
+    dataBegin = sizeof(int64_t);
 
+    pMap = NULL;
+    mapLen = 0;
 }
 
 Reference::~Reference()
 {
+    if (pMap != NULL)
+        munmap(pMap, mapLen);
+
     for (unsigned int i = 0; i != refHeader.names.Size(); ++i)
         free(refHeader.names[i]);
 
@@ -71,11 +320,27 @@ Reference::~Reference()
         free(spRefHeader.names[i]);
 }
 
-void Reference::Create(gzFile fpRefFastaInput, gzFile fpSpRefFastaInput, FILE* fpRefOutput)
+void Reference::Create(gzFile fpRefFastaInput, gzFile fpSpRefFastaInput, FILE* fpRefOutput, bool isPacked, int numThread)
 {
     int64_t headerPos = 0;
+    unsigned int writeSize = 0;
+
+    formatVersion = 1;
+    dataBegin = sizeof(int64_t);
+
+    // the packed format starts with its negative version number
+    if (isPacked)
+    {
+        formatVersion = REF_FORMAT_PACKED;
+        dataBegin += sizeof(int64_t);
 
-    unsigned int writeSize = fwrite(&headerPos, sizeof(int64_t), 1, fpRefOutput);
+        int64_t version = -REF_FORMAT_PACKED;
+        writeSize = fwrite(&version, sizeof(int64_t), 1, fpRefOutput);
+        if (writeSize != 1)
+            TGM_ErrQuit("ERROR: Cannot write the reference format version.\n");
+    }
+
+    writeSize = fwrite(&headerPos, sizeof(int64_t), 1, fpRefOutput);
     if (writeSize != 1)
         TGM_ErrQuit("ERROR: Cannot write the reference header position.\n");
 
@@ -84,8 +349,12 @@ void Reference::Create(gzFile fpRefFastaInput, gzFile fpSpRefFastaInput, FILE* f
     if (fpSpRefFastaInput != NULL)
         CreateRef(spRefHeader, fpSpRefFastaInput, fpRefOutput, hasPadding);
 
+    // the special references are small, only the genome is worth the threads
     hasPadding = false;
-    CreateRef(refHeader, fpRefFastaInput, fpRefOutput, hasPadding);
+    if (numThread > 1)
+        CreateRefThreads(refHeader, fpRefFastaInput, fpRefOutput, numThread);
+    else
+        CreateRef(refHeader, fpRefFastaInput, fpRefOutput, hasPadding);
 
     WriteHeader(fpRefOutput);
 }
@@ -102,6 +371,12 @@ void Reference::CreateRef(RefHeader& header, gzFile fpRefFastaInput, FILE* fpRef
     kseq_t* seq = kseq_init(fpRefFastaInput);
 
     bool isFirst = true;
+    bool isPacked = (formatVersion == REF_FORMAT_PACKED);
+
+    // the special references are packed together with the padding when all of them are read
+    Array<int8_t> spSeq;
+    if (isPacked && hasPadding)
+        spSeq.Init(DEFAULT_PADDING_LEN);
 
     while ((ret = kseq_read(seq)) >= 0)
     {
@@ -111,9 +386,14 @@ void Reference::CreateRef(RefHeader& header, gzFile fpRefFastaInput, FILE* fpRef
         unsigned int writeSize = 0;
         if (hasPadding && !isFirst)
         {
-            writeSize = fwrite(padding, sizeof(int8_t), DEFAULT_PADDING_LEN, fpRefOutput);
-            if (writeSize != DEFAULT_PADDING_LEN)
-                TGM_ErrQuit("ERROR: Cannot write the reference sequence into the file.\n");
+            if (isPacked)
+                spSeq.Append(padding, DEFAULT_PADDING_LEN);
+            else
+            {
+                writeSize = fwrite(padding, sizeof(int8_t), DEFAULT_PADDING_LEN, fpRefOutput);
+                if (writeSize != DEFAULT_PADDING_LEN)
+                    TGM_ErrQuit("ERROR: Cannot write the reference sequence into the file.\n");
+            }
 
             seqLen += DEFAULT_PADDING_LEN;
         }
@@ -138,19 +418,180 @@ void Reference::CreateRef(RefHeader& header, gzFile fpRefFastaInput, FILE* fpRef
 
         SeqTransfer(seq->seq.s, seq->seq.l);
 
+        if (isPacked)
+        {
+            if (hasPadding)
+                spSeq.Append((const int8_t*) seq->seq.s, seq->seq.l);
+            else
+                PackSeq(header, (const int8_t*) seq->seq.s, seq->seq.l, fpRefOutput);
+
+            continue;
+        }
+
         writeSize = fwrite(seq->seq.s, sizeof(int8_t), seq->seq.l, fpRefOutput);
         if (writeSize != seq->seq.l)
             TGM_ErrQuit("ERROR: Cannot write the reference sequence into the file.\n");
     }
 
+    if (spSeq.Size() > 0)
+        PackSeq(header, spSeq.GetPointer(0), spSeq.Size(), fpRefOutput);
+
     kseq_destroy(seq);
 }
 
+void Reference::CreateRefThreads(RefHeader& header, gzFile fpRefFastaInput, FILE* fpRefOutput, int numThread)
+{
+    InitRefHeader(header);
+
+    ContigPipeline pipeline;
+    pipeline.numJobs = 2 * numThread;
+    pipeline.jobs = new ContigJob[pipeline.numJobs];
+    pipeline.numRead = 0;
+    pipeline.numTaken = 0;
+    pipeline.isEnd = false;
+    pipeline.isPacked = (formatVersion == REF_FORMAT_PACKED);
+    pipeline.fpFastaInput = fpRefFastaInput;
+
+    for (unsigned int i = 0; i != pipeline.numJobs; ++i)
+        pipeline.jobs[i].state = CONTIG_EMPTY;
+
+    if (pthread_mutex_init(&pipeline.mutex, NULL) != 0 || pthread_cond_init(&pipeline.cond, NULL) != 0)
+        TGM_ErrQuit("ERROR: Cannot initialize the mutex.\n");
+
+    // make the thread joinable
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+
+    // one reader thread and the workers
+    pthread_t* threads = (pthread_t*) malloc((numThread + 1) * sizeof(pthread_t));
+    if (threads == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the index threads.\n");
+
+    for (int i = 0; i <= numThread; ++i)
+    {
+        int ret = pthread_create(&(threads[i]), &attr, (i == 0 ? &ReadContigs : &EncodeContigs), (void*) &pipeline);
+        if (ret != 0)
+            TGM_ErrQuit("ERROR: Unable to create threads.\n");
+    }
+
+    pthread_attr_destroy(&attr);
+
+    // write the contigs in the order of the fasta file so that the header is the same as a single thread one
+    uint64_t seqLen = 0;
+    for (uint64_t i = 0; ; ++i)
+    {
+        ContigJob& job = pipeline.jobs[i % pipeline.numJobs];
+
+        pthread_mutex_lock(&pipeline.mutex);
+        while (job.state != CONTIG_DONE && !(pipeline.isEnd && i == pipeline.numRead))
+            pthread_cond_wait(&pipeline.cond, &pipeline.mutex);
+
+        bool isDone = (job.state != CONTIG_DONE);
+        pthread_mutex_unlock(&pipeline.mutex);
+
+        if (isDone)
+            break;
+
+        unsigned int numRef = header.names.Size();
+        if (header.names.IsFull())
+        {
+            header.names.Resize(numRef * 2);
+            header.endPos.Resize(numRef * 2);
+            header.md5.Resize(numRef * MD5_STR_LEN * 2 + 1);
+        }
+
+        header.names[numRef] = job.name;
+        header.names.Increment();
+
+        seqLen += job.len;
+        header.endPos[numRef] = seqLen - 1;
+        header.endPos.Increment();
+
+        unsigned int md5Len = header.md5.Size();
+        memcpy(header.md5.GetPointer(md5Len), job.md5, MD5_STR_LEN);
+        header.md5.SetSize(md5Len + MD5_STR_LEN);
+
+        if (pipeline.isPacked)
+            WritePacked(header, job.packed, job.nRuns, fpRefOutput);
+        else
+        {
+            uint64_t writeSize = fwrite(job.seq, sizeof(int8_t), job.len, fpRefOutput);
+            if (writeSize != job.len)
+                TGM_ErrQuit("ERROR: Cannot write the reference sequence into the file.\n");
+        }
+
+        free(job.seq);
+        job.seq = NULL;
+        job.name = NULL;
+
+        pthread_mutex_lock(&pipeline.mutex);
+        job.state = CONTIG_EMPTY;
+        pthread_cond_broadcast(&pipeline.cond);
+        pthread_mutex_unlock(&pipeline.mutex);
+    }
+
+    for (int i = 0; i <= numThread; ++i)
+    {
+        void* status;
+        int ret = pthread_join(threads[i], &status);
+        if (ret != 0)
+            TGM_ErrQuit("ERROR: Unable to join threads.\n");
+    }
+
+    free(threads);
+
+    pthread_mutex_destroy(&pipeline.mutex);
+    pthread_cond_destroy(&pipeline.cond);
+
+    delete [] pipeline.jobs;
+}
+
+void Reference::PackSeq(RefHeader& header, const int8_t* seq, uint64_t len, FILE* fpRefOutput)
+{
+    Array<uint8_t> packed;
+    Array<NRun> nRuns;
+
+    PackBases(packed, nRuns, seq, len);
+    WritePacked(header, packed, nRuns, fpRefOutput);
+}
+
+void Reference::Unpack(int8_t* dst, const uint8_t* packed, const NRun* nRuns, unsigned int numRuns, uint64_t begin, unsigned int len)
+{
+    uint64_t end = begin + len;
+    uint64_t i = begin;
+
+    for (; i != end && (i & 3) != 0; ++i)
+        *dst++ = (packed[i >> 2] >> ((i & 3) << 1)) & 3;
+
+    for (; i + 4 <= end; i += 4, dst += 4)
+        memcpy(dst, unpackTable.bases[packed[i >> 2]], 4);
+
+    for (; i != end; ++i)
+        *dst++ = (packed[i >> 2] >> ((i & 3) << 1)) & 3;
+
+    // put back the Ns overlapping the unpacked bases
+    dst -= len;
+    for (const NRun* pRun = lower_bound(nRuns, nRuns + numRuns, begin, CompareRunEnd); pRun != nRuns + numRuns && pRun->start < end; ++pRun)
+    {
+        uint64_t runBegin = (pRun->start > begin ? pRun->start : begin);
+        uint64_t runEnd = (uint64_t) pRun->start + pRun->len;
+        if (runEnd > end)
+            runEnd = end;
+
+        memset(dst + (runBegin - begin), 4, runEnd - runBegin);
+    }
+}
+
 void Reference::InitRefHeader(RefHeader& header)
 {
     header.names.Init(20);
     header.endPos.Init(20);
     header.md5.Init(20 * MD5_STR_LEN + 1);
+
+    header.packedPos.Init(20);
+    header.runBegins.Init(20);
+    header.nRuns.Init(20);
 }
 
 void Reference::SetName(RefHeader& header, const char* buff, int len)
@@ -165,21 +606,8 @@ void Reference::SetName(RefHeader& header, const char* buff, int len)
 
 void Reference::SetMd5(RefHeader& header, char* sequence, uint32_t seqLen)
 {
-    unsigned char MD5[MD5_CHECKSUM_LEN];
-    memset(MD5, 0, MD5_CHECKSUM_LEN);
-
-    MD5_CTX context;
-    MD5Init(&context);
-    MD5Update(&context, (unsigned char*) sequence, seqLen);
-    MD5Final(MD5, &context);
-
     unsigned int md5Len = header.md5.Size();
-    char* md5String = header.md5.GetPointer(md5Len);
-    for (unsigned int i = 0; i != MD5_CHECKSUM_LEN; ++i)
-    {
-        sprintf(md5String, "%02X", MD5[i]);
-        md5String += 2;
-    }
+    SetMd5String(header.md5.GetPointer(md5Len), sequence, seqLen);
 
     header.md5.SetSize(md5Len + MD5_STR_LEN);
 }
@@ -238,31 +666,79 @@ void Reference::WriteHeader(FILE* fpRefOutput)
     if (writeSize != numRef * MD5_STR_LEN)
         TGM_ErrQuit("ERROR: Cannot write the MD5 of special reference into the file.\n");
 
-    fseeko(fpRefOutput, 0, SEEK_SET);
+    if (formatVersion == REF_FORMAT_PACKED)
+    {
+        WritePackedHeader(spRefHeader, fpRefOutput);
+        WritePackedHeader(refHeader, fpRefOutput);
+    }
+
+    // the header position comes right before the sequences
+    fseeko(fpRefOutput, dataBegin - sizeof(int64_t), SEEK_SET);
 
     writeSize = fwrite(&filePos, sizeof(int64_t), 1, fpRefOutput);
     if (writeSize != 1)
         TGM_ErrQuit("ERROR: Cannot write position of reference header into the file.\n");
 }
 
-void Reference::Read(FILE* fpRefInput, const int32_t& refID, const int32_t& start, const int32_t& end)
+void Reference::WritePackedHeader(const RefHeader& header, FILE* fpRefOutput)
+{
+    uint32_t numSeq = header.packedPos.Size();
+    unsigned int writeSize = fwrite(&numSeq, sizeof(uint32_t), 1, fpRefOutput);
+    if (writeSize != 1)
+        TGM_ErrQuit("ERROR: Cannot write the number of packed sequences into the file.\n");
+
+    writeSize = fwrite(header.packedPos.GetPointer(0), sizeof(int64_t), numSeq, fpRefOutput);
+    if (writeSize != numSeq)
+        TGM_ErrQuit("ERROR: Cannot write the position of packed sequences into the file.\n");
+
+    writeSize = fwrite(header.runBegins.GetPointer(0), sizeof(uint32_t), numSeq, fpRefOutput);
+    if (writeSize != numSeq)
+        TGM_ErrQuit("ERROR: Cannot write the N run index into the file.\n");
+
+    uint32_t numRuns = header.nRuns.Size();
+    writeSize = fwrite(&numRuns, sizeof(uint32_t), 1, fpRefOutput);
+    if (writeSize != 1)
+        TGM_ErrQuit("ERROR: Cannot write the number of N runs into the file.\n");
+
+    writeSize = fwrite(header.nRuns.GetPointer(0), sizeof(NRun), numRuns, fpRefOutput);
+    if (writeSize != numRuns)
+        TGM_ErrQuit("ERROR: Cannot write the N runs into the file.\n");
+}
+
+void Reference::Read(FILE* fpRefInput)
 {
     int64_t headerPos = 0;
     unsigned int readSize = fread(&headerPos, sizeof(int64_t), 1, fpRefInput);
     if (readSize != 1)
         TGM_ErrQuit("ERROR: Cannot read the header position.\n");
 
+    formatVersion = 1;
+    dataBegin = sizeof(int64_t);
+
+    // a packed file starts with its negative version number
+    if (headerPos < 0)
+    {
+        formatVersion = -headerPos;
+        if (formatVersion != REF_FORMAT_PACKED)
+            TGM_ErrQuit("ERROR: Unsupported reference file version: %d.\n", formatVersion);
+
+        readSize = fread(&headerPos, sizeof(int64_t), 1, fpRefInput);
+        if (readSize != 1)
+            TGM_ErrQuit("ERROR: Cannot read the header position.\n");
+
+        dataBegin += sizeof(int64_t);
+    }
+
     fseeko(fpRefInput, headerPos, SEEK_SET);
 
     ReadRefHeader(fpRefInput);
 
-    fseeko(fpRefInput, sizeof(int64_t), SEEK_SET);
+    MapFile(fpRefInput);
+
+    fseeko(fpRefInput, dataBegin, SEEK_SET);
 
     if (spRefHeader.names.Size() > 0)
         ReadSpecialRef(fpRefInput);
-
-    if (refID != -1)
-      ReadRef(fpRefInput, refID, start, end);
 }
 
 void Reference::ReadRefHeader(FILE* fpRefInput)
@@ -343,55 +819,136 @@ void Reference::ReadRefHeader(FILE* fpRefInput)
     readSize = fread(refHeader.md5.GetPointer(0), sizeof(char), numRef * MD5_STR_LEN, fpRefInput);
     if (readSize != numRef * MD5_STR_LEN)
         TGM_ErrQuit("ERROR: Cannot read the MD5 of special reference from the file.\n");
+
+    if (formatVersion == REF_FORMAT_PACKED)
+    {
+        ReadPackedHeader(spRefHeader, fpRefInput);
+        ReadPackedHeader(refHeader, fpRefInput);
+    }
 }
 
-void Reference::ReadSpecialRef(FILE* fpRefInput)
+void Reference::ReadPackedHeader(RefHeader& header, FILE* fpRefInput)
 {
-    int64_t spRefLen = spRefHeader.endPos.Last() + 1;
+    uint32_t numSeq = 0;
+    unsigned int readSize = fread(&numSeq, sizeof(uint32_t), 1, fpRefInput);
+    if (readSize != 1)
+        TGM_ErrQuit("ERROR: Cannot read the number of packed sequences from the file.\n");
 
-    spRefSeq.Init(spRefLen);
-    spRefSeq.SetSize(spRefLen);
+    header.packedPos.Init(numSeq);
+    header.packedPos.SetSize(numSeq);
 
-    unsigned int readSize = fread(spRefSeq.GetPointer(0), sizeof(int8_t), spRefLen, fpRefInput);
-    if (readSize != spRefLen)
-        TGM_ErrQuit("ERROR: Cannot read the special reference from the file.\n");
+    readSize = fread(header.packedPos.GetPointer(0), sizeof(int64_t), numSeq, fpRefInput);
+    if (readSize != numSeq)
+        TGM_ErrQuit("ERROR: Cannot read the position of packed sequences from the file.\n");
 
-    CreatFamily();
-}
+    header.runBegins.Init(numSeq + 1);
+    header.runBegins.SetSize(numSeq + 1);
 
-void Reference::ReadRef(FILE* fpRefInput, const int32_t& refID, int32_t start, int32_t end)
-{
-    int64_t refBegin = GetRefBeginPos(refID);
-    int64_t refEnd = refHeader.endPos[refID];
-    int64_t refLen = refEnd - refBegin + 1;
+    readSize = fread(header.runBegins.GetPointer(0), sizeof(uint32_t), numSeq, fpRefInput);
+    if (readSize != numSeq)
+        TGM_ErrQuit("ERROR: Cannot read the N run index from the file.\n");
 
-    if (start < 0)
-        start = 0;
+    uint32_t numRuns = 0;
+    readSize = fread(&numRuns, sizeof(uint32_t), 1, fpRefInput);
+    if (readSize != 1)
+        TGM_ErrQuit("ERROR: Cannot read the number of N runs from the file.\n");
 
-    if (end < 0)
-        end = refLen - 1;
+    header.runBegins[numSeq] = numRuns;
 
-    if (start >= refLen || end >= refLen)
-        TGM_ErrQuit("ERROR: Invalid reference region.\n");
+    header.nRuns.Init(numRuns);
+    header.nRuns.SetSize(numRuns);
 
-    int64_t regionBegin = start + refBegin;
-    int64_t regionEnd = end + refBegin;
+    readSize = fread(header.nRuns.GetPointer(0), sizeof(NRun), numRuns, fpRefInput);
+    if (readSize != numRuns)
+        TGM_ErrQuit("ERROR: Cannot read the N runs from the file.\n");
+}
 
-    uint64_t regionLen = regionEnd - regionBegin + 1;
+const uint8_t* Reference::LoadPacked(Array<uint8_t>& buffer, FILE* fpRefInput, int64_t filePos, uint64_t numBytes) const
+{
+    if (pMap != NULL)
+    {
+        if ((size_t) (filePos + numBytes) > mapLen)
+            TGM_ErrQuit("ERROR: Cannot read the reference from the file.\n");
+
+        return (const uint8_t*) pMap + filePos;
+    }
 
-    refSeq.Init(regionLen);
-    refSeq.SetSize(regionLen);
+    buffer.Init(numBytes);
+    buffer.SetSize(numBytes);
 
-    int ret = fseeko(fpRefInput, regionBegin, SEEK_CUR);
+    int ret = fseeko(fpRefInput, filePos, SEEK_SET);
     if (ret < 0)
         TGM_ErrQuit("ERROR: Cannot jump int the reference file.\n");
 
-    unsigned int readSize = fread(refSeq.GetPointer(0), sizeof(int8_t), regionLen, fpRefInput);
-    if (readSize != regionLen)
+    uint64_t readSize = fread(buffer.GetPointer(0), sizeof(uint8_t), numBytes, fpRefInput);
+    if (readSize != numBytes)
         TGM_ErrQuit("ERROR: Cannot read the reference from the file.\n");
 
-    this->refID = refID;
-    pos = start;
+    return buffer.GetPointer(0);
+}
+
+void Reference::ReadSpecialRef(FILE* fpRefInput)
+{
+    int64_t spRefLen = spRefHeader.endPos.Last() + 1;
+    int64_t spRefBegin = dataBegin;
+
+    if (formatVersion == REF_FORMAT_PACKED)
+    {
+        if (spRefHeader.packedPos.Size() != 1)
+            TGM_ErrQuit("ERROR: Cannot find the packed special references in the file.\n");
+
+        Array<uint8_t> packedBuffer;
+        const uint8_t* packed = LoadPacked(packedBuffer, fpRefInput, spRefHeader.packedPos[0], (spRefLen + 3) / 4);
+        const NRun* nRuns = spRefHeader.nRuns.GetPointer(0);
+        unsigned int numRuns = spRefHeader.runBegins[1];
+
+        spRefBuffer.Init(spRefLen);
+        spRefBuffer.SetSize(spRefLen);
+        Unpack(spRefBuffer.GetPointer(0), packed, nRuns, numRuns, 0, spRefLen);
+
+        spRefSeq.Set(spRefBuffer.GetPointer(0), spRefLen);
+    }
+    else if (pMap != NULL)
+    {
+        if ((size_t) (spRefBegin + spRefLen) > mapLen)
+            TGM_ErrQuit("ERROR: Cannot read the special reference from the file.\n");
+
+        spRefSeq.Set((const int8_t*) pMap + spRefBegin, spRefLen);
+    }
+    else
+    {
+        spRefBuffer.Init(spRefLen);
+        spRefBuffer.SetSize(spRefLen);
+
+        unsigned int readSize = fread(spRefBuffer.GetPointer(0), sizeof(int8_t), spRefLen, fpRefInput);
+        if (readSize != spRefLen)
+            TGM_ErrQuit("ERROR: Cannot read the special reference from the file.\n");
+
+        spRefSeq.Set(spRefBuffer.GetPointer(0), spRefLen);
+    }
+
+    CreatFamily();
+    CreateSpKmers();
+}
+
+void Reference::MapFile(FILE* fpRefInput)
+{
+    if (pMap != NULL)
+        return;
+
+    // the sequences are read from the file instead if it cannot be mapped (a pipe, for example)
+    int fd = fileno(fpRefInput);
+
+    struct stat fileStat;
+    if (fd < 0 || fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0)
+        return;
+
+    void* pFile = mmap(NULL, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (pFile == MAP_FAILED)
+        return;
+
+    pMap = pFile;
+    mapLen = fileStat.st_size;
 }
 
 void Reference::CreatFamily(void)
@@ -447,6 +1004,95 @@ void Reference::CreatFamily(void)
     }
 }
 
+void Reference::CreateSpKmers(void)
+{
+    const uint32_t kmerMask = (1 << (2 * SP_KMER_LEN)) - 1;
+    unsigned int spRefNum = spRefHeader.endPos.Size();
+
+    spKmers.Init(spRefSeq.Size());
+
+    for (unsigned int i = 0; i != spRefNum; ++i)
+    {
+        int64_t begin = GetSpRefBeginPos(i);
+        int64_t end = spRefHeader.endPos[i];
+
+        uint32_t kmer = 0;
+        unsigned int validLen = 0;
+        for (int64_t j = begin; j <= end; ++j)
+        {
+            // the ambiguous bases break the seeds
+            if (spRefSeq[j] < 0 || spRefSeq[j] > 3)
+            {
+                validLen = 0;
+                continue;
+            }
+
+            kmer = ((kmer << 2) | spRefSeq[j]) & kmerMask;
+            if (++validLen < SP_KMER_LEN)
+                continue;
+
+            SpKmer& spKmer = spKmers.End();
+            spKmer.kmer = kmer;
+            spKmer.spRefID = i;
+            spKmers.Increment();
+        }
+    }
+
+    // sort the seeds and remove the duplicated ones from the same special reference
+    SpKmer* pBegin = spKmers.GetPointer(0);
+    SpKmer* pEnd = pBegin + spKmers.Size();
+
+    sort(pBegin, pEnd, CompareSpKmer);
+
+    unsigned int size = 0;
+    for (SpKmer* pKmer = pBegin; pKmer != pEnd; ++pKmer)
+    {
+        if (size == 0 || pKmer->kmer != pBegin[size - 1].kmer || pKmer->spRefID != pBegin[size - 1].spRefID)
+            pBegin[size++] = *pKmer;
+    }
+
+    spKmers.SetSize(size);
+}
+
+unsigned int Reference::SearchSpKmers(vector<uint8_t>& isHit, const int8_t* seq, unsigned int len) const
+{
+    const uint32_t kmerMask = (1 << (2 * SP_KMER_LEN)) - 1;
+
+    isHit.assign(spRefHeader.endPos.Size(), 0);
+    if (spKmers.Size() == 0)
+        return 0;
+
+    const SpKmer* pBegin = spKmers.GetPointer(0);
+    const SpKmer* pEnd = pBegin + spKmers.Size();
+
+    unsigned int hitNum = 0;
+    uint32_t kmer = 0;
+    unsigned int validLen = 0;
+    for (unsigned int i = 0; i != len; ++i)
+    {
+        if (seq[i] < 0 || seq[i] > 3)
+        {
+            validLen = 0;
+            continue;
+        }
+
+        kmer = ((kmer << 2) | seq[i]) & kmerMask;
+        if (++validLen < SP_KMER_LEN)
+            continue;
+
+        for (const SpKmer* pKmer = lower_bound(pBegin, pEnd, kmer, CompareSpKmerKey); pKmer != pEnd && pKmer->kmer == kmer; ++pKmer)
+        {
+            if (isHit[pKmer->spRefID] == 0)
+            {
+                isHit[pKmer->spRefID] = 1;
+                ++hitNum;
+            }
+        }
+    }
+
+    return hitNum;
+}
+
 const char* Reference::GetSpRefName(int& spRefID, const int32_t& spRefPos) const
 {
     if (spRefHeader.endPos.Size() <= 0) return NULL;
@@ -503,3 +1149,89 @@ void Reference::CreateFamilyToZA(const Array<char*>& spZANames)
         }
     }
 }
+
+ChromView::ChromView()
+{
+    refID = 0;
+    pos = 0;
+    packedRef = NULL;
+    pRefRuns = NULL;
+    numRefRuns = 0;
+    refLen = 0;
+}
+
+ChromView::~ChromView()
+{
+
+}
+
+void ChromView::Read(const Reference& reference, FILE* fpRefInput, int32_t refID)
+{
+    const RefHeader& refHeader = reference.refHeader;
+    const RefHeader& spRefHeader = reference.spRefHeader;
+
+    if (refID < 0 || (unsigned int) refID >= refHeader.endPos.Size())
+        TGM_ErrQuit("ERROR: Invalid reference ID: %d.\n", refID);
+
+    int64_t refBegin = reference.GetRefBeginPos(refID);
+    int64_t refEnd = refHeader.endPos[refID];
+    uint64_t regionLen = refEnd - refBegin + 1;
+
+    // the chromosomes are stored right after the special references
+    int64_t fileBegin = reference.dataBegin + refBegin;
+    if (spRefHeader.endPos.Size() > 0)
+        fileBegin += spRefHeader.endPos.Last() + 1;
+
+    packedRef = NULL;
+
+    if (reference.formatVersion == REF_FORMAT_PACKED)
+    {
+        // the whole chromosome is kept packed and unpacked on demand
+        if ((unsigned int) refID >= refHeader.packedPos.Size())
+            TGM_ErrQuit("ERROR: Cannot find the packed reference in the file.\n");
+
+        packedRef = reference.LoadPacked(packedBuffer, fpRefInput, refHeader.packedPos[refID], (regionLen + 3) / 4);
+        pRefRuns = refHeader.nRuns.GetPointer(refHeader.runBegins[refID]);
+        numRefRuns = refHeader.runBegins[refID + 1] - refHeader.runBegins[refID];
+    }
+    else if (reference.pMap != NULL)
+    {
+        if ((size_t) (fileBegin + regionLen) > reference.mapLen)
+            TGM_ErrQuit("ERROR: Cannot read the reference from the file.\n");
+
+        refSeq.Set((const int8_t*) reference.pMap + fileBegin, regionLen);
+    }
+    else
+    {
+        refBuffer.Init(regionLen);
+        refBuffer.SetSize(regionLen);
+
+        int ret = fseeko(fpRefInput, fileBegin, SEEK_SET);
+        if (ret < 0)
+            TGM_ErrQuit("ERROR: Cannot jump int the reference file.\n");
+
+        unsigned int readSize = fread(refBuffer.GetPointer(0), sizeof(int8_t), regionLen, fpRefInput);
+        if (readSize != regionLen)
+            TGM_ErrQuit("ERROR: Cannot read the reference from the file.\n");
+
+        refSeq.Set(refBuffer.GetPointer(0), regionLen);
+    }
+
+    this->refID = refID;
+    refLen = regionLen;
+    pos = 0;
+}
+
+const int8_t* ChromView::GetRefSeq(Array<int8_t>& buffer, int32_t start, unsigned int len) const
+{
+    if (packedRef == NULL)
+        return refSeq.GetPointer(start - pos);
+
+    if (buffer.Capacity() < len)
+        buffer.Resize(len);
+
+    Reference::Unpack(buffer.GetPointer(0), packedRef, pRefRuns, numRefRuns, start, len);
+    buffer.SetSize(len);
+
+    return buffer.GetPointer(0);
+}
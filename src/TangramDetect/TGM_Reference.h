@@ -32,8 +32,22 @@
 // the default length of padding between two special references
 #define DEFAULT_PADDING_LEN 300
 
+// length of the k-mer seeds in the special reference index
+#define SP_KMER_LEN 11
+
+// version of the reference file with 2-bit packed bases
+#define REF_FORMAT_PACKED 2
+
 namespace Tangram
 {
+    // a run of ambiguous bases in a packed sequence
+    struct NRun
+    {
+        uint32_t start;
+
+        uint32_t len;
+    };
+
     struct RefHeader
     {
         Array<char*> names;
@@ -41,8 +55,78 @@ namespace Tangram
         Array<int64_t> endPos;
 
         Array<char> md5;
+
+        // packed format only. the special references are packed together
+        // with the padding between them as a single sequence.
+
+        // file offset of the packed bases of each sequence
+        Array<int64_t> packedPos;
+
+        // index of the first N run of each sequence, plus the total number of runs
+        Array<uint32_t> runBegins;
+
+        // N runs of all the sequences, relative to the beginning of their sequence
+        Array<NRun> nRuns;
+    };
+
+    // a k-mer seed and the special reference it comes from
+    struct SpKmer
+    {
+        uint32_t kmer;
+
+        uint32_t spRefID;
+    };
+
+    // read-only view of a sequence in the reference file
+    class SeqView
+    {
+        public:
+            SeqView() : data(NULL), size(0) {}
+
+            inline void Set(const int8_t* data, unsigned int size)
+            {
+                this->data = data;
+                this->size = size;
+            }
+
+            inline const int8_t* GetPointer(unsigned int i) const
+            {
+                return data + i;
+            }
+
+            inline const int8_t& operator[](unsigned int i) const
+            {
+                return data[i];
+            }
+
+            inline unsigned int Size(void) const
+            {
+                return size;
+            }
+
+        private:
+
+            const int8_t* data;
+
+            unsigned int size;
     };
 
+    // The reference file written by tangram_index is mapped into memory when it
+    // is read by tangram_detect. The chromosome and the special references are
+    // then views into the mapping: nothing is copied, the pages are loaded on
+    // demand and shared by all the processes reading the same file. If the file
+    // cannot be mapped the sequences are read into private buffers instead.
+    //
+    // A Reference holds the header and the special references, it is read once
+    // and shared read-only by all the threads. The chromosome a thread works on
+    // is loaded into a ChromView of its own.
+    //
+    // Two file formats are supported. The original one stores one byte per
+    // base. The packed one (REF_FORMAT_PACKED) stores 2 bits per base and a
+    // table of the N runs in the header; it starts with the negative version
+    // number so it cannot be taken for the header position of the original
+    // format. The small special references of a packed file are unpacked when
+    // they are read, the chromosome is unpacked on demand with GetRefSeq().
     class Reference
     {
         public:
@@ -50,9 +134,10 @@ namespace Tangram
             Reference();
             ~Reference();
 
-            void Create(gzFile fpRefFastaInput, gzFile fpSpRefFastaInput, FILE* fpRefOutput);
+            void Create(gzFile fpRefFastaInput, gzFile fpSpRefFastaInput, FILE* fpRefOutput, bool isPacked, int numThread);
 
-            void Read(FILE* fpRefInput, const int32_t& refID, const int32_t& start, const int32_t& end);
+            // read the header and the special references
+            void Read(FILE* fpRefInput);
 
             inline int32_t GetSpRefBeginPos(int32_t specialRefID) const
             {
@@ -85,10 +170,23 @@ namespace Tangram
 
             void CreateFamilyToZA(const Array<char*>& spZANames);
 
+            // mark the special references that share at least one k-mer with the sequence.
+            // return the number of marked special references
+            unsigned int SearchSpKmers(std::vector<uint8_t>& isHit, const int8_t* seq, unsigned int len) const;
+
         private:
 
             void CreateRef(RefHeader& header, gzFile fpRefFastaInput, FILE* fpRefOutput, bool hasPadding);
 
+            // read, encode and write the contigs on different threads, no padding between them
+            void CreateRefThreads(RefHeader& header, gzFile fpRefFastaInput, FILE* fpRefOutput, int numThread);
+
+            // write a sequence with 2 bits per base and record its N runs in the header
+            void PackSeq(RefHeader& header, const int8_t* seq, uint64_t len, FILE* fpRefOutput);
+
+            // unpack the bases in [begin, begin + len) of a packed sequence
+            static void Unpack(int8_t* dst, const uint8_t* packed, const NRun* nRuns, unsigned int numRuns, uint64_t begin, unsigned int len);
+
             void InitRefHeader(RefHeader& header);
 
             void SetName(RefHeader& header, const char* buff, int len);
@@ -97,23 +195,28 @@ namespace Tangram
 
             void WriteHeader(FILE* fpRefOutput);
 
+            void WritePackedHeader(const RefHeader& header, FILE* fpRefOutput);
+
+            void ReadPackedHeader(RefHeader& header, FILE* fpRefInput);
+
+            // packed bytes of a sequence from the mapping, or read into the buffer
+            const uint8_t* LoadPacked(Array<uint8_t>& buffer, FILE* fpRefInput, int64_t filePos, uint64_t numBytes) const;
+
             void ReadRefHeader(FILE* fpRefInput);
 
             void ReadSpecialRef(FILE* fpRefInput);
 
-            void ReadRef(FILE* fpRefInput, const int32_t& refID, int32_t start, int32_t end);
+            void MapFile(FILE* fpRefInput);
 
             void CreatFamily(void);
 
-        public:
+            void CreateSpKmers(void);
 
-            Array<int8_t> refSeq;
+            friend class ChromView;
 
-            Array<int8_t> spRefSeq;
-
-            uint16_t refID;
+        public:
 
-            int32_t pos;
+            SeqView spRefSeq;
 
             RefHeader refHeader;
 
@@ -126,6 +229,81 @@ namespace Tangram
             Array<int> ZAToFamily;
 
             std::vector<std::string> familyName;
+
+            // sorted k-mer seeds of the special references
+            Array<SpKmer> spKmers;
+
+        private:
+
+            // format version and the file offset of the sequences
+            int formatVersion;
+
+            int64_t dataBegin;
+
+            // the mapped reference file
+            void* pMap;
+
+            size_t mapLen;
+
+            // copy of the special references if the file is not mapped or is packed
+            Array<int8_t> spRefBuffer;
+    };
+
+    // one chromosome of a reference, loaded by a thread for the task it works on
+    class ChromView
+    {
+        public:
+
+            ChromView();
+            ~ChromView();
+
+            // read the whole sequence of a chromosome, the reference header and the special references must have been read
+            void Read(const Reference& reference, FILE* fpRefInput, int32_t refID);
+
+            // length of the loaded chromosome region
+            inline uint32_t GetRefLen(void) const
+            {
+                return refLen;
+            }
+
+            // bases of the loaded chromosome in [start, start + len), in chromosome positions.
+            // the original format returns a pointer into the file, the packed one unpacks into the buffer
+            const int8_t* GetRefSeq(Array<int8_t>& buffer, int32_t start, unsigned int len) const;
+
+            inline int8_t GetRefBase(int32_t refPos) const
+            {
+                if (packedRef == NULL)
+                    return refSeq[refPos - pos];
+
+                int8_t base = 0;
+                Reference::Unpack(&base, packedRef, pRefRuns, numRefRuns, refPos, 1);
+                return base;
+            }
+
+        public:
+
+            uint16_t refID;
+
+            int32_t pos;
+
+        private:
+
+            // the loaded chromosome region of an original format file
+            SeqView refSeq;
+
+            // the loaded chromosome of a packed file
+            const uint8_t* packedRef;
+
+            const NRun* pRefRuns;
+
+            unsigned int numRefRuns;
+
+            uint32_t refLen;
+
+            // copies of the sequence if the file is not mapped
+            Array<int8_t> refBuffer;
+
+            Array<uint8_t> packedBuffer;
     };
 };
 
@@ -0,0 +1,345 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_Scheduler.cpp
+ *
+ *    Description:  Call the SV events of the whole genome chromosome by chromosome
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 03:41:10 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#include "TGM_Error.h"
+#include "TGM_BamPair.h"
+#include "TGM_Detector.h"
+#include "TGM_Reference.h"
+#include "TGM_Aligner.h"
+#include "TGM_Genotype.h"
+#include "TGM_Printer.h"
+#include "TGM_Scheduler.h"
+
+using namespace std;
+using namespace BamTools;
+using namespace Tangram;
+
+// extra room around a window for the reference region searched by the split reads
+static const int32_t SPLIT_READ_MARGIN = 1000;
+
+static bool CompareTaskLen(const ChromTask& a, const ChromTask& b)
+{
+    if (a.refLen != b.refLen)
+        return a.refLen > b.refLen;
+
+    return a.refID < b.refID;
+}
+
+static bool CompareTaskRefID(const ChromTask* a, const ChromTask* b)
+{
+    return a->refID < b->refID;
+}
+
+Scheduler::Scheduler(const vector<string>& filenames, const DetectPars& detectPars, const AlignerPars& alignerPars,
+                     const GenotypePars& genotypePars, const LibTable& libTable, const FragLenTable& fragLenTable)
+                    : filenames(filenames), detectPars(detectPars), alignerPars(alignerPars), genotypePars(genotypePars),
+                      libTable(libTable), fragLenTable(fragLenTable)
+{
+    currIdx = 0;
+
+    if (pthread_mutex_init(&taskMutex, NULL) != 0 || pthread_mutex_init(&refMutex, NULL) != 0)
+        TGM_ErrQuit("ERROR: Cannot initialize the mutex.\n");
+}
+
+Scheduler::~Scheduler()
+{
+    for (unsigned int i = 0; i != tasks.size(); ++i)
+        free(tasks[i].output);
+
+    pthread_mutex_destroy(&taskMutex);
+    pthread_mutex_destroy(&refMutex);
+}
+
+void Scheduler::Init(const RefVector& refVector)
+{
+    tasks.resize(refVector.size());
+    for (unsigned int i = 0; i != refVector.size(); ++i)
+    {
+        tasks[i].refID = i;
+        tasks[i].refLen = refVector[i].RefLength;
+        tasks[i].start = 0;
+        tasks[i].end = refVector[i].RefLength;
+        tasks[i].output = NULL;
+        tasks[i].outputLen = 0;
+    }
+
+    // start with the longest chromosomes so that the short ones fill the gaps at the end
+    sort(tasks.begin(), tasks.end(), CompareTaskLen);
+    currIdx = 0;
+}
+
+void Scheduler::Init(const RefVector& refVector, int32_t refID, int32_t start, int32_t end)
+{
+    int32_t refLen = refVector[refID].RefLength;
+
+    if (start < 0)
+        start = 0;
+
+    if (end < 0 || end > refLen)
+        end = refLen;
+
+    tasks.resize(1);
+    tasks[0].refID = refID;
+    tasks[0].refLen = refLen;
+    tasks[0].start = start;
+    tasks[0].end = end;
+    tasks[0].output = NULL;
+    tasks[0].outputLen = 0;
+
+    currIdx = 0;
+}
+
+void Scheduler::Run(void)
+{
+    // the reference header and the special references are read once and shared by all the threads
+    if (alignerPars.fpRefInput != NULL)
+    {
+        reference.Read(alignerPars.fpRefInput);
+        reference.CreateFamilyToZA(*(libTable.GetSpecialRefNames()));
+    }
+
+    // make the thread joinable
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
+
+    SchedulerData* schedulerData = (SchedulerData*) malloc(detectPars.numThread * sizeof(SchedulerData));
+    if (schedulerData == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the scheduler data.\n");
+
+    for (int i = 0; i != detectPars.numThread; ++i)
+    {
+        schedulerData[i].pScheduler = this;
+
+        int ret = pthread_create(&(schedulerData[i].thread), &attr, &Scheduler::StartThread, (void*) &(schedulerData[i]));
+        if (ret != 0)
+            TGM_ErrQuit("ERROR: Unable to create threads.\n");
+    }
+
+    pthread_attr_destroy(&attr);
+    for (int i = 0; i != detectPars.numThread; ++i)
+    {
+        void* status;
+        int ret = pthread_join(schedulerData[i].thread, &status);
+        if (ret != 0)
+            TGM_ErrQuit("ERROR: Unable to join threads.\n");
+    }
+
+    free(schedulerData);
+}
+
+void Scheduler::Print(void) const
+{
+    FILE* fpOutput = stdout;
+    if (detectPars.outputPrefix != NULL)
+    {
+        string outputFile(detectPars.outputPrefix);
+        outputFile += ".mei.vcf";
+        fpOutput = fopen(outputFile.c_str(), "w");
+        if (fpOutput == NULL)
+            TGM_ErrQuit("Error: Cannot open the MEI VCF file: %s\n", outputFile.c_str());
+    }
+
+    vector<const ChromTask*> sortedTasks(tasks.size());
+    for (unsigned int i = 0; i != tasks.size(); ++i)
+        sortedTasks[i] = &(tasks[i]);
+
+    sort(sortedTasks.begin(), sortedTasks.end(), CompareTaskRefID);
+
+    // every fragment starts with the same header, only the first one is kept
+    bool hasHeader = false;
+    for (unsigned int i = 0; i != sortedTasks.size(); ++i)
+    {
+        const char* line = sortedTasks[i]->output;
+        const char* outputEnd = line + sortedTasks[i]->outputLen;
+
+        if (line == NULL)
+            continue;
+
+        while (line < outputEnd)
+        {
+            const char* lineEnd = (const char*) memchr(line, '\n', outputEnd - line);
+            lineEnd = (lineEnd == NULL ? outputEnd : lineEnd + 1);
+
+            if (!hasHeader || *line != '#')
+                fwrite(line, sizeof(char), lineEnd - line, fpOutput);
+
+            line = lineEnd;
+        }
+
+        if (sortedTasks[i]->outputLen > 0)
+            hasHeader = true;
+    }
+
+    if (fpOutput != stdout)
+        fclose(fpOutput);
+    else
+        fflush(fpOutput);
+}
+
+void* Scheduler::StartThread(void* threadData)
+{
+    SchedulerData* pData = (SchedulerData*) threadData;
+    Scheduler& scheduler = *(pData->pScheduler);
+
+    BamMultiReader bamMultiReader;
+    if (!bamMultiReader.Open(scheduler.filenames) || !bamMultiReader.LocateIndexes())
+        TGM_ErrQuit("ERROR: Cannot open the input bam files or their index files.\n");
+
+    // the split-read mapping of a task runs on the thread of the task
+    AlignerPars taskPars = scheduler.alignerPars;
+    taskPars.fpRefInput = NULL;
+    taskPars.numThread = 1;
+
+    // the chromosome of the current task
+    ChromView chrom;
+
+    unsigned int taskIdx = 0;
+    while (scheduler.GetNextTask(taskIdx))
+        scheduler.CallTask(scheduler.tasks[taskIdx], bamMultiReader, chrom, taskPars);
+
+    bamMultiReader.Close();
+
+    pthread_exit(NULL);
+}
+
+bool Scheduler::GetNextTask(unsigned int& taskIdx)
+{
+    int status = pthread_mutex_lock(&taskMutex);
+    if (status != 0)
+        TGM_ErrQuit("ERROR: Cannot lock the mutex.\n");
+
+    taskIdx = currIdx;
+    if (currIdx < tasks.size())
+        ++currIdx;
+
+    status = pthread_mutex_unlock(&taskMutex);
+    if (status != 0)
+        TGM_ErrQuit("ERROR: Cannot unlock the mutex.\n");
+
+    return (taskIdx < tasks.size());
+}
+
+void Scheduler::CallTask(ChromTask& task, BamMultiReader& bamMultiReader, ChromView& chrom, const AlignerPars& taskPars)
+{
+    // the whole chromosome reference is loaded once and shared by all the windows
+    if (alignerPars.fpRefInput != NULL)
+    {
+        pthread_mutex_lock(&refMutex);
+        chrom.Read(reference, alignerPars.fpRefInput, task.refID);
+        pthread_mutex_unlock(&refMutex);
+    }
+
+    // print the events of this chromosome into a memory buffer
+    FILE* fpOutput = open_memstream(&(task.output), &(task.outputLen));
+    if (fpOutput == NULL)
+        TGM_ErrQuit("ERROR: Cannot open the output buffer of a chromosome.\n");
+
+    if (detectPars.windowSize <= 0)
+    {
+        CallWindow(task, task.start, task.end, task.start, task.end, bamMultiReader, chrom, taskPars, fpOutput);
+    }
+    else
+    {
+        // an event is supported by the pairs within two fragments of it
+        // and by the split reads whose reference regions reach it
+        int32_t overlap = 2 * libTable.GetFragLenMax() + SPLIT_READ_MARGIN;
+
+        for (int32_t start = task.start; start < task.end; start += detectPars.windowSize)
+        {
+            int32_t end = start + detectPars.windowSize;
+            if (end > task.end)
+                end = task.end;
+
+            int32_t loadStart = (start > overlap ? start - overlap : 0);
+            int32_t loadEnd = (end < task.refLen - overlap ? end + overlap : task.refLen);
+
+            CallWindow(task, start, end, loadStart, loadEnd, bamMultiReader, chrom, taskPars, fpOutput);
+        }
+    }
+
+    fclose(fpOutput);
+}
+
+void Scheduler::CallWindow(const ChromTask& task, int32_t start, int32_t end, int32_t loadStart, int32_t loadEnd,
+                           BamMultiReader& bamMultiReader, const ChromView& chrom, const AlignerPars& taskPars, FILE* fpOutput)
+{
+    if (!bamMultiReader.SetRegion(task.refID, loadStart, task.refID, loadEnd))
+        TGM_ErrQuit("ERROR: Cannot set the detection region.\n");
+
+    BamPairTable bamPairTable(detectPars, libTable, fragLenTable);
+    bamPairTable.InitCoverage(genotypePars);
+
+    // only the core fields are read here, the table decodes the rest on demand
+    BamAlignment alignment;
+    while(bamMultiReader.GetNextAlignmentCore(alignment))
+    {
+        bamPairTable.Update(alignment);
+    }
+
+    if (detectPars.showDecodeStat)
+    {
+        string name = bamMultiReader.GetReferenceData()[task.refID].RefName;
+        if (detectPars.windowSize > 0)
+        {
+            char range[64];
+            snprintf(range, sizeof(range), ":%d-%d", start + 1, end);
+            name += range;
+        }
+
+        bamPairTable.ReportDecode(stderr, name.c_str());
+    }
+
+    // call the SV events with read-pair signal
+    Detector detector(detectPars, libTable, bamPairTable);
+    detector.Init();
+    detector.CallEvents();
+
+    const Reference* pRef = NULL;
+    const ChromView* pChrom = NULL;
+    const Aligner* pAligner = NULL;
+
+    Aligner aligner(detector, bamPairTable, taskPars, reference, chrom, libTable);
+
+    // call the SV events with split-read signal
+    if (alignerPars.fpRefInput != NULL)
+    {
+        aligner.Map();
+
+        pRef = &reference;
+        pChrom = &chrom;
+        pAligner = &aligner;
+    }
+
+    Genotype genotype(bamMultiReader, genotypePars, libTable, bamPairTable);
+    genotype.Init();
+
+    Printer printer(&detector, detectPars, pAligner, pRef, pChrom, libTable, bamPairTable, genotypePars, genotype);
+    printer.SetOutput(fpOutput);
+
+    // only the events inside the window are printed, the overlaps belong to the neighbours
+    if (detectPars.windowSize > 0)
+    {
+        printer.SetRange(start, end);
+        printer.SetHeader(start == task.start);
+    }
+
+    printer.Init();
+    printer.Print();
+}
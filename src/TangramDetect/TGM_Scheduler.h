@@ -0,0 +1,133 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_Scheduler.h
+ *
+ *    Description:  Call the SV events of the whole genome chromosome by chromosome
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 03:41:10 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+#ifndef  TGM_SCHEDULER_H
+#define  TGM_SCHEDULER_H
+
+#include <pthread.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "api/BamMultiReader.h"
+
+#include "TGM_Parameters.h"
+#include "TGM_LibTable.h"
+#include "TGM_FragLenTable.h"
+#include "TGM_Reference.h"
+
+namespace Tangram
+{
+    // a chromosome to be called
+    struct ChromTask
+    {
+        int32_t refID;
+
+        int32_t refLen;
+
+        int32_t start;         // region to be called [start, end)
+
+        int32_t end;
+
+        char* output;          // VCF fragment of this chromosome
+
+        size_t outputLen;
+    };
+
+    typedef class Scheduler Scheduler;
+
+    typedef struct
+    {
+        pthread_t thread;
+
+        Scheduler* pScheduler;
+
+    }SchedulerData;
+
+    // The scheduler runs one task per chromosome on -p threads, the longest
+    // chromosomes first. Every task has its own bam pair table, detector,
+    // aligner and genotype module; the library table and the fragment length
+    // table are shared read-only, and so are the reference header and the
+    // special references, which are read once before the threads start. Each
+    // thread opens the bam files once and loads only the chromosome of the
+    // task it picks up into a view of its own. The VCF fragments of the tasks
+    // are written out in the order of the chromosomes at the end.
+    //
+    // With a window size (-win) a task is called in windows of that size
+    // instead of all at once. Each window loads the pairs of the window plus
+    // an overlap on both sides, runs the whole pipeline and prints only the
+    // events that start inside the window itself, so an event in the overlap
+    // is reported once by the window that owns it. The tables of a window are
+    // released before the next one is loaded, which bounds the memory by the
+    // window size instead of the chromosome size.
+    class Scheduler
+    {
+        public:
+            Scheduler(const std::vector<std::string>& filenames, const DetectPars& detectPars, const AlignerPars& alignerPars,
+                      const GenotypePars& genotypePars, const LibTable& libTable, const FragLenTable& fragLenTable);
+
+            ~Scheduler();
+
+            void Init(const BamTools::RefVector& refVector);
+
+            // call a single region instead of the whole genome
+            void Init(const BamTools::RefVector& refVector, int32_t refID, int32_t start, int32_t end);
+
+            void Run(void);
+
+            void Print(void) const;
+
+            static void* StartThread(void* threadData);
+
+        private:
+
+            bool GetNextTask(unsigned int& taskIdx);
+
+            void CallTask(ChromTask& task, BamTools::BamMultiReader& bamMultiReader, ChromView& chrom, const AlignerPars& taskPars);
+
+            // call the events in [start, end) with the pairs loaded from [loadStart, loadEnd)
+            void CallWindow(const ChromTask& task, int32_t start, int32_t end, int32_t loadStart, int32_t loadEnd,
+                            BamTools::BamMultiReader& bamMultiReader, const ChromView& chrom, const AlignerPars& taskPars, FILE* fpOutput);
+
+        private:
+
+            const std::vector<std::string>& filenames;
+
+            const DetectPars& detectPars;
+
+            const AlignerPars& alignerPars;
+
+            const GenotypePars& genotypePars;
+
+            const LibTable& libTable;
+
+            const FragLenTable& fragLenTable;
+
+            // the reference header and the special references, read-only once the threads start
+            Reference reference;
+
+            // tasks sorted by the chromosome length (longest first)
+            std::vector<ChromTask> tasks;
+
+            unsigned int currIdx;
+
+            pthread_mutex_t taskMutex;
+
+            // the reference file is shared by all the threads
+            pthread_mutex_t refMutex;
+    };
+};
+
+#endif  /*TGM_SCHEDULER_H*/
@@ -56,8 +56,9 @@ static void CigarToString(std::string& cigarStr, const uint32_t* cigar, unsigned
 
 #endif
 
-SecondMapThread::SecondMapThread(Array<SplitEvent>& events, const AlignerPars& alignerPars, const LibTable& libInfoTable, const BamPairTable& pairTable, const Reference& reference)
-                               : splitEvents(events), alignerPars(alignerPars), libTable(libInfoTable), bamPairTable(pairTable), ref(reference)
+SecondMapThread::SecondMapThread(Array<SplitEvent>& events, const AlignerPars& alignerPars, const LibTable& libInfoTable, const BamPairTable& pairTable,
+                                 const Reference& reference, const ChromView& chrom)
+                               : splitEvents(events), alignerPars(alignerPars), libTable(libInfoTable), bamPairTable(pairTable), ref(reference), chrom(chrom)
 {
 
 }
@@ -69,83 +70,77 @@ SecondMapThread::~SecondMapThread()
 
 void* SecondMapThread::StartThread(void* threadData)
 {
-    SecondMapData* pMapData = (SecondMapData*) threadData;
+    SecondMapTag* pTag = (SecondMapTag*) threadData;
+    SecondMapData* pMapData = pTag->pMapData;
 
     SecondMapThread& secondMap = *(pMapData->pSecondMap);
 
     Array<EventTry> eventTries;
     eventTries.Init(DEFAULT_SV_TYPE_NUM);
 
-    // a holder for the minus strand sequence
-    TGM_Sequence minusSeq = {NULL, 0, 0};
-    RescuePartial rescuePartial(secondMap.alignerPars);
-
-    vector< vector<unsigned int> > poll(secondMap.ref.familyName.size() * 2);
-
-    while (true)
-    {
-        int status = pthread_mutex_lock(&(pMapData->mutex));
-        if (status != 0)
-            TGM_ErrQuit("ERROR: Cannot lock the mutex.\n");
+    // the query profiles of both strands of the reads
+    ProfilePool profilePool(secondMap.alignerPars.secMat);
 
-        unsigned int i = pMapData->currIdx;
-        ++(pMapData->currIdx);
+    // the special references with k-mer seed hits of a read
+    vector<uint8_t> spHits;
 
-        status = pthread_mutex_unlock(&(pMapData->mutex));
-        if (status != 0)
-            TGM_ErrQuit("ERROR: Cannot unlock the mutex.\n");
+    RescuePartial rescuePartial(secondMap.alignerPars);
 
-        if (i >= pMapData->totalWorks)
-            break;
+    vector< vector<unsigned int> > poll(secondMap.ref.familyName.size() * 2);
 
-        SplitEvent& event = secondMap.splitEvents[i];
-        event.pSpecialData = NULL;
-        secondMap.SearchEventTries(eventTries, event);
-        secondMap.InitSecondPartial(event);
+    unsigned int chunkBegin = 0;
+    unsigned int chunkEnd = 0;
 
-        if (eventTries.Size() != 0)
+    while (pMapData->pTaskPool->GetChunk(chunkBegin, chunkEnd, pTag->idx))
+    {
+        for (unsigned int i = chunkBegin; i != chunkEnd; ++i)
         {
-            for (unsigned int j = 0; j != eventTries.Size(); ++j)
+            SplitEvent& event = secondMap.splitEvents[i];
+            event.pSpecialData = NULL;
+            secondMap.SearchEventTries(eventTries, event);
+            secondMap.InitSecondPartial(event);
+
+            if (eventTries.Size() != 0)
             {
-                bool isSucess = false;
-                event.svType = SV_NORMAL;
-                switch (eventTries[j].svType)
+                for (unsigned int j = 0; j != eventTries.Size(); ++j)
                 {
-                    case SV_SPECIAL:
-                        isSucess = secondMap.TrySpecial(event, minusSeq, rescuePartial);
-                        if (isSucess)
-                        {
-                            bool isGood = secondMap.ProcessSpecial(event, poll);
-                            if (isGood)
+                    bool isSucess = false;
+                    event.svType = SV_NORMAL;
+                    switch (eventTries[j].svType)
+                    {
+                        case SV_SPECIAL:
+                            isSucess = secondMap.TrySpecial(event, profilePool, spHits, rescuePartial);
+                            if (isSucess)
                             {
-                                event.svType = SV_SPECIAL;
-                                /*  
-                                printf("chr%s\t%d\t%d\t%d\t%s\t%d\t%d\t%d\t%d\n", secondMap.ref.refHeader.names[event.refID], event.pos, event.pos + event.len, event.strand,
-                                        secondMap.ref.familyName[event.pSpecialData->familyID].c_str(), event.pSpecialData->pos, event.pSpecialData->end,
-                                        event.pSpecialData->polyALen, event.pSpecialData->tsdLen);
-                                */
+                                bool isGood = secondMap.ProcessSpecial(event, poll);
+                                if (isGood)
+                                {
+                                    event.svType = SV_SPECIAL;
+                                    /*  
+                                    printf("chr%s\t%d\t%d\t%d\t%s\t%d\t%d\t%d\t%d\n", secondMap.ref.refHeader.names[event.refID], event.pos, event.pos + event.len, event.strand,
+                                            secondMap.ref.familyName[event.pSpecialData->familyID].c_str(), event.pSpecialData->pos, event.pSpecialData->end,
+                                            event.pSpecialData->polyALen, event.pSpecialData->tsdLen);
+                                    */
+                                }
                             }
-                        }
-                        break;
-                    default:
+                            break;
+                        default:
+                            break;
+                    }
+
+                    if (event.svType != SV_NORMAL)
                         break;
                 }
+            }
+            else
+            {
 
-                if (event.svType != SV_NORMAL)
-                    break;
             }
-        }
-        else
-        {
 
+            eventTries.Clear();
         }
-
-        eventTries.Clear();
     }
 
-    // clean up the memory
-    TGM_SeqClean(&minusSeq);
-
     pthread_exit(NULL);
 }
 
@@ -181,7 +176,7 @@ void SecondMapThread::SearchEventTries(Array<EventTry>& eventTries, const SplitE
     }
 }
 
-bool SecondMapThread::TrySpecial(SplitEvent& splitEvent, TGM_Sequence& minusSeq, RescuePartial& rescuePartial)
+bool SecondMapThread::TrySpecial(SplitEvent& splitEvent, ProfilePool& profilePool, vector<uint8_t>& spHits, RescuePartial& rescuePartial)
 {
     if (splitEvent.majorCount == 0)
         return false;
@@ -210,7 +205,7 @@ bool SecondMapThread::TrySpecial(SplitEvent& splitEvent, TGM_Sequence& minusSeq,
         const PrtlAlgnmnt& firstPartial = splitEvent.first3[i];
         uint8_t isReversed = false;
 
-        s_align* pSecAlignment = AlignSecPartial(isRescued, rescuePartial, doOtherFirst, isReversed, polyALen, firstPartial, refRegion, minusSeq, secondFilter);
+        s_align* pSecAlignment = AlignSecPartial(isRescued, rescuePartial, doOtherFirst, isReversed, polyALen, firstPartial, refRegion, profilePool, spHits, secondFilter);
         if (pSecAlignment == NULL)
         {
             // failure count only increase when this is a major partial alignment (unaligned part is long enough)
@@ -243,7 +238,7 @@ bool SecondMapThread::TrySpecial(SplitEvent& splitEvent, TGM_Sequence& minusSeq,
         const PrtlAlgnmnt& firstPartial = splitEvent.first5[i];
         uint8_t isReversed = false;
 
-        s_align* pSecAlignment = AlignSecPartial(isRescued, rescuePartial, doOtherFirst, isReversed, polyALen, firstPartial, refRegion, minusSeq, secondFilter);
+        s_align* pSecAlignment = AlignSecPartial(isRescued, rescuePartial, doOtherFirst, isReversed, polyALen, firstPartial, refRegion, profilePool, spHits, secondFilter);
         if (pSecAlignment == NULL)
         {
             // failure count only increase when this is a major partial alignment (unaligned part is long enough)
@@ -282,39 +277,30 @@ bool SecondMapThread::TrySpecial(SplitEvent& splitEvent, TGM_Sequence& minusSeq,
 }
 
 s_align* SecondMapThread::AlignSecPartial(bool& isRescued, RescuePartial& rescuePartial, bool& doOtherFirst, uint8_t& isReversed, uint8_t& polyALen,
-                                          const PrtlAlgnmnt& firstPartial, const RefRegion& refRegion, TGM_Sequence& minusSeq, SecondFilter secondFilter)
+                                          const PrtlAlgnmnt& firstPartial, const RefRegion& refRegion, ProfilePool& profilePool, vector<uint8_t>& spHits, SecondFilter secondFilter)
 {
     unsigned int idx = firstPartial.origIdx;
 
     isReversed = firstPartial.isReversed;
 
-    const TGM_Sequence* pRead = NULL;
+    const ReadArena* pReads = NULL;
     const int8_t* readSeq = NULL;
     unsigned int readLen = 0;
 
     if (!firstPartial.isSoft)
-        pRead = &(bamPairTable.orphanPairs[idx].read);
+        pReads = &(bamPairTable.orphanPairs.reads);
     else
-        pRead = &(bamPairTable.softPairs[idx].read);
+        pReads = &(bamPairTable.softPairs.reads);
 
-    readSeq = pRead->seq;
-    readLen = pRead->len;
+    readLen = pReads->GetLen(idx);
 
+    // 0: the read as it is stored; 1: its reverse complement
+    uint8_t strand = doOtherFirst ? 1 : 0;
     if (doOtherFirst)
-    {
         isReversed ^= 1;
-        TGM_SeqDup(&minusSeq, pRead);
-        TGM_SeqRevComp(&minusSeq);
-
-        readSeq = minusSeq.seq;
-    }
-
-    // TODO: adjust the gap open and extention penalty
-    s_profile* pProfile = ssw_init(readSeq, readLen, alignerPars.secMat, 5, 2);
-    s_align* pAlignment = ssw_align(pProfile, refRegion.pRef, refRegion.len, alignerPars.secGapOpen, alignerPars.secGapExt, 
-                                    alignerPars.flag, alignerPars.scoreFilter, alignerPars.distFilter, readLen);
 
-    init_destroy(pProfile);
+    readSeq = profilePool.GetSeq(*pReads, idx, strand);
+    s_align* pAlignment = AlignSpecial(spHits, profilePool.GetProfile(*pReads, idx, strand), readSeq, readLen, refRegion);
 
 #ifdef TD_VERBOSE_DEBUG
 
@@ -323,7 +309,7 @@ s_align* SecondMapThread::AlignSecPartial(bool& isRescued, RescuePartial& rescue
 
 #endif
 
-    bool passFilter = (this->*secondFilter)(isRescued, rescuePartial, polyALen, pAlignment, isReversed, firstPartial, refRegion, pRead->seq, pRead->len);
+    bool passFilter = (this->*secondFilter)(isRescued, rescuePartial, polyALen, pAlignment, isReversed, firstPartial, refRegion, profilePool.GetSeq(*pReads, idx, 0), readLen);
     if (passFilter)
     {
 
@@ -375,30 +361,14 @@ s_align* SecondMapThread::AlignSecPartial(bool& isRescued, RescuePartial& rescue
             isRescued = false;
         }
 
-        pProfile = NULL;
         pAlignment = NULL;
 
-        if (isReversed == firstPartial.isReversed)
-        {
-            TGM_SeqDup(&minusSeq, pRead);
-            TGM_SeqRevComp(&minusSeq);
-
-            readSeq = minusSeq.seq;
-        }
-        else
-        {
-            readSeq = pRead->seq;
-        }
-
-        // TODO: adjust the gap open and extention penalty
-        pProfile = ssw_init(readSeq, readLen, alignerPars.secMat, 5, 2);
-        pAlignment = ssw_align(pProfile, refRegion.pRef, refRegion.len, alignerPars.secGapOpen, alignerPars.secGapExt, 
-                               alignerPars.flag, alignerPars.scoreFilter, alignerPars.distFilter, readLen);
-
+        strand ^= 1;
+        readSeq = profilePool.GetSeq(*pReads, idx, strand);
+        pAlignment = AlignSpecial(spHits, profilePool.GetProfile(*pReads, idx, strand), readSeq, readLen, refRegion);
         isReversed ^= 1;
-        init_destroy(pProfile);
 
-        passFilter = (this->*secondFilter)(isRescued, rescuePartial, polyALen, pAlignment, isReversed, firstPartial, refRegion, pRead->seq, pRead->len);
+        passFilter = (this->*secondFilter)(isRescued, rescuePartial, polyALen, pAlignment, isReversed, firstPartial, refRegion, profilePool.GetSeq(*pReads, idx, 0), readLen);
         if (passFilter)
         {
             if (isReversed != firstPartial.isReversed)
@@ -422,6 +392,78 @@ s_align* SecondMapThread::AlignSecPartial(bool& isRescued, RescuePartial& rescue
     }
 }
 
+s_align* SecondMapThread::AlignSpecial(vector<uint8_t>& spHits, const s_profile* pProfile, const int8_t* readSeq, int readLen, const RefRegion& refRegion) const
+{
+    // TODO: adjust the gap open and extention penalty
+    if (!alignerPars.useSpSeeds)
+    {
+        return ssw_align(pProfile, refRegion.pRef, refRegion.len, alignerPars.secGapOpen, alignerPars.secGapExt, 
+                         alignerPars.flag, alignerPars.scoreFilter, alignerPars.distFilter, readLen);
+    }
+
+    // only the special references sharing k-mer seeds with the read are aligned
+    ref.SearchSpKmers(spHits, readSeq, readLen);
+
+    s_align* pBest = NULL;
+    for (unsigned int i = 0; i != spHits.size(); ++i)
+    {
+        if (spHits[i] == 0)
+            continue;
+
+        int32_t begin = ref.GetSpRefBeginPos(i) - DEFAULT_PADDING_LEN;
+        int32_t end = ref.spRefHeader.endPos[i] + DEFAULT_PADDING_LEN;
+
+        if (begin < 0)
+            begin = 0;
+
+        if (end >= (int32_t) refRegion.len)
+            end = refRegion.len - 1;
+
+        s_align* pAlignment = ssw_align(pProfile, refRegion.pRef + begin, end - begin + 1, alignerPars.secGapOpen, alignerPars.secGapExt, 
+                                        alignerPars.flag, alignerPars.scoreFilter, alignerPars.distFilter, readLen);
+
+        if (pAlignment == NULL)
+            continue;
+
+        // move the coordinates back to the concatenated special reference
+        if (pAlignment->ref_begin1 >= 0)
+            pAlignment->ref_begin1 += begin;
+
+        if (pAlignment->ref_end1 >= 0)
+            pAlignment->ref_end1 += begin;
+
+        if (pAlignment->ref_end2 >= 0)
+            pAlignment->ref_end2 += begin;
+
+        // the windows are visited by their positions so the first best one is kept, as an exhaustive search does
+        if (pBest == NULL || pAlignment->score1 > pBest->score1)
+        {
+            if (pBest != NULL)
+                align_destroy(pBest);
+
+            pBest = pAlignment;
+        }
+        else
+            align_destroy(pAlignment);
+    }
+
+    // no seed hit: an empty alignment is rejected by the filter
+    if (pBest == NULL)
+    {
+        pBest = (s_align*) calloc(1, sizeof(s_align));
+        if (pBest == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the special alignment.\n");
+
+        pBest->ref_begin1 = -1;
+        pBest->ref_end1 = -1;
+        pBest->read_begin1 = -1;
+        pBest->read_end1 = -1;
+        pBest->ref_end2 = -1;
+    }
+
+    return pBest;
+}
+
 bool SecondMapThread::SecondFilterSpecial(bool& isRescued, RescuePartial& rescuePartial, uint8_t& polyALen, const s_align* pAlignment, uint8_t isReversed, 
                                           const PrtlAlgnmnt& firstPartial, const RefRegion& refRegion, const int8_t* readSeq, int readLen)
 {
@@ -727,7 +769,7 @@ bool SecondMapThread::ProcessSpecial(SplitEvent& splitEvent, vector< vector<unsi
 
     splitEvent.pSpecialData->familyID = maxID / 2;
     splitEvent.strand = maxID % 2;
-    splitEvent.refID = ref.refID;
+    splitEvent.refID = chrom.refID;
     
     PrtlAlgnmnt* firstPartials = splitEvent.first3;
     PrtlAlgnmnt* secondPartials = splitEvent.second5;
@@ -31,6 +31,8 @@
 #include "TGM_Sequence.h"
 #include "TGM_SplitData.h"
 #include "TGM_RescuePartial.h"
+#include "TGM_ProfilePool.h"
+#include "TGM_TaskPool.h"
 
 namespace Tangram
 {
@@ -39,27 +41,27 @@ namespace Tangram
     typedef bool (SecondMapThread::*SecondFilter)(bool& isRescued, RescuePartial& rescuePartial, uint8_t& polyALen, const s_align* pAlignment, uint8_t isReversed, 
                                                   const PrtlAlgnmnt& firstPartial, const RefRegion& refRegion, const int8_t* readSeq, int readLen);
 
+    typedef struct SecondMapData SecondMapData;
+
     typedef struct
     {
         unsigned int idx;
 
         pthread_t thread;
 
+        SecondMapData* pMapData;
+
     }SecondMapTag;
 
-    typedef struct
+    struct SecondMapData
     {
         SecondMapTag* pTags;
 
         SecondMapThread* pSecondMap;
 
-        unsigned int currIdx;
-
-        unsigned int totalWorks;
-
-        pthread_mutex_t mutex;
-
-    }SecondMapData;
+        // the split events are handed out by the task pool
+        TaskPool* pTaskPool;
+    };
 
     typedef struct
     {
@@ -76,7 +78,7 @@ namespace Tangram
         public:
 
             SecondMapThread(Array<SplitEvent>& splitEvents, const AlignerPars& pars, const LibTable& libInfoTable, 
-                            const BamPairTable& pairTable, const Reference& reference);
+                            const BamPairTable& pairTable, const Reference& reference, const ChromView& chrom);
 
             ~SecondMapThread();
 
@@ -88,10 +90,12 @@ namespace Tangram
 
             void SearchEventTries(Array<EventTry>& eventTries, const SplitEvent& splitEvent);
 
-            bool TrySpecial(SplitEvent& splitEvent, TGM_Sequence& minusSeq, RescuePartial& rescuePartial);
+            bool TrySpecial(SplitEvent& splitEvent, ProfilePool& profilePool, std::vector<uint8_t>& spHits, RescuePartial& rescuePartial);
 
             s_align* AlignSecPartial(bool& isRescued, RescuePartial& rescuePartial, bool& doOtherFirst, uint8_t& isReversed, uint8_t& polyALen,
-                                     const PrtlAlgnmnt& firstPartial, const RefRegion& refRegion, TGM_Sequence& minusSeq, SecondFilter secondFilter);
+                                     const PrtlAlgnmnt& firstPartial, const RefRegion& refRegion, ProfilePool& profilePool, std::vector<uint8_t>& spHits, SecondFilter secondFilter);
+
+            s_align* AlignSpecial(std::vector<uint8_t>& spHits, const s_profile* pProfile, const int8_t* readSeq, int readLen, const RefRegion& refRegion) const;
 
             bool SecondFilterSpecial(bool& isRescued, RescuePartial& rescuePartial, uint8_t& polyALen, const s_align* pAlignment, uint8_t isReversed, 
                                      const PrtlAlgnmnt& firstPartial, const RefRegion& refRegion, const int8_t* readSeq, int readLen);
@@ -123,6 +127,8 @@ namespace Tangram
             const BamPairTable& bamPairTable;
 
             const Reference& ref;
+
+            const ChromView& chrom;
     };
 };
 
@@ -23,11 +23,13 @@
 #include "TGM_FragLenTable.h"
 #include "TGM_LibTable.h"
 #include "TGM_BamPair.h"
+#include "TGM_BamPairThread.h"
 #include "TGM_Detector.h"
 #include "TGM_Reference.h"
 #include "TGM_Aligner.h"
 #include "TGM_Printer.h"
 #include "TGM_Genotype.h"
+#include "TGM_Scheduler.h"
 
 #include "api/BamMultiReader.h"
 
@@ -67,20 +69,59 @@ int main(int argc, char *argv[])
 
     // read the fragment length distribution table
     FragLenTable fragLenTable;
-    fragLenTable.Read(detectPars.fpHistInput);
+    fragLenTable.Read(detectPars.fpHistInput, libTable);
+
+    if (detectPars.showDecodeStat)
+    {
+        fprintf(stderr, "fragment length table: %llu bytes of quality tables (limit %llu bytes)\n", 
+                (unsigned long long) fragLenTable.GetQualTableSize(), (unsigned long long) MAX_FRAG_LEN_QUAL_TABLE_SIZE);
+    }
 
     // where should we start to call the SV events
     parameters.ParseRangeStr(bamMultiReader);
+
+    // without a region we call the whole genome chromosome by chromosome
+    // a windowed region goes through the scheduler as a single task
+    if (detectPars.refID < 0 || detectPars.windowSize > 0)
+    {
+        Scheduler scheduler(filenames, detectPars, alignerPars, genotypePars, libTable, fragLenTable);
+
+        if (detectPars.refID < 0)
+            scheduler.Init(bamMultiReader.GetReferenceData());
+        else
+            scheduler.Init(bamMultiReader.GetReferenceData(), detectPars.refID, detectPars.range[0], detectPars.range[1]);
+
+        scheduler.Run();
+        scheduler.Print();
+
+        fragLenTable.Destory();
+        bamMultiReader.Close();
+        return EXIT_SUCCESS;
+    }
+
     parameters.SetRange(bamMultiReader, libTable.GetFragLenMax());
 
     BamPairTable bamPairTable(detectPars, libTable, fragLenTable);
+    bamPairTable.InitCoverage(genotypePars);
 
     // iterate through the bam files and fill the bam pair table
-    BamAlignment alignment;
-    while(bamMultiReader.GetNextAlignment(alignment))
+    if (detectPars.numThread > 1)
     {
-        bamPairTable.Update(alignment);
+        BamPairThread bamPairThread(detectPars, libTable, fragLenTable);
+        bamPairThread.Load(bamPairTable, bamMultiReader);
     }
+    else
+    {
+        // only the core fields are read here, the table decodes the rest on demand
+        BamAlignment alignment;
+        while(bamMultiReader.GetNextAlignmentCore(alignment))
+        {
+            bamPairTable.Update(alignment);
+        }
+    }
+
+    if (detectPars.showDecodeStat)
+        bamPairTable.ReportDecode(stderr, "bam pair table");
 
     // clean the fragnment length table
     fragLenTable.Destory();
@@ -91,21 +132,25 @@ int main(int argc, char *argv[])
     detector.CallEvents();
 
     const Reference* pRef = NULL;
+    const ChromView* pChrom = NULL;
     const Aligner* pAligner = NULL;
 
     Reference reference;
-    Aligner aligner(detector, bamPairTable,  alignerPars, reference, libTable);
+    ChromView chrom;
+    Aligner aligner(detector, bamPairTable,  alignerPars, reference, chrom, libTable);
 
     // call the SV events with split-read signal
     if (alignerPars.fpRefInput != NULL)
     {
         // always load the whole chromosome reference
-        reference.Read(alignerPars.fpRefInput, detectPars.refID, -1, -1);
+        reference.Read(alignerPars.fpRefInput);
         reference.CreateFamilyToZA(*(libTable.GetSpecialRefNames()));
+        chrom.Read(reference, alignerPars.fpRefInput, detectPars.refID);
 
         aligner.Map();
 
         pRef = &reference;
+        pChrom = &chrom;
         pAligner = &aligner;
     }
 
@@ -114,7 +159,7 @@ int main(int argc, char *argv[])
     genotype.Init();
 
     // print out the events (vcf format)
-    Printer printer(&detector, detectPars, pAligner, pRef, libTable, bamPairTable, genotypePars, genotype);
+    Printer printer(&detector, detectPars, pAligner, pRef, pChrom, libTable, bamPairTable, genotypePars, genotype);
     printer.Init();
     printer.Print();
 
@@ -0,0 +1,186 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_TaskPool.cpp
+ *
+ *    Description:  Chunked work-stealing pool of independent tasks
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 03:58:56 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+#include <stdlib.h>
+#include <time.h>
+
+#include "TGM_Error.h"
+#include "TGM_TaskPool.h"
+
+using namespace Tangram;
+
+// number of chunks each thread should get at least
+#define MIN_CHUNKS_PER_THREAD 16
+
+static double GetTime(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+TaskPool::TaskPool(unsigned int numTasks, int numThread, unsigned int maxChunkSize) : numThread(numThread)
+{
+    queues = (TaskQueue*) malloc(numThread * sizeof(TaskQueue));
+    if (queues == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the task queues.\n");
+
+    // small chunks are stolen easily, large chunks need less locking
+    chunkSize = numTasks / (numThread * MIN_CHUNKS_PER_THREAD);
+    if (chunkSize > maxChunkSize)
+        chunkSize = maxChunkSize;
+
+    if (chunkSize == 0)
+        chunkSize = 1;
+
+    unsigned int start = 0;
+    unsigned int shareSize = numTasks / numThread;
+    unsigned int shareRemainder = numTasks % numThread;
+
+    for (int i = 0; i != numThread; ++i)
+    {
+        queues[i].next = start;
+        queues[i].end = start + shareSize;
+
+        if (shareRemainder != 0)
+        {
+            queues[i].end += 1;
+            --shareRemainder;
+        }
+
+        start = queues[i].end;
+
+        queues[i].busyTime = 0.0;
+        queues[i].chunkStart = -1.0;
+
+        if (pthread_mutex_init(&(queues[i].mutex), NULL) != 0)
+            TGM_ErrQuit("ERROR: Cannot initialize the mutex of a task queue.\n");
+    }
+
+    startTime = GetTime();
+}
+
+TaskPool::~TaskPool()
+{
+    for (int i = 0; i != numThread; ++i)
+        pthread_mutex_destroy(&(queues[i].mutex));
+
+    free(queues);
+}
+
+bool TaskPool::GetChunk(unsigned int& begin, unsigned int& end, int threadIdx)
+{
+    TaskQueue& queue = queues[threadIdx];
+    double now = GetTime();
+
+    // the previous chunk is done
+    if (queue.chunkStart >= 0.0)
+    {
+        queue.busyTime += now - queue.chunkStart;
+        queue.chunkStart = -1.0;
+    }
+
+    do
+    {
+        pthread_mutex_lock(&(queue.mutex));
+
+        if (queue.next < queue.end)
+        {
+            begin = queue.next;
+            end = begin + chunkSize < queue.end ? begin + chunkSize : queue.end;
+            queue.next = end;
+
+            pthread_mutex_unlock(&(queue.mutex));
+
+            queue.chunkStart = GetTime();
+            return true;
+        }
+
+        pthread_mutex_unlock(&(queue.mutex));
+
+    }while (Steal(threadIdx));
+
+    return false;
+}
+
+bool TaskPool::Steal(int threadIdx)
+{
+    while (true)
+    {
+        // the victim is the thread with the most tasks left
+        int victim = -1;
+        unsigned int maxLeft = 0;
+        for (int i = 0; i != numThread; ++i)
+        {
+            if (i == threadIdx)
+                continue;
+
+            pthread_mutex_lock(&(queues[i].mutex));
+            unsigned int left = queues[i].end - queues[i].next;
+            pthread_mutex_unlock(&(queues[i].mutex));
+
+            if (left > maxLeft)
+            {
+                maxLeft = left;
+                victim = i;
+            }
+        }
+
+        // the tasks are never added back so the pool is drained
+        if (victim < 0)
+            return false;
+
+        TaskQueue& victimQueue = queues[victim];
+        pthread_mutex_lock(&(victimQueue.mutex));
+
+        unsigned int left = victimQueue.end - victimQueue.next;
+        if (left == 0)
+        {
+            // someone else was faster, look for another victim
+            pthread_mutex_unlock(&(victimQueue.mutex));
+            continue;
+        }
+
+        unsigned int stolenEnd = victimQueue.end;
+        unsigned int stolenBegin = victimQueue.next + left / 2;
+        victimQueue.end = stolenBegin;
+
+        pthread_mutex_unlock(&(victimQueue.mutex));
+
+        TaskQueue& queue = queues[threadIdx];
+        pthread_mutex_lock(&(queue.mutex));
+
+        queue.next = stolenBegin;
+        queue.end = stolenEnd;
+
+        pthread_mutex_unlock(&(queue.mutex));
+        return true;
+    }
+}
+
+void TaskPool::Report(FILE* fpOutput, const char* name) const
+{
+    double wallTime = GetTime() - startTime;
+
+    for (int i = 0; i != numThread; ++i)
+    {
+        double idleTime = wallTime - queues[i].busyTime;
+        if (idleTime < 0.0)
+            idleTime = 0.0;
+
+        fprintf(fpOutput, "%s thread %d: busy %.3f s, idle %.3f s\n", name, i, queues[i].busyTime, idleTime);
+    }
+}
@@ -0,0 +1,73 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  TGM_TaskPool.h
+ *
+ *    Description:  Chunked work-stealing pool of independent tasks
+ *
+ *        Version:  1.0
+ *        Created:  10/17/2026 03:58:56 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+#ifndef  TGM_TASKPOOL_H
+#define  TGM_TASKPOOL_H
+
+#include <pthread.h>
+#include <cstdio>
+
+namespace Tangram
+{
+    // the tasks not taken yet by a thread
+    typedef struct
+    {
+        unsigned int next;
+
+        unsigned int end;
+
+        // time spent on the tasks and the time the last chunk was handed out
+        double busyTime;
+
+        double chunkStart;
+
+        pthread_mutex_t mutex;
+
+    }TaskQueue;
+
+    // The tasks 0 to n-1 are split into one contiguous range for each thread.
+    // A thread takes the tasks from the front of its own range chunk by chunk;
+    // when its range is empty it steals the back half of the largest range
+    // left. The results do not depend on which thread runs a task, so the
+    // work is balanced even if the expensive tasks are clustered together.
+    class TaskPool
+    {
+        public:
+            TaskPool(unsigned int numTasks, int numThread, unsigned int maxChunkSize);
+            ~TaskPool();
+
+            // get the next chunk of tasks [begin, end) for a thread. return false when all the tasks are taken
+            bool GetChunk(unsigned int& begin, unsigned int& end, int threadIdx);
+
+            // print the busy and idle time of each thread
+            void Report(FILE* fpOutput, const char* name) const;
+
+        private:
+
+            bool Steal(int threadIdx);
+
+        private:
+
+            TaskQueue* queues;
+
+            int numThread;
+
+            unsigned int chunkSize;
+
+            double startTime;
+    };
+};
+
+#endif  /*TGM_TASKPOOL_H*/
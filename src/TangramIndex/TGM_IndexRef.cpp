@@ -28,7 +28,7 @@ int main(int argc, char *argv[])
     refPars.Set((const char**) argv, argc);
 
     Reference reference;
-    reference.Create(refPars.fpRefInput, refPars.fpSpRefInput, refPars.fpOutput);
+    reference.Create(refPars.fpRefInput, refPars.fpSpRefInput, refPars.fpOutput, refPars.isPacked, refPars.numThread);
 
     return EXIT_SUCCESS;
 }
@@ -25,7 +25,7 @@
 using namespace Tangram;
 
 // total number of arguments we should expect for the split-read build program
-#define OPT_TOTAL_ARGS       4
+#define OPT_TOTAL_ARGS       6
 
 // total number of required arguments we should expect for the split-read build program
 #define OPT_REQUIRED_ARGS    3
@@ -41,12 +41,18 @@ using namespace Tangram;
 
 #define OPT_OUTPUT               3
 
+#define OPT_UNPACKED             4
+
+#define OPT_THREAD_NUM           5
+
 
 RefPars::RefPars()
 {
     fpRefInput = NULL;
     fpSpRefInput = NULL;
     fpOutput = NULL;
+    isPacked = true;
+    numThread = 1;
 }
 
 RefPars::~RefPars()
@@ -64,6 +70,8 @@ void RefPars::Set(const char** argv, int argc)
         {"ref",  NULL, FALSE},
         {"sp",  NULL, FALSE},
         {"out",  NULL, FALSE},
+        {"v1",  NULL, FALSE},
+        {"p",  NULL, FALSE},
         {NULL,   NULL, FALSE}
     };
 
@@ -106,6 +114,25 @@ void RefPars::Set(const char** argv, int argc)
                 if (fpOutput == NULL)
                     TGM_ErrQuit("ERROR: Cannot open output file\n");
 
+                break;
+            case OPT_UNPACKED:
+                if (opts[i].isFound)
+                {
+                    if (opts[i].value != NULL)
+                        TGM_ErrQuit("ERROR: -v1 is a flag. No argument is needed.\n");
+
+                    isPacked = false;
+                }
+
+                break;
+            case OPT_THREAD_NUM:
+                if (opts[i].value != NULL)
+                {
+                    numThread = atoi(opts[i].value);
+                    if (numThread <= 0)
+                        TGM_ErrQuit("ERROR: Invalid number of threads.\n");
+                }
+
                 break;
             default:
                 TGM_ErrQuit("ERROR: Unrecognized argument.\n");
@@ -121,6 +148,8 @@ void RefPars::ShowHelp(void) const
     printf("Mandatory arguments: -ref  FILE  input of reference file\n");
     printf("                     -sp   FILE  input of special reference file\n");
     printf("                     -out  FILE  output file of indexed reference\n");
+    printf("Options:             -v1         write the original format with one byte per base instead of 2 bits [false]\n");
+    printf("                     -p    INT   number of threads used for the chromosomes [1]\n");
     printf("                     -help       print this help message\n");
 
     exit(EXIT_SUCCESS);
@@ -41,6 +41,12 @@ namespace Tangram
             gzFile fpRefInput;
             gzFile fpSpRefInput;
             FILE*  fpOutput;
+
+            // write the original format with one byte per base instead of the packed one
+            bool isPacked;
+
+            // number of threads that encode the chromosomes
+            int numThread;
     };
 };
 
@@ -320,7 +320,16 @@ static inline int TGM_BamInStreamLiteLoadNext(TGM_BamInStreamLite* pBamInStreamL
     // we have to initialize those newly created bam alignment 
     // and update the query name hash since the address of those
     // bam alignments are changed after expanding
-    int ret = bam_read1(pBamInStreamLite->pBamInput, pBamInStreamLite->pBamBuff[loadIndex]);
+    int ret = 0;
+    if (pBamInStreamLite->pBamIter == NULL)
+        ret = bam_read1(pBamInStreamLite->pBamInput, pBamInStreamLite->pBamBuff[loadIndex]);
+    else
+    {
+        // the iterator also returns the alignments overlapping the start of the region
+        while ((ret = bam_iter_read(pBamInStreamLite->pBamInput, pBamInStreamLite->pBamIter, pBamInStreamLite->pBamBuff[loadIndex])) > 0
+               && pBamInStreamLite->pBamBuff[loadIndex]->core.pos < pBamInStreamLite->regionBegin);
+    }
+
     if (ret > 0)
     {
         pBamInStreamLite->tail = loadIndex;
@@ -411,6 +420,7 @@ TGM_BamInStreamLite* TGM_BamInStreamLiteAlloc(void)
         pBamInStreamLite->pBamBuff[i] = bam_init1();
 
     pBamInStreamLite->pMateInfoTable = NULL;
+    pBamInStreamLite->pBamIter = NULL;
     pBamInStreamLite->currRefID = NO_QUERY_YET;
 
     return pBamInStreamLite;
@@ -423,8 +433,8 @@ void TGM_BamInStreamLiteFree(TGM_BamInStreamLite* pBamInStreamLite)
         for(unsigned int i = 0; i != 4; ++i)
             bam_destroy1(pBamInStreamLite->pBamBuff[i]);
 
-        TGM_MateInfoTableFree(pBamInStreamLite->pMateInfoTable);
         TGM_BamInStreamLiteClose(pBamInStreamLite);
+        TGM_MateInfoTableFree(pBamInStreamLite->pMateInfoTable);
 
         free(pBamInStreamLite);
     }
@@ -852,6 +862,13 @@ void TGM_BamInStreamLiteClose(TGM_BamInStreamLite* pBamInStreamLite)
 {
     TGM_BamInStreamLiteClear(pBamInStreamLite);
 
+    if (pBamInStreamLite->pBamIter != NULL)
+    {
+        bam_iter_destroy(pBamInStreamLite->pBamIter);
+        pBamInStreamLite->pBamIter = NULL;
+        pBamInStreamLite->regionBegin = 0;
+    }
+
     if (pBamInStreamLite->pBamInput != NULL)
     {
         bam_close(pBamInStreamLite->pBamInput);
@@ -889,6 +906,17 @@ TGM_Status TGM_BamInStreamLiteTestZA(TGM_BamInStreamLite* pBamInStreamLite)
     return status;
 }
 
+void TGM_BamInStreamLiteJump(TGM_BamInStreamLite* pBamInStreamLite, const bam_index_t* pBamIndex, int32_t refID, int32_t begin, int32_t end)
+{
+    TGM_BamInStreamLiteClear(pBamInStreamLite);
+
+    if (pBamInStreamLite->pBamIter != NULL)
+        bam_iter_destroy(pBamInStreamLite->pBamIter);
+
+    pBamInStreamLite->pBamIter = bam_iter_query(pBamIndex, refID, begin, end);
+    pBamInStreamLite->regionBegin = begin;
+}
+
 void TGM_BamInStreamLiteClear(TGM_BamInStreamLite* pBamInStreamLite)
 {
     pBamInStreamLite->head = 0;
@@ -953,6 +981,43 @@ TGM_SortMode TGM_BamHeaderGetSortMode(const TGM_BamHeader* pBamHeader)
         return TGM_ERR_SORTED;
 }
 
+const TGM_MateInfo** TGM_BamInStreamLiteGetPendingMates(unsigned int* pNumMates, const TGM_BamInStreamLite* pBamInStreamLite)
+{
+    *pNumMates = 0;
+    const TGM_MateInfoTable* pMateInfoTable = pBamInStreamLite->pMateInfoTable;
+    if (pMateInfoTable == NULL || pMateInfoTable->top == pMateInfoTable->capacity)
+        return NULL;
+
+    const TGM_MateInfo** ppMateInfos = (const TGM_MateInfo**) malloc(sizeof(TGM_MateInfo*) * (pMateInfoTable->capacity - pMateInfoTable->top));
+    if (ppMateInfos == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the pending mates.\n");
+
+    const khash_t(name)* pNameHash = pMateInfoTable->pNameHash;
+    for (khiter_t khIter = kh_begin(pNameHash); khIter != kh_end(pNameHash); ++khIter)
+    {
+        if (kh_exist(pNameHash, khIter))
+        {
+            ppMateInfos[*pNumMates] = pMateInfoTable->data + kh_value(pNameHash, khIter);
+            ++(*pNumMates);
+        }
+    }
+
+    return ppMateInfos;
+}
+
+TGM_Status TGM_BamInStreamLiteReadNext(const bam1_t** ppAlgn, TGM_BamInStreamLite* pBamInStreamLite)
+{
+    int ret = TGM_BamInStreamLiteLoadNext(pBamInStreamLite);
+    if (ret > 0)
+    {
+        --(pBamInStreamLite->size);
+        *ppAlgn = pBamInStreamLite->pBamBuff[pBamInStreamLite->tail];
+        return TGM_OK;
+    }
+
+    return (ret == TGM_EOF ? TGM_EOF : TGM_ERR);
+}
+
 TGM_Status TGM_BamInStreamLiteRead(const bam1_t* pAlgns[3], int* retNum, int64_t* pMateInfoIndex, TGM_BamInStreamLite* pBamInStreamLite)
 {
     int ret = 0;
@@ -996,6 +1061,15 @@ TGM_Status TGM_BamInStreamLiteRead(const bam1_t* pAlgns[3], int* retNum, int64_t
                     ret = TGM_OK;
                     break;
                 }
+                else if (pBamInStreamLite->pBamBuff[tail]->core.mpos < pBamInStreamLite->regionBegin)
+                {
+                    // the upstream mate is out of the current region, let the caller look for it
+                    pAlgns[0] = pBamInStreamLite->pBamBuff[tail];
+                    *retNum = 1;
+                    *pMateInfoIndex = -1;
+                    ret = TGM_OK;
+                    break;
+                }
             }
         }
     }
@@ -164,6 +164,10 @@ typedef struct TGM_BamInStreamLite
 
     TGM_MateInfoTable* pMateInfoTable;
 
+    bam_iter_t pBamIter;            // iterator of the current region (NULL for reading the whole file)
+
+    int32_t regionBegin;            // start of the current region, alignments starting before it are skipped
+
     uint8_t head;
 
     uint8_t tail;
@@ -529,6 +533,11 @@ void TGM_BamInStreamLiteClose(TGM_BamInStreamLite* pBamInStreamLite);
 
 TGM_Status TGM_BamInStreamLiteTestZA(TGM_BamInStreamLite* pBamInStreamLite);
 
+// restrict the following reads to the alignments starting in a region [begin, end) of a reference.
+// in the no-za mode, a downstream mate whose upstream mate starts before the region is returned
+// without any mate information (the mate information index is -1)
+void TGM_BamInStreamLiteJump(TGM_BamInStreamLite* pBamInStreamLite, const bam_index_t* pBamIndex, int32_t refID, int32_t begin, int32_t end);
+
 void TGM_BamInStreamLiteClear(TGM_BamInStreamLite* pBamInStreamLite);
 
 #define TGM_BamInStreamLiteTell(pBamInStreamLite) bam_tell((pBamInStreamLite)->pBamInput)
@@ -539,6 +548,14 @@ TGM_BamHeader* TGM_BamInStreamLiteLoadHeader(TGM_BamInStreamLite* pBamInStreamLi
 
 TGM_Status TGM_BamInStreamLiteRead(const bam1_t* pAlgns[3], int* retNum, int64_t* pMateInfoIndex, TGM_BamInStreamLite* pBamInStreamLite);
 
+// read the next alignment of the bam file (or of the region after a jump) without any filter.
+// the alignment is only valid until the next read
+TGM_Status TGM_BamInStreamLiteReadNext(const bam1_t** ppAlgn, TGM_BamInStreamLite* pBamInStreamLite);
+
+// get the upstream mates still waiting for their downstream mates in the no-za mode.
+// the returned array should be freed by the caller and its elements are only valid until the next read
+const TGM_MateInfo** TGM_BamInStreamLiteGetPendingMates(unsigned int* pNumMates, const TGM_BamInStreamLite* pBamInStreamLite);
+
 static inline const TGM_MateInfo* TGM_BamInStreamLiteGetMateInfo(const TGM_BamInStreamLite* pBamInStreamLite, int64_t index)
 {
     if (pBamInStreamLite->pMateInfoTable != NULL && index >= 0)
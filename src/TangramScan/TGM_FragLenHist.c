@@ -43,11 +43,35 @@ static inline int CompareFragLenBin(const void* a, const void* b)
         return 0;
 }
 
-static void TGM_FragLenHistToMature(TGM_FragLenHist* pHist)
+// grow the dense array so that it can count the given fragment length (shorter than DENSE_FRAGLEN_HIST_LEN)
+static void TGM_FragLenHistGrowDense(TGM_FragLenHist* pHist, uint32_t fragLen)
+{
+    uint32_t newLen = pHist->denseLen == 0 ? MIN_DENSE_FRAGLEN_HIST_LEN : pHist->denseLen;
+    while (newLen <= fragLen)
+        newLen *= 2;
+
+    if (newLen > DENSE_FRAGLEN_HIST_LEN)
+        newLen = DENSE_FRAGLEN_HIST_LEN;
+
+    pHist->denseHist = (uint64_t*) realloc(pHist->denseHist, newLen * sizeof(uint64_t));
+    if (pHist->denseHist == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the fragment length histogram.\n");
+
+    memset(pHist->denseHist + pHist->denseLen, 0, (newLen - pHist->denseLen) * sizeof(uint64_t));
+    pHist->denseLen = newLen;
+}
+
+// load the fragment lengths from the raw histogram into the fragment length array (sorted) and the frequency array
+static void TGM_FragLenHistLoadBins(TGM_FragLenHist* pHist)
 {
     khash_t(fragLen)* pRawHist = pHist->rawHist;
+    const uint64_t* denseHist = pHist->denseHist;
 
-    pHist->size = kh_size(pRawHist);
+    uint32_t size = kh_size(pRawHist);
+    for (unsigned int i = 0; i != pHist->denseLen; ++i)
+        size += (denseHist[i] != 0);
+
+    pHist->size = size;
 
     if (pHist->size > pHist->capacity)
     {
@@ -65,7 +89,20 @@ static void TGM_FragLenHistToMature(TGM_FragLenHist* pHist)
             TGM_ErrQuit("ERROR: Not enough memory for the storage of the frequency array in the fragment length histogram object.\n");
     }
 
-    unsigned int i = 0;
+    // the dense part is already sorted
+    unsigned int numDense = 0;
+    for (unsigned int i = 0; i != pHist->denseLen; ++i)
+    {
+        if (denseHist[i] != 0)
+        {
+            pHist->fragLen[numDense] = i;
+            pHist->freq[numDense] = denseHist[i];
+            ++numDense;
+        }
+    }
+
+    // the long fragment lengths are rare, they are sorted after the dense part
+    unsigned int i = numDense;
     for (khiter_t khIter = kh_begin(pRawHist); khIter != kh_end(pRawHist); ++khIter)
     {
         if (kh_exist(pRawHist, khIter))
@@ -75,49 +112,59 @@ static void TGM_FragLenHistToMature(TGM_FragLenHist* pHist)
         }
     }
 
-    qsort(pHist->fragLen, pHist->size, sizeof(uint32_t), CompareFragLenBin);
-
-    double cumFreq = 0.0;
-    double totalFragLen = 0.0;
-    uint64_t totalFreq = pHist->modeCount[0];
-    double cdf = 0;
-    uint32_t fragLenQual = 0;
+    qsort(pHist->fragLen + numDense, pHist->size - numDense, sizeof(uint32_t), CompareFragLenBin);
 
-    TGM_Bool foundMedian = FALSE;
-    for (unsigned int j = 0; j != pHist->size; ++j)
+    for (unsigned int j = numDense; j != pHist->size; ++j)
     {
         khiter_t khIter = kh_get(fragLen, pRawHist, pHist->fragLen[j]);
         if (khIter == kh_end(pRawHist))
             TGM_ErrQuit("ERROR: Cannot find the fragment length frequency from the hash table.\n");
 
         pHist->freq[j] = kh_value(pRawHist, khIter);
+    }
+}
+
+void TGM_FragLenHistUpdateStats(TGM_FragLenHist* pHist)
+{
+    pHist->mean = 0.0;
+    pHist->median = 0.0;
+    pHist->stdev = 0.0;
+
+    uint64_t totalFreq = pHist->modeCount[0];
+    if (totalFreq == 0)
+        return;
+
+    TGM_FragLenHistLoadBins(pHist);
+
+    // median, mean and standard deviation in one pass over the bins
+    double cumFreq = 0.0;
+    double totalFragLen = 0.0;
+    double totalSquare = 0.0;
+    double halfFreq = 0.5 * totalFreq;
 
-        totalFragLen += pHist->fragLen[j] * pHist->freq[j];
+    TGM_Bool foundMedian = FALSE;
+    for (unsigned int j = 0; j != pHist->size; ++j)
+    {
+        double weighted = (double) pHist->fragLen[j] * pHist->freq[j];
+
+        totalFragLen += weighted;
+        totalSquare += weighted * pHist->fragLen[j];
         cumFreq += pHist->freq[j];
-        cdf = cumFreq / totalFreq;
 
-        if (!foundMedian && cdf >= 0.5)
+        if (!foundMedian && cumFreq >= halfFreq)
         {
             pHist->median = pHist->fragLen[j];
             foundMedian = TRUE;
         }
-
-        cdf = cdf > 0.5 ? 1.0 - cdf : cdf;
-
-        fragLenQual = DoubleRoundToInt(-10.0 * log10(cdf));
-        kh_value(pRawHist, khIter) = fragLenQual;
     }
 
     pHist->mean = totalFragLen / totalFreq;
 
-    pHist->stdev = 0.0;
-    for (unsigned int j = 0; j != pHist->size; ++j)
+    if (totalFreq != 1)
     {
-        pHist->stdev += (double) pHist->freq[j] * pow(pHist->mean - pHist->fragLen[j], 2);
+        double variance = (totalSquare - totalFragLen * pHist->mean) / (double) (totalFreq - 1);
+        pHist->stdev = variance > 0.0 ? sqrt(variance) : 0.0;
     }
-
-    if (totalFreq != 1)
-        pHist->stdev = sqrt(pHist->stdev / (double) (totalFreq - 1));
 }
 
 TGM_FragLenHistArray* TGM_FragLenHistArrayAlloc(unsigned int capacity)
@@ -136,6 +183,7 @@ void TGM_FragLenHistArrayFree(TGM_FragLenHistArray* pHistArray)
         {
             free(pHistArray->data[i].fragLen);
             free(pHistArray->data[i].freq);
+            free(pHistArray->data[i].denseHist);
 
             kh_destroy(fragLen, pHistArray->data[i].rawHist);
         }
@@ -199,6 +247,8 @@ void TGM_FragLenHistArrayClear(TGM_FragLenHistArray* pHistArray)
         pHistArray->data[i].modeCount[0] = 0;
         pHistArray->data[i].modeCount[1] = 0;
 
+        if (pHistArray->data[i].denseLen > 0)
+            memset(pHistArray->data[i].denseHist, 0, sizeof(uint64_t) * pHistArray->data[i].denseLen);
         kh_clear(fragLen, pHistArray->data[i].rawHist);
     }
 }
@@ -240,17 +290,19 @@ TGM_Status TGM_FragLenHistArrayUpdate(TGM_FragLenHistArray* pHistArray, unsigned
         return TGM_OK;
     }
 
-    // because we can have up to 2 different pair mode sets (4 differen pair modes)
-    // we should choose which histogram we should update
-    // the first one (with index 0 or 1) or the second one(2, 3)
-    khash_t(fragLen)* pCurrHash = pCurrHist->rawHist;
+    ++(pCurrHist->modeCount[0]);
 
-    if (pCurrHash == NULL)
+    if (fragLen < DENSE_FRAGLEN_HIST_LEN)
     {
-        pCurrHash = kh_init(fragLen);
-        kh_resize(fragLen, pCurrHash, 20);
+        if (fragLen >= pCurrHist->denseLen)
+            TGM_FragLenHistGrowDense(pCurrHist, fragLen);
+
+        ++(pCurrHist->denseHist[fragLen]);
+        return TGM_OK;
     }
 
+    khash_t(fragLen)* pCurrHash = pCurrHist->rawHist;
+
     int ret = 0;
     khiter_t khIter = kh_put(fragLen, pCurrHash, fragLen, &ret);
 
@@ -259,12 +311,46 @@ TGM_Status TGM_FragLenHistArrayUpdate(TGM_FragLenHistArray* pHistArray, unsigned
     else
         kh_value(pCurrHash, khIter) = 1;
 
-    ++(pCurrHist->modeCount[0]);
-    pCurrHist->rawHist = pCurrHash;
-
     return TGM_OK;
 }
 
+void TGM_FragLenHistArrayMerge(TGM_FragLenHistArray* pDstHistArray, const TGM_FragLenHistArray* pSrcHistArray)
+{
+    for (unsigned int i = 0; i != pSrcHistArray->size; ++i)
+    {
+        TGM_FragLenHist* pDstHist = pDstHistArray->data + i;
+        const TGM_FragLenHist* pSrcHist = pSrcHistArray->data + i;
+
+        pDstHist->modeCount[0] += pSrcHist->modeCount[0];
+        pDstHist->modeCount[1] += pSrcHist->modeCount[1];
+
+        if (pSrcHist->denseLen > pDstHist->denseLen)
+            TGM_FragLenHistGrowDense(pDstHist, pSrcHist->denseLen - 1);
+
+        uint64_t* dstDense = pDstHist->denseHist;
+        const uint64_t* srcDense = pSrcHist->denseHist;
+        for (unsigned int j = 0; j != pSrcHist->denseLen; ++j)
+            dstDense[j] += srcDense[j];
+
+        khash_t(fragLen)* pDstHash = pDstHist->rawHist;
+        const khash_t(fragLen)* pSrcHash = pSrcHist->rawHist;
+
+        for (khiter_t khIter = kh_begin(pSrcHash); khIter != kh_end(pSrcHash); ++khIter)
+        {
+            if (!kh_exist(pSrcHash, khIter))
+                continue;
+
+            int ret = 0;
+            khiter_t dstIter = kh_put(fragLen, pDstHash, kh_key(pSrcHash, khIter), &ret);
+
+            if (ret == 0)
+                kh_value(pDstHash, dstIter) += kh_value(pSrcHash, khIter);
+            else
+                kh_value(pDstHash, dstIter) = kh_value(pSrcHash, khIter);
+        }
+    }
+}
+
 int TGM_FragLenHistLiteArrayGetFragLenQual(const TGM_FragLenHistLiteArray* pHistArray, uint32_t readGrpID, uint32_t fragLen, uint32_t median)
 {
     TGM_FragLenHistLite* pCurrHist = pHistArray->data + readGrpID;
@@ -290,7 +376,7 @@ int TGM_FragLenHistLiteArrayGetFragLenQual(const TGM_FragLenHistLiteArray* pHist
 void TGM_FragLenHistArrayFinalize(TGM_FragLenHistArray* pHistArray)
 {
     for (unsigned int i = 0; i != pHistArray->size; ++i)
-        TGM_FragLenHistToMature(&(pHistArray->data[i]));
+        TGM_FragLenHistUpdateStats(&(pHistArray->data[i]));
 }
 
 void TGM_FragLenHistArrayWriteHeader(uint32_t size, FILE* output)
@@ -27,10 +27,21 @@
 
 #define MIN_FRAGLEN_HIST_SIZE 10
 
+// fragment lengths shorter than this are counted in a dense array, the longer ones in a hash table
+#define DENSE_FRAGLEN_HIST_LEN 8192
+
+// initial length of the dense array. it is allocated on the first update and
+// grows up to DENSE_FRAGLEN_HIST_LEN with the longest fragment length seen
+#define MIN_DENSE_FRAGLEN_HIST_LEN 1024
+
 // the object used to hold the fragment length histogram of a given read group
 typedef struct TGM_FragLenHist
 {
-    void* rawHist;                  // raw fragment length histogram. this is a hash table for histogram building
+    uint64_t* denseHist;            // raw fragment length histogram of the fragment lengths shorter than denseLen
+
+    uint32_t denseLen;              // length of the dense array, 0 until the first fragment length is counted
+
+    void* rawHist;                  // raw fragment length histogram of the longer fragment lengths. this is a hash table
 
     uint32_t* fragLen;              // array of the fragment length
 
@@ -98,10 +109,16 @@ void TGM_FragLenHistArrayInit(TGM_FragLenHistArray* pHistArray, unsigned int siz
 
 TGM_Status TGM_FragLenHistArrayUpdate(TGM_FragLenHistArray* pHistArray, unsigned int backHistIndex, uint32_t fragLen);
 
+// add the raw counts of the source histograms to the destination histograms of the same read groups
+void TGM_FragLenHistArrayMerge(TGM_FragLenHistArray* pDstHistArray, const TGM_FragLenHistArray* pSrcHistArray);
+
 int TGM_FragLenHistLiteArrayGetFragLenQual(const TGM_FragLenHistLiteArray* pHistArray, uint32_t refID, uint32_t fragLen, uint32_t median);
 
 void TGM_FragLenHistArrayFinalize(TGM_FragLenHistArray* pHistArray);
 
+// compute the median, mean and standard deviation of a histogram that is still being built
+void TGM_FragLenHistUpdateStats(TGM_FragLenHist* pHist);
+
 void TGM_FragLenHistArrayWriteHeader(uint32_t size, FILE* output);
 
 void TGM_FragLenHistArrayWrite(const TGM_FragLenHistArray* pHistArray, FILE* output);
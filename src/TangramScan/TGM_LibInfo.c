@@ -1598,6 +1598,40 @@ void TGM_SpecialIDMergeRead(TGM_SpecialID* pSpecialID, FILE* pLibOutput)
     }
 }
 
+void TGM_SpecialIDMerge(TGM_SpecialID* pDstSpecialID, const TGM_SpecialID* pSrcSpecialID)
+{
+    int ret = 0;
+    khiter_t khIter = 0;
+
+    for (unsigned int i = 0; i != pSrcSpecialID->size; ++i)
+    {
+        if (pDstSpecialID->size == pDstSpecialID->capacity)
+        {
+            pDstSpecialID->capacity *= 2;
+            pDstSpecialID->names = (char (*)[3]) realloc(pDstSpecialID->names, sizeof(char) * 3 * pDstSpecialID->capacity);
+            if (pDstSpecialID->names == NULL)
+                TGM_ErrQuit("ERROR: Not enough memory for the special ID names.\n");
+
+            // the keys of the hash are the names so it has to be rebuilt after the realloc
+            kh_clear(name, pDstSpecialID->pHash);
+            for (unsigned int j = 0; j != pDstSpecialID->size; ++j)
+            {
+                khIter = kh_put(name, pDstSpecialID->pHash, pDstSpecialID->names[j], &ret);
+                kh_value((khash_t(name)*) pDstSpecialID->pHash, khIter) = j;
+            }
+        }
+
+        memcpy(pDstSpecialID->names[pDstSpecialID->size], pSrcSpecialID->names[i], 3);
+
+        khIter = kh_put(name, pDstSpecialID->pHash, pDstSpecialID->names[pDstSpecialID->size], &ret);
+        if (ret != 0)
+        {
+            kh_value((khash_t(name)*) pDstSpecialID->pHash, khIter) = pDstSpecialID->size;
+            ++(pDstSpecialID->size);
+        }
+    }
+}
+
 TGM_LibInfoTable* TGM_LibInfoTableRead(FILE* libFile)
 {
     unsigned int readSize = 0;
@@ -1875,3 +1909,86 @@ TGM_Status TGM_LibInfoTableDoMerge(TGM_LibInfoTable* pDstLibTable, TGM_LibInfoTa
     free(pIndexMap);
     return mergeStatus;
 }
+
+TGM_Status TGM_LibInfoTableAppend(TGM_LibInfoTable* pDstLibTable, TGM_Bool* pIsNew, TGM_LibInfoTable* pSrcLibTable)
+{
+    TGM_Status mergeStatus = TGM_OK;
+
+    if (pDstLibTable->cutoff != pSrcLibTable->cutoff
+        || pDstLibTable->trimRate != pSrcLibTable->trimRate)
+    {
+        return TGM_ERR;
+    }
+
+    if (pDstLibTable->pAnchorInfo->size != pSrcLibTable->pAnchorInfo->size)
+    {
+        TGM_ErrMsg("ERROR: The number of reference sequences in this bam file is inconsistent with that in previous bam files.\n");
+        return TGM_ERR;
+    }
+
+    mergeStatus = TGM_AnchorInfoMerge(pDstLibTable->pAnchorInfo, pSrcLibTable->pAnchorInfo);
+    if (mergeStatus != TGM_OK)
+        return mergeStatus;
+
+    unsigned int* pIndexMap = (unsigned int*) malloc(sizeof(unsigned int) * (pSrcLibTable->pSampleInfo->size + 1));
+    if (pIndexMap == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the sample index map.\n");
+
+    mergeStatus = TGM_SampleInfoMerge(pDstLibTable->pSampleInfo, pIndexMap, pSrcLibTable->pSampleInfo);
+    if (mergeStatus != TGM_OK)
+        return mergeStatus;
+
+    if (pDstLibTable->capacity < (pDstLibTable->size + pSrcLibTable->size))
+    {
+        pDstLibTable->capacity = (pDstLibTable->size + pSrcLibTable->size) * 2;
+
+        pDstLibTable->pReadGrps = (char**) realloc(pDstLibTable->pReadGrps, sizeof(char*) * pDstLibTable->capacity);
+        if (pDstLibTable->pReadGrps == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the read group names.\n");
+
+        pDstLibTable->pLibInfo = (TGM_LibInfo*) realloc(pDstLibTable->pLibInfo, sizeof(TGM_LibInfo) * pDstLibTable->capacity);
+        if (pDstLibTable->pLibInfo == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the read group names.\n");
+
+        pDstLibTable->pSampleMap = (int32_t*) realloc(pDstLibTable->pSampleMap, sizeof(int32_t) * pDstLibTable->capacity);
+        if (pDstLibTable->pSampleMap == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the sample map.\n");
+
+        pDstLibTable->pSeqTech = (int8_t*) realloc(pDstLibTable->pSeqTech, sizeof(int8_t) * pDstLibTable->capacity);
+        if (pDstLibTable->pSeqTech == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the sequencing technology array.\n");
+    }
+
+    int ret = 0;
+    khiter_t khIter = 0;
+
+    for (unsigned int i = 0; i != pSrcLibTable->size; ++i)
+    {
+        // a read group that was found in the previous bam files is ignored
+        // here, the same way the serial scan does not add it to the table
+        khIter = kh_put(name, pDstLibTable->pReadGrpHash, pSrcLibTable->pReadGrps[i], &ret);
+        if (ret != 0)
+        {
+            unsigned int dstIdx = pDstLibTable->size;
+
+            kh_value((khash_t(name)*)pDstLibTable->pReadGrpHash, khIter) = dstIdx;
+            pDstLibTable->pReadGrps[dstIdx] = pSrcLibTable->pReadGrps[i];
+            pSrcLibTable->pReadGrps[i] = NULL;
+
+            pDstLibTable->pSampleMap[dstIdx] = pIndexMap[pSrcLibTable->pSampleMap[i]];
+            pDstLibTable->pLibInfo[dstIdx] = pSrcLibTable->pLibInfo[i];
+            pDstLibTable->pSeqTech[dstIdx] = pSrcLibTable->pSeqTech[i];
+
+            if (pDstLibTable->pLibInfo[dstIdx].fragLenHigh > pDstLibTable->fragLenMax)
+                pDstLibTable->fragLenMax = pDstLibTable->pLibInfo[dstIdx].fragLenHigh;
+
+            ++(pDstLibTable->size);
+            pIsNew[i] = TRUE;
+        }
+        else
+            pIsNew[i] = FALSE;
+    }
+
+    free(pIndexMap);
+    return mergeStatus;
+}
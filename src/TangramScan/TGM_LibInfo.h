@@ -268,6 +268,8 @@ void TGM_SpecialIDWrite(const TGM_SpecialID* pSpecialID, FILE* pLibOutput);
 
 void TGM_SpecialIDRead(TGM_SpecialID* pSpecialID, FILE* pLibInput);
 
+void TGM_SpecialIDMerge(TGM_SpecialID* pDstSpecialID, const TGM_SpecialID* pSrcSpecialID);
+
 //====================================================================
 // function:
 //      check if a pair of read is normal
@@ -315,4 +317,22 @@ void TGM_LibInfoTableMerge(const char* workingDir);
 
 TGM_Status TGM_LibInfoTableDoMerge(TGM_LibInfoTable* pDstLibTable, TGM_LibInfoTable* pSrcLibTable);
 
+//=================================================================
+// function:
+//      append the library table of a bam file that was scanned on
+//      its own to the table of the previous bam files. Unlike
+//      TGM_LibInfoTableDoMerge, read groups that are already in
+//      the destination table are skipped (as in a serial scan)
+//
+// args:
+//      1. pDstLibTable: the library table of the previous files
+//      2. pIsNew: output flags, one per read group in the source
+//                 table, set to TRUE if the read group is added
+//      3. pSrcLibTable: the library table of the bam file
+//
+// return:
+//      TGM_OK if the two tables are compatible; else TGM_ERR
+//=================================================================
+TGM_Status TGM_LibInfoTableAppend(TGM_LibInfoTable* pDstLibTable, TGM_Bool* pIsNew, TGM_LibInfoTable* pSrcLibTable);
+
 #endif  /*TGM_LIBINFO_H*/
@@ -16,6 +16,12 @@
  * =====================================================================================
  */
 
+#include <pthread.h>
+#include <limits.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+
 #include "khash.h"
 #include "TGM_Error.h"
 #include "TGM_Utilities.h"
@@ -26,109 +32,440 @@ static const char* TGM_LibTableFileName = "lib_table.dat";
 
 static const char* TGM_HistFileName = "hist.dat";
 
+// length of the windows sampled from the autosomes
+#define SAMPLE_WIN_LEN 100000
+
+// alignments are loaded this far beyond a window to catch the downstream mates
+#define SAMPLE_WIN_PADDING 10000
+
+#define SAMPLE_MAX_WINDOWS 4096
+
+// number of windows sampled between two convergence checks
+#define SAMPLE_CHECK_WINDOWS 8
+
+// minimum number of normal pairs before a library can be called converged
+#define SAMPLE_MIN_PAIRS 100000
+
+// maximum change of the median (bp) and the standard deviation (fraction) between two checks of a converged library
+#define SAMPLE_MEDIAN_TOL 1.0
+
+#define SAMPLE_STDEV_TOL 0.01
+
 KHASH_MAP_INIT_STR(name, uint32_t);
 
-void TGM_ReadPairScan(const TGM_ReadPairScanPars* pScanPars)
+// number of regions of an indexed bam file for each thread, so the threads stay busy until the end
+#define SCAN_SHARDS_PER_THREAD 4
+
+// minimum length of a region scanned by one thread
+#define SCAN_MIN_SHARD_LEN 1000000
+
+// a downstream mate whose upstream mate is in one of the previous regions
+typedef struct TGM_CrossMate
 {
-    // some default capacity of the containers
-    unsigned int capAnchor = 150;
-    unsigned int capSample = 20;
-    unsigned int capReadGrp = 20;
-    unsigned int capHist = 10;
+    char* queryName;
 
+    uint32_t backHistIndex;               // histogram of the pair if the upstream mate is found and unique
 
-    // initialize the library information table
-    TGM_LibInfoTable* pLibTable = TGM_LibInfoTableAlloc(capAnchor, capSample, capReadGrp, pScanPars->specialPrefix);
-    TGM_LibInfoTableSetCutoff(pLibTable, pScanPars->cutoff);
-    TGM_LibInfoTableSetTrimRate(pLibTable, pScanPars->trimRate);
+    uint32_t fragLen;
 
-    TGM_Status status = TGM_CheckWorkingDir(pScanPars->workingDir);
-    if (status != TGM_OK)
-        TGM_ErrQuit("ERROR: Error found during creating the working directory.\n");
+}TGM_CrossMate;
 
-    // get the library table output file name
-    char* libTableOutputFile = TGM_CreateFileName(pScanPars->workingDir, TGM_LibTableFileName);
+// the partial results of a region of a bam file
+typedef struct TGM_ScanShard
+{
+    int32_t refID;
 
-    // write the library information table into the file
-    FILE* libTableOutput = fopen(libTableOutputFile, "wb");
-    if (libTableOutput == NULL)
-        TGM_ErrQuit("ERROR: Cannot open the library output file: %s\n", libTableOutputFile);
+    int32_t begin;
 
-    free(libTableOutputFile);
+    int32_t end;
 
-    // structure initialization
-    TGM_BamInStreamLite* pBamInStreamLite = TGM_BamInStreamLiteAlloc();
+    TGM_FragLenHistArray* pHistArray;     // fragment length histograms of the pairs found within the region
 
-    TGM_SpecialID* pSpecialID = TGM_SpecialIDAlloc(10);
+    TGM_SpecialID* pSpecialID;            // special references found in the region
 
-    // buffer used to hold the bam file name
-    char bamFileName[TGM_MAX_LINE];
+    khash_t(name)* pPendingHash;          // mapping qualities of the upstream mates still waiting for their downstream mates
 
-    TGM_FragLenHistArray* pHistArray = TGM_FragLenHistArrayAlloc(capHist);
-    TGM_BamHeader* pBamHeader = NULL;
+    TGM_CrossMate* pCrossMates;           // downstream mates looking for their upstream mates in the previous regions
 
-    // open the fragment length histogram output file
-    char* histOutputFile = TGM_CreateFileName(pScanPars->workingDir, TGM_HistFileName);
-    FILE* histOutput = fopen(histOutputFile, "w");
-    if (histOutput == NULL)
-        TGM_ErrQuit("ERROR: Cannot open fragment length histogram file: %s\n", histOutputFile);
+    unsigned int numCross;
 
-    free(histOutputFile);
+    unsigned int capCross;
 
-    uint32_t readGrpCount = 0;
-    TGM_FragLenHistArrayWriteHeader(readGrpCount, histOutput);
+}TGM_ScanShard;
+
+// the partial results of a bam file
+typedef struct TGM_ScanResult
+{
+    TGM_LibInfoTable* pLibTable;          // library table with the read groups of this bam file only
+
+    TGM_FragLenHistArray* pHistArray;     // fragment length histograms of the read groups
+
+    TGM_SpecialID* pSpecialID;            // special references found in this bam file
+
+    TGM_ScanShard* pShards;               // regions scanned by different threads (NULL if the whole file is scanned by one thread)
+
+    unsigned int numShards;
+
+    bam_index_t* pBamIndex;
+
+    TGM_SortMode sortMode;
+
+    TGM_FilterDataNoZA filterData;        // filter data for the no-za sort mode
+
+    TGM_Bool loadCross;                   // filter data for the za sort mode
+
+    unsigned int numDone;                 // number of the finished scan tasks of the bam file
+
+}TGM_ScanResult;
+
+// a piece of work for the scan threads: a whole bam file or one region of it
+typedef struct TGM_ScanTask
+{
+    unsigned int fileIdx;
+
+    int shardIdx;                         // -1 for the whole bam file
+
+}TGM_ScanTask;
+
+// data shared by the scan threads
+typedef struct TGM_ScanData
+{
+    const TGM_ReadPairScanPars* pScanPars;
+
+    char** pBamFiles;                     // names of the bam files
+
+    TGM_ScanResult* pResults;             // partial results, one for each bam file
+
+    unsigned int numFiles;
+
+    TGM_ScanTask* pTasks;                 // scan tasks in the order of the bam files and the regions
+
+    unsigned int numTasks;
+
+    unsigned int capTasks;
+
+    unsigned int nextTask;                // index of the next task to be done
+
+    TGM_Bool isFinished;                  // no more task will be added
+
+    pthread_mutex_t mutex;
 
-    while (TGM_GetNextLine(bamFileName, TGM_MAX_LINE, pScanPars->fileListInput) == TGM_OK)
+    pthread_cond_t taskCond;              // signaled whenever new tasks are added
+
+    pthread_cond_t doneCond;              // signaled whenever a scan task is finished
+
+}TGM_ScanData;
+
+// only chromosomes with a number (after the optional "chr") are autosomes
+static TGM_Bool TGM_IsAutosome(const char* refName)
+{
+    if (strncasecmp(refName, "chr", 3) == 0)
+        refName += 3;
+
+    if (*refName == '\0')
+        return FALSE;
+
+    for (; *refName != '\0'; ++refName)
     {
-        // open the bam file
-        TGM_BamInStreamLiteOpen(pBamInStreamLite, bamFileName);
+        if (*refName < '0' || *refName > '9')
+            return FALSE;
+    }
 
-        // load the bam header before read any alignments
-        pBamHeader = TGM_BamInStreamLiteLoadHeader(pBamInStreamLite);
+    return TRUE;
+}
 
-        // process the header information
-        unsigned int oldSize = 0;
-        if (TGM_LibInfoTableSetRG(pLibTable, &oldSize, pBamHeader) != TGM_OK)
-            TGM_ErrQuit("ERROR: Found an error when loading the bam file.\n");
+static TGM_Bool TGM_IsSampledRef(const TGM_AnchorInfo* pAnchorInfo, unsigned int refID, TGM_Bool autosomeOnly)
+{
+    if (pAnchorInfo->pLength[refID] <= 0)
+        return FALSE;
 
-        // initialize the fragment length histogram array with the number of newly added libraries in the bam file
-        TGM_FragLenHistArrayInit(pHistArray, pLibTable->size - oldSize);
+    if (pAnchorInfo->pSpecialPrefix != NULL
+        && strncmp(pAnchorInfo->pAnchors[refID], pAnchorInfo->pSpecialPrefix, pAnchorInfo->specialPrefixLen) == 0)
+    {
+        return FALSE;
+    }
 
-        // do not load cross pairs when build the fragment length distribution
-        TGM_Bool loadCross = TRUE;
+    return !autosomeOnly || TGM_IsAutosome(pAnchorInfo->pAnchors[refID]);
+}
 
-        // filter data for the no-za sort mode
-        TGM_FilterDataNoZA filterData = {pLibTable, TRUE};
+// check if all the libraries reach the target number of pairs or their histograms stop changing
+static TGM_Bool TGM_ReadPairScanConverged(TGM_FragLenHistArray* pHistArray, double* pLastStats, uint32_t sampleNum)
+{
+    TGM_Bool isConverged = TRUE;
 
-        // get the sorting order from the bam header
-        TGM_SortMode sortMode = TGM_BamHeaderGetSortMode(pBamHeader);
-        if (sortMode == TGM_SORTED_COORDINATE_NO_ZA || sortMode == TGM_SORTED_NAME || sortMode == TGM_SORTED_SPLIT)
+    for (unsigned int i = 0; i != pHistArray->size; ++i)
+    {
+        TGM_FragLenHist* pHist = pHistArray->data + i;
+        if (pHist->modeCount[0] >= sampleNum)
+            continue;
+
+        double lastMedian = pLastStats[2 * i];
+        double lastStdev = pLastStats[2 * i + 1];
+
+        TGM_FragLenHistUpdateStats(pHist);
+        if (pHist->modeCount[0] < SAMPLE_MIN_PAIRS
+            || fabs(pHist->median - lastMedian) > SAMPLE_MEDIAN_TOL
+            || fabs(pHist->stdev - lastStdev) > SAMPLE_STDEV_TOL * lastStdev)
         {
-            // test if the bam file has za tag or not
-            TGM_Status status = TGM_BamInStreamLiteTestZA(pBamInStreamLite);
+            isConverged = FALSE;
+        }
+
+        pLastStats[2 * i] = pHist->median;
+        pLastStats[2 * i + 1] = pHist->stdev;
+    }
+
+    return isConverged;
+}
 
-            if (status == TGM_OK)
-                sortMode = TGM_SORTED_COORDINATE_ZA;
-            else if (status == TGM_ERR)
+// Build the fragment length histograms from windows evenly spread across the
+// autosomes. The windows are visited in the bit-reversed order of their
+// positions so the ones visited so far are always spread over the whole
+// genome, and the sampling stops as soon as every library converges. A
+// fragment is counted in the window that holds its upstream mate.
+static void TGM_ReadPairScanSample(TGM_FragLenHistArray* pHistArray, TGM_BamInStreamLite* pBamInStreamLite, const bam_index_t* pBamIndex,
+                                   const TGM_LibInfoTable* pLibTable, const TGM_ReadPairScanPars* pScanPars)
+{
+    const TGM_AnchorInfo* pAnchorInfo = pLibTable->pAnchorInfo;
+
+    // fall back to all the chromosomes if none of them looks like an autosome
+    TGM_Bool autosomeOnly = FALSE;
+    for (unsigned int i = 0; i != pAnchorInfo->size && !autosomeOnly; ++i)
+        autosomeOnly = TGM_IsSampledRef(pAnchorInfo, i, TRUE);
+
+    uint64_t totalLen = 0;
+    for (unsigned int i = 0; i != pAnchorInfo->size; ++i)
+    {
+        if (TGM_IsSampledRef(pAnchorInfo, i, autosomeOnly))
+            totalLen += pAnchorInfo->pLength[i];
+    }
+
+    if (totalLen == 0)
+        return;
+
+    uint64_t numWindows = totalLen / SAMPLE_WIN_LEN;
+    if (numWindows == 0)
+        numWindows = 1;
+    else if (numWindows > SAMPLE_MAX_WINDOWS)
+        numWindows = SAMPLE_MAX_WINDOWS;
+
+    uint64_t stride = totalLen / numWindows;
+
+    unsigned int numBits = 0;
+    while ((1ULL << numBits) < numWindows)
+        ++numBits;
+
+    double* pLastStats = (double*) calloc(2 * pHistArray->size + 1, sizeof(double));
+    if (pLastStats == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the histogram statistics.\n");
+
+    int retNum = 0;
+    const bam1_t* pAlgns[3] = {NULL, NULL, NULL};
+
+    unsigned int numSampled = 0;
+    TGM_Bool isConverged = FALSE;
+
+    for (uint64_t k = 0; k != (1ULL << numBits) && !isConverged; ++k)
+    {
+        uint64_t winIdx = 0;
+        for (unsigned int b = 0; b != numBits; ++b)
+            winIdx |= ((k >> b) & 1) << (numBits - 1 - b);
+
+        if (winIdx >= numWindows)
+            continue;
+
+        // locate the window in the concatenated chromosomes
+        uint64_t offset = winIdx * stride;
+        unsigned int refID = 0;
+        for (; refID != pAnchorInfo->size; ++refID)
+        {
+            if (!TGM_IsSampledRef(pAnchorInfo, refID, autosomeOnly))
                 continue;
 
-            TGM_BamInStreamLiteSetSortMode(pBamInStreamLite, sortMode);
+            if (offset < (uint64_t) pAnchorInfo->pLength[refID])
+                break;
+
+            offset -= pAnchorInfo->pLength[refID];
         }
-        else
-            TGM_ErrQuit("ERROR: Invalid sorting order.\n");
 
-        // set the sort order for the bam instream
-        if (sortMode != TGM_SORTED_COORDINATE_NO_ZA)
+        int32_t begin = offset;
+        int32_t end = begin + SAMPLE_WIN_LEN < pAnchorInfo->pLength[refID] ? begin + SAMPLE_WIN_LEN : pAnchorInfo->pLength[refID];
+
+        TGM_BamInStreamLiteJump(pBamInStreamLite, pBamIndex, refID, begin, end + SAMPLE_WIN_PADDING);
+
+        TGM_Status bamStatus = TGM_OK;
+        do
         {
-            TGM_BamInStreamLiteSetFilter(pBamInStreamLite, TGM_ReadPairFilter);
-            TGM_BamInStreamLiteSetFilterData(pBamInStreamLite, &loadCross);
+            int64_t index = -1;
+            bamStatus = TGM_BamInStreamLiteRead(pAlgns, &retNum, &index, pBamInStreamLite);
+
+            if (retNum > 0)
+            {
+                const bam1_t* pAlgn = pAlgns[0];
+                int32_t upPos = (pAlgn->core.tid == pAlgn->core.mtid && pAlgn->core.mpos < pAlgn->core.pos) ? pAlgn->core.mpos : pAlgn->core.pos;
+                if (upPos < begin || upPos >= end)
+                    continue;
+
+                TGM_PairStats pairStats;
+                TGM_ZAtag zaTag;
+
+                const TGM_MateInfo* pMateInfo = TGM_BamInStreamLiteGetMateInfo(pBamInStreamLite, index);
+
+                unsigned int backHistIndex = 0;
+                TGM_Status zaStatus = TGM_ERR;
+                if (TGM_IsNormalPair(&pairStats, &zaTag, &zaStatus, pMateInfo, &backHistIndex, pAlgns, retNum, pLibTable, pScanPars->minMQ))
+                    TGM_FragLenHistArrayUpdate(pHistArray, backHistIndex, pairStats.fragLen);
+            }
+
+        }while(bamStatus == TGM_OK);
+
+        ++numSampled;
+        if (numSampled % SAMPLE_CHECK_WINDOWS == 0)
+            isConverged = TGM_ReadPairScanConverged(pHistArray, pLastStats, pScanPars->sampleNum);
+    }
+
+    free(pLastStats);
+}
+
+// the special reference IDs of a bam file with za tags are still collected from all the alignments
+static void TGM_ReadPairScanSpecialID(TGM_SpecialID* pSpecialID, TGM_BamInStreamLite* pBamInStreamLite)
+{
+    int retNum = 0;
+    const bam1_t* pAlgns[3] = {NULL, NULL, NULL};
+
+    TGM_Status bamStatus = TGM_OK;
+    do
+    {
+        int64_t index = -1;
+        bamStatus = TGM_BamInStreamLiteRead(pAlgns, &retNum, &index, pBamInStreamLite);
+
+        if (retNum == 1)
+        {
+            TGM_ZAtag zaTag;
+            if (TGM_LoadZAtag(&zaTag, pAlgns[0]) == TGM_OK)
+                TGM_SpecialIDUpdate(pSpecialID, &zaTag);
         }
-        else
+
+    }while(bamStatus == TGM_OK);
+}
+
+// open a bam file and build its own library table from the header.
+// return NULL if the bam file does not have any alignment
+static TGM_BamHeader* TGM_ReadPairScanOpen(TGM_ScanResult* pResult, TGM_BamInStreamLite* pBamInStreamLite, const char* bamFileName, const TGM_ReadPairScanPars* pScanPars)
+{
+    // some default capacity of the containers
+    unsigned int capAnchor = 150;
+    unsigned int capSample = 20;
+    unsigned int capReadGrp = 20;
+    unsigned int capHist = 10;
+
+    TGM_LibInfoTable* pLibTable = TGM_LibInfoTableAlloc(capAnchor, capSample, capReadGrp, pScanPars->specialPrefix);
+    TGM_LibInfoTableSetCutoff(pLibTable, pScanPars->cutoff);
+    TGM_LibInfoTableSetTrimRate(pLibTable, pScanPars->trimRate);
+
+    pResult->pLibTable = pLibTable;
+    pResult->pHistArray = TGM_FragLenHistArrayAlloc(capHist);
+    pResult->pSpecialID = TGM_SpecialIDAlloc(10);
+
+    // open the bam file
+    TGM_BamInStreamLiteOpen(pBamInStreamLite, bamFileName);
+
+    // load the bam header before read any alignments
+    TGM_BamHeader* pBamHeader = TGM_BamInStreamLiteLoadHeader(pBamInStreamLite);
+
+    // process the header information
+    unsigned int oldSize = 0;
+    if (TGM_LibInfoTableSetRG(pLibTable, &oldSize, pBamHeader) != TGM_OK)
+        TGM_ErrQuit("ERROR: Found an error when loading the bam file.\n");
+
+    // do not load cross pairs when build the fragment length distribution
+    pResult->loadCross = TRUE;
+    pResult->filterData.pLibTable = pLibTable;
+    pResult->filterData.keepNormal = TRUE;
+
+    // get the sorting order from the bam header
+    TGM_SortMode sortMode = TGM_BamHeaderGetSortMode(pBamHeader);
+
+    if (sortMode == TGM_SORTED_COORDINATE_NO_ZA || sortMode == TGM_SORTED_NAME || sortMode == TGM_SORTED_SPLIT)
+    {
+        // test if the bam file has za tag or not
+        TGM_Status status = TGM_BamInStreamLiteTestZA(pBamInStreamLite);
+
+        if (status == TGM_OK)
+            sortMode = TGM_SORTED_COORDINATE_ZA;
+        else if (status == TGM_ERR)
         {
-            TGM_BamInStreamLiteSetFilter(pBamInStreamLite, TGM_ReadPairNoZAFilter);
-            TGM_BamInStreamLiteSetFilterData(pBamInStreamLite, &filterData);
+            // an empty bam file: keep its read groups but do not write any histogram
+            memset(pLibTable->pLibInfo, 0, sizeof(TGM_LibInfo) * pLibTable->size);
+
+            TGM_BamInStreamLiteClose(pBamInStreamLite);
+            TGM_BamHeaderFree(pBamHeader);
+            return NULL;
         }
+    }
+    else
+        TGM_ErrQuit("ERROR: Invalid sorting order.\n");
+
+    pResult->sortMode = sortMode;
+
+    return pBamHeader;
+}
+
+// set the sort order and the filter of a bam instream
+static void TGM_ReadPairScanSetMode(TGM_BamInStreamLite* pBamInStreamLite, TGM_ScanResult* pResult)
+{
+    TGM_BamInStreamLiteSetSortMode(pBamInStreamLite, pResult->sortMode);
+
+    if (pResult->sortMode != TGM_SORTED_COORDINATE_NO_ZA)
+    {
+        TGM_BamInStreamLiteSetFilter(pBamInStreamLite, TGM_ReadPairFilter);
+        TGM_BamInStreamLiteSetFilterData(pBamInStreamLite, &(pResult->loadCross));
+    }
+    else
+    {
+        TGM_BamInStreamLiteSetFilter(pBamInStreamLite, TGM_ReadPairNoZAFilter);
+        TGM_BamInStreamLiteSetFilterData(pBamInStreamLite, &(pResult->filterData));
+    }
+}
+
+// scan a bam file with its own library table
+static void TGM_ReadPairScanFile(TGM_ScanResult* pResult, TGM_BamInStreamLite* pBamInStreamLite, const char* bamFileName, const TGM_ReadPairScanPars* pScanPars)
+{
+    TGM_BamHeader* pBamHeader = TGM_ReadPairScanOpen(pResult, pBamInStreamLite, bamFileName, pScanPars);
+    if (pBamHeader == NULL)
+        return;
+
+    TGM_LibInfoTable* pLibTable = pResult->pLibTable;
+    TGM_FragLenHistArray* pHistArray = pResult->pHistArray;
+    TGM_SpecialID* pSpecialID = pResult->pSpecialID;
+
+    TGM_Bool isCoordinate = (TGM_BamHeaderGetSortMode(pBamHeader) == TGM_SORTED_COORDINATE_NO_ZA);
+
+    // initialize the fragment length histogram array with the number of libraries in the bam file
+    TGM_FragLenHistArrayInit(pHistArray, pLibTable->size);
+
+    // set the sort order for the bam instream
+    TGM_ReadPairScanSetMode(pBamInStreamLite, pResult);
+
+    bam_index_t* pBamIndex = NULL;
+    if (pScanPars->sampleNum > 0)
+    {
+        if (isCoordinate)
+            pBamIndex = bam_index_load(bamFileName);
+
+        if (pBamIndex == NULL)
+            TGM_ErrMsg("WARNING: \"%s\" is not sorted by coordinate or not indexed. The whole file will be scanned.\n", bamFileName);
+    }
+
+    if (pBamIndex != NULL)
+    {
+        if (pResult->sortMode == TGM_SORTED_COORDINATE_ZA)
+            TGM_ReadPairScanSpecialID(pSpecialID, pBamInStreamLite);
 
+        TGM_ReadPairScanSample(pHistArray, pBamInStreamLite, pBamIndex, pLibTable, pScanPars);
+        bam_index_destroy(pBamIndex);
+    }
+    else
+    {
         int retNum = 0;
         const bam1_t* pAlgns[3] = {NULL, NULL, NULL};
 
@@ -154,23 +491,619 @@ void TGM_ReadPairScan(const TGM_ReadPairScanPars* pScanPars)
                 if (TGM_IsNormalPair(&pairStats, &zaTag, &zaStatus, pMateInfo, &backHistIndex, pAlgns, retNum, pLibTable, pScanPars->minMQ))
                     TGM_FragLenHistArrayUpdate(pHistArray, backHistIndex, pairStats.fragLen);
 
-                if (zaStatus == TGM_OK) {
+                if (zaStatus == TGM_OK)
                     TGM_SpecialIDUpdate(pSpecialID, &zaTag);
-		}
             }
 
         }while(bamStatus == TGM_OK);
+    }
+
+    // finish the process of the histogram and update the library information table
+    TGM_FragLenHistArrayFinalize(pHistArray);
+    TGM_LibInfoTableUpdate(pLibTable, pHistArray, 0, pScanPars->minFrags);
+
+    // close the bam file
+    TGM_BamInStreamLiteClose(pBamInStreamLite);
+    TGM_BamHeaderFree(pBamHeader);
+}
+
+// split an indexed bam file into regions for the scan threads. the whole
+// file is scanned by one thread if it is not sorted by coordinate or not indexed
+static void TGM_ReadPairScanPrepare(TGM_ScanResult* pResult, TGM_BamInStreamLite* pBamInStreamLite, const char* bamFileName,
+                                    const TGM_ReadPairScanPars* pScanPars, unsigned int numThreads)
+{
+    if (numThreads < 2 || pScanPars->sampleNum > 0)
+        return;
+
+    // only peek at the sorting order before loading the index
+    TGM_BamInStreamLiteOpen(pBamInStreamLite, bamFileName);
+    TGM_BamHeader* pBamHeader = TGM_BamInStreamLiteLoadHeader(pBamInStreamLite);
+    TGM_Bool isCoordinate = (TGM_BamHeaderGetSortMode(pBamHeader) == TGM_SORTED_COORDINATE_NO_ZA);
+
+    TGM_BamInStreamLiteClose(pBamInStreamLite);
+    TGM_BamHeaderFree(pBamHeader);
+
+    if (!isCoordinate || (pResult->pBamIndex = bam_index_load(bamFileName)) == NULL)
+        return;
+
+    pBamHeader = TGM_ReadPairScanOpen(pResult, pBamInStreamLite, bamFileName, pScanPars);
+    if (pBamHeader == NULL)
+    {
+        // leave the empty bam file to the whole file scan
+        TGM_LibInfoTableFree(pResult->pLibTable);
+        TGM_FragLenHistArrayFree(pResult->pHistArray);
+        TGM_SpecialIDFree(pResult->pSpecialID);
+        bam_index_destroy(pResult->pBamIndex);
+        memset(pResult, 0, sizeof(TGM_ScanResult));
+        return;
+    }
+
+    TGM_BamInStreamLiteClose(pBamInStreamLite);
+
+    const bam_header_t* pOrigHeader = pBamHeader->pOrigHeader;
+
+    uint64_t totalLen = 0;
+    for (int32_t i = 0; i != pOrigHeader->n_targets; ++i)
+        totalLen += pOrigHeader->target_len[i];
+
+    uint64_t shardLen = totalLen / (numThreads * SCAN_SHARDS_PER_THREAD);
+    if (shardLen < SCAN_MIN_SHARD_LEN)
+        shardLen = SCAN_MIN_SHARD_LEN;
+
+    // regions never cross the chromosomes
+    unsigned int capShards = 0;
+    for (int32_t i = 0; i != pOrigHeader->n_targets; ++i)
+        capShards += (pOrigHeader->target_len[i] + shardLen - 1) / shardLen;
+
+    pResult->pShards = (TGM_ScanShard*) calloc(capShards + 1, sizeof(TGM_ScanShard));
+    if (pResult->pShards == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the scan regions.\n");
+
+    for (int32_t i = 0; i != pOrigHeader->n_targets; ++i)
+    {
+        uint32_t refLen = pOrigHeader->target_len[i];
+        if (refLen == 0)
+            continue;
+
+        unsigned int numPieces = (refLen + shardLen - 1) / shardLen;
+        uint32_t pieceLen = (refLen + numPieces - 1) / numPieces;
 
-        // finish the process of the histogram and update the library information table
-        TGM_FragLenHistArrayFinalize(pHistArray);
-        TGM_LibInfoTableUpdate(pLibTable, pHistArray, oldSize, pScanPars->minFrags);
+        for (unsigned int j = 0; j != numPieces; ++j)
+        {
+            TGM_ScanShard* pShard = pResult->pShards + pResult->numShards;
+
+            pShard->refID = i;
+            pShard->begin = j * pieceLen;
+
+            // the last region also takes any alignment beyond the end of the chromosome
+            pShard->end = (j == numPieces - 1 ? INT_MAX : (int32_t) ((j + 1) * pieceLen));
+
+            ++(pResult->numShards);
+        }
+    }
+
+    TGM_BamHeaderFree(pBamHeader);
+}
+
+static void TGM_ScanShardAddCross(TGM_ScanShard* pShard, const char* queryName, uint32_t backHistIndex, uint32_t fragLen)
+{
+    if (pShard->numCross == pShard->capCross)
+    {
+        pShard->capCross = pShard->capCross == 0 ? 100 : pShard->capCross * 2;
+        pShard->pCrossMates = (TGM_CrossMate*) realloc(pShard->pCrossMates, sizeof(TGM_CrossMate) * pShard->capCross);
+        if (pShard->pCrossMates == NULL)
+            TGM_ErrQuit("ERROR: Not enough memory for the cross-region mates.\n");
+    }
+
+    TGM_CrossMate* pCrossMate = pShard->pCrossMates + pShard->numCross;
+    pCrossMate->queryName = strdup(queryName);
+    pCrossMate->backHistIndex = backHistIndex;
+    pCrossMate->fragLen = fragLen;
+
+    ++(pShard->numCross);
+}
+
+// scan the alignments starting in a region of a bam file. pairs whose mates
+// are both in the region go into the histograms of the region directly, the
+// others are kept until the regions are reduced in order
+static void TGM_ReadPairScanShard(TGM_ScanShard* pShard, TGM_BamInStreamLite* pBamInStreamLite, TGM_ScanResult* pResult,
+                                  const char* bamFileName, const TGM_ReadPairScanPars* pScanPars)
+{
+    const TGM_LibInfoTable* pLibTable = pResult->pLibTable;
+
+    pShard->pHistArray = TGM_FragLenHistArrayAlloc(10);
+    TGM_FragLenHistArrayInit(pShard->pHistArray, pLibTable->size);
+    pShard->pSpecialID = TGM_SpecialIDAlloc(10);
+    pShard->pPendingHash = kh_init(name);
+
+    TGM_BamInStreamLiteOpen(pBamInStreamLite, bamFileName);
+    TGM_ReadPairScanSetMode(pBamInStreamLite, pResult);
+    TGM_BamInStreamLiteJump(pBamInStreamLite, pResult->pBamIndex, pShard->refID, pShard->begin, pShard->end);
+
+    int retNum = 0;
+    const bam1_t* pAlgns[3] = {NULL, NULL, NULL};
+
+    TGM_Status bamStatus = TGM_OK;
+    do
+    {
+        int64_t index = -1;
+        bamStatus = TGM_BamInStreamLiteRead(pAlgns, &retNum, &index, pBamInStreamLite);
+
+        if (retNum > 0)
+        {
+            TGM_PairStats pairStats;
+            TGM_ZAtag zaTag;
+
+            const TGM_MateInfo* pMateInfo = TGM_BamInStreamLiteGetMateInfo(pBamInStreamLite, index);
+
+            unsigned int backHistIndex = 0;
+            TGM_Status zaStatus = TGM_ERR;
+
+            if (pResult->sortMode == TGM_SORTED_COORDINATE_NO_ZA && pMateInfo == NULL)
+            {
+                // the upstream mate is in one of the previous regions. check
+                // this mate alone now and the upstream mate at the reduction
+                TGM_MateInfo uniqueMate;
+                memset(&uniqueMate, 0, sizeof(TGM_MateInfo));
+                uniqueMate.mapQ = 255;
+
+                if (TGM_IsNormalPair(&pairStats, &zaTag, &zaStatus, &uniqueMate, &backHistIndex, pAlgns, retNum, pLibTable, pScanPars->minMQ))
+                    TGM_ScanShardAddCross(pShard, bam1_qname(pAlgns[0]), backHistIndex, pairStats.fragLen);
+
+                continue;
+            }
+
+            if (TGM_IsNormalPair(&pairStats, &zaTag, &zaStatus, pMateInfo, &backHistIndex, pAlgns, retNum, pLibTable, pScanPars->minMQ))
+                TGM_FragLenHistArrayUpdate(pShard->pHistArray, backHistIndex, pairStats.fragLen);
+
+            if (zaStatus == TGM_OK)
+                TGM_SpecialIDUpdate(pShard->pSpecialID, &zaTag);
+        }
+
+    }while(bamStatus == TGM_OK);
+
+    // the upstream mates whose downstream mates are in the following regions
+    unsigned int numPending = 0;
+    const TGM_MateInfo** ppPending = TGM_BamInStreamLiteGetPendingMates(&numPending, pBamInStreamLite);
+    for (unsigned int i = 0; i != numPending; ++i)
+    {
+        int ret = 0;
+        char* queryName = strdup(ppPending[i]->queryName);
+        khiter_t khIter = kh_put(name, pShard->pPendingHash, queryName, &ret);
+        if (ret == 0)
+            free(queryName);
+
+        kh_value(pShard->pPendingHash, khIter) = ppPending[i]->mapQ;
+    }
+
+    free(ppPending);
+    TGM_BamInStreamLiteClose(pBamInStreamLite);
+}
+
+static void TGM_ReadPairScanClearPending(khash_t(name)* pPendingHash)
+{
+    for (khiter_t khIter = kh_begin(pPendingHash); khIter != kh_end(pPendingHash); ++khIter)
+    {
+        if (kh_exist(pPendingHash, khIter))
+            free((char*) kh_key(pPendingHash, khIter));
+    }
+
+    kh_clear(name, pPendingHash);
+}
+
+// A region is scanned with an empty mate information table, while the serial
+// scan enters it with the upstream mates carried over from the previous
+// regions. The two agree as long as the first alignment of each carried read
+// name in the region is a downstream mate crossing the region boundary, which
+// is then paired at the reduction just like in the serial scan. Any other
+// first alignment of a carried read name (a read name used by more than one
+// pair, or a secondary alignment) would be paired differently.
+// Only the alignments up to the first one of each carried read name are read.
+static TGM_Bool TGM_ReadPairScanCheckCarry(const khash_t(name)* pCarryHash, const TGM_ScanShard* pShard, TGM_ScanResult* pResult,
+                                           TGM_BamInStreamLite* pBamInStreamLite, const char* bamFileName)
+{
+    khash_t(name)* pWatchHash = kh_init(name);
+    for (khiter_t khIter = kh_begin(pCarryHash); khIter != kh_end(pCarryHash); ++khIter)
+    {
+        if (kh_exist(pCarryHash, khIter))
+        {
+            int ret = 0;
+            kh_put(name, pWatchHash, kh_key(pCarryHash, khIter), &ret);
+        }
+    }
+
+    TGM_BamInStreamLiteOpen(pBamInStreamLite, bamFileName);
+    TGM_BamInStreamLiteJump(pBamInStreamLite, pResult->pBamIndex, pShard->refID, pShard->begin, pShard->end);
+
+    TGM_Bool isExact = TRUE;
+    const bam1_t* pAlgn = NULL;
+    while (kh_size(pWatchHash) != 0 && TGM_BamInStreamLiteReadNext(&pAlgn, pBamInStreamLite) == TGM_OK)
+    {
+        // the same alignments as those kept by the mate information table
+        if (pAlgn->core.tid != pAlgn->core.mtid)
+            continue;
+
+        if (pAlgn->core.pos < pAlgn->core.mpos && TGM_ReadPairNoZAFilter(pAlgn, &(pResult->filterData)) != STREAM_KEEP)
+            continue;
+
+        khiter_t khIter = kh_get(name, pWatchHash, bam1_qname(pAlgn));
+        if (khIter == kh_end(pWatchHash))
+            continue;
+
+        if (pAlgn->core.pos <= pAlgn->core.mpos || pAlgn->core.mpos >= pShard->begin)
+        {
+            isExact = FALSE;
+            break;
+        }
+
+        kh_del(name, pWatchHash, khIter);
+    }
+
+    TGM_BamInStreamLiteClose(pBamInStreamLite);
+    kh_destroy(name, pWatchHash);
+
+    return isExact;
+}
+
+// Reduce the regions of a bam file in order. The upstream mates left in the
+// previous regions of the same chromosome are carried along, and a
+// downstream mate that finds its upstream mate there is counted just like it
+// would be in a serial scan (the mate information table of the serial scan
+// is cleared at each new chromosome too). If a region would pair a carried
+// read name differently, the bam file is scanned again by this thread alone.
+static void TGM_ReadPairScanReduce(TGM_ScanResult* pResult, TGM_BamInStreamLite* pBamInStreamLite, const char* bamFileName,
+                                   const TGM_ReadPairScanPars* pScanPars)
+{
+    TGM_FragLenHistArrayInit(pResult->pHistArray, pResult->pLibTable->size);
+
+    khash_t(name)* pCarryHash = kh_init(name);
+    int32_t carryRefID = -1;
+    TGM_Bool isExact = TRUE;
+
+    for (unsigned int i = 0; i != pResult->numShards; ++i)
+    {
+        TGM_ScanShard* pShard = pResult->pShards + i;
+        if (pShard->refID != carryRefID)
+        {
+            TGM_ReadPairScanClearPending(pCarryHash);
+            carryRefID = pShard->refID;
+        }
+
+        if (isExact && kh_size(pCarryHash) != 0)
+            isExact = TGM_ReadPairScanCheckCarry(pCarryHash, pShard, pResult, pBamInStreamLite, bamFileName);
+
+        if (!isExact)
+        {
+            // only release the rest of the regions
+            for (unsigned int j = 0; j != pShard->numCross; ++j)
+                free(pShard->pCrossMates[j].queryName);
+
+            TGM_ReadPairScanClearPending(pShard->pPendingHash);
+            kh_destroy(name, pShard->pPendingHash);
+            free(pShard->pCrossMates);
+            TGM_FragLenHistArrayFree(pShard->pHistArray);
+            TGM_SpecialIDFree(pShard->pSpecialID);
+            continue;
+        }
+
+        TGM_FragLenHistArrayMerge(pResult->pHistArray, pShard->pHistArray);
+        TGM_SpecialIDMerge(pResult->pSpecialID, pShard->pSpecialID);
+
+        for (unsigned int j = 0; j != pShard->numCross; ++j)
+        {
+            TGM_CrossMate* pCrossMate = pShard->pCrossMates + j;
+
+            khiter_t khIter = kh_get(name, pCarryHash, pCrossMate->queryName);
+            if (khIter != kh_end(pCarryHash))
+            {
+                uint32_t mapQ = kh_value(pCarryHash, khIter);
+                free((char*) kh_key(pCarryHash, khIter));
+                kh_del(name, pCarryHash, khIter);
+
+                if (mapQ >= pScanPars->minMQ)
+                    TGM_FragLenHistArrayUpdate(pResult->pHistArray, pCrossMate->backHistIndex, pCrossMate->fragLen);
+            }
+
+            free(pCrossMate->queryName);
+        }
+
+        for (khiter_t khIter = kh_begin(pShard->pPendingHash); khIter != kh_end(pShard->pPendingHash); ++khIter)
+        {
+            if (!kh_exist(pShard->pPendingHash, khIter))
+                continue;
+
+            int ret = 0;
+            char* queryName = (char*) kh_key(pShard->pPendingHash, khIter);
+            khiter_t carryIter = kh_put(name, pCarryHash, queryName, &ret);
+            if (ret == 0)
+                free(queryName);
+
+            kh_value(pCarryHash, carryIter) = kh_value(pShard->pPendingHash, khIter);
+        }
+
+        kh_destroy(name, pShard->pPendingHash);
+        free(pShard->pCrossMates);
+        TGM_FragLenHistArrayFree(pShard->pHistArray);
+        TGM_SpecialIDFree(pShard->pSpecialID);
+    }
+
+    TGM_ReadPairScanClearPending(pCarryHash);
+    kh_destroy(name, pCarryHash);
+
+    free(pResult->pShards);
+    pResult->pShards = NULL;
+
+    bam_index_destroy(pResult->pBamIndex);
+    pResult->pBamIndex = NULL;
+
+    if (!isExact)
+    {
+        TGM_ErrMsg("WARNING: A read name in \"%s\" is used by more than one alignment across the scan regions. "
+                   "The file is scanned again by one thread.\n", bamFileName);
+
+        TGM_LibInfoTableFree(pResult->pLibTable);
+        TGM_FragLenHistArrayFree(pResult->pHistArray);
+        TGM_SpecialIDFree(pResult->pSpecialID);
+
+        TGM_ReadPairScanFile(pResult, pBamInStreamLite, bamFileName, pScanPars);
+        return;
+    }
+
+    TGM_FragLenHistArrayFinalize(pResult->pHistArray);
+    TGM_LibInfoTableUpdate(pResult->pLibTable, pResult->pHistArray, 0, pScanPars->minFrags);
+}
+
+static void* TGM_ReadPairScanThread(void* pData)
+{
+    TGM_ScanData* pScanData = (TGM_ScanData*) pData;
+    TGM_BamInStreamLite* pBamInStreamLite = TGM_BamInStreamLiteAlloc();
+
+    while (TRUE)
+    {
+        pthread_mutex_lock(&(pScanData->mutex));
+        while (pScanData->nextTask == pScanData->numTasks && !pScanData->isFinished)
+            pthread_cond_wait(&(pScanData->taskCond), &(pScanData->mutex));
+
+        if (pScanData->nextTask == pScanData->numTasks)
+        {
+            pthread_mutex_unlock(&(pScanData->mutex));
+            break;
+        }
+
+        TGM_ScanTask task = pScanData->pTasks[pScanData->nextTask];
+        ++(pScanData->nextTask);
+        pthread_mutex_unlock(&(pScanData->mutex));
+
+        TGM_ScanResult* pResult = pScanData->pResults + task.fileIdx;
+        const char* bamFileName = pScanData->pBamFiles[task.fileIdx];
+
+        if (task.shardIdx < 0)
+            TGM_ReadPairScanFile(pResult, pBamInStreamLite, bamFileName, pScanData->pScanPars);
+        else
+            TGM_ReadPairScanShard(pResult->pShards + task.shardIdx, pBamInStreamLite, pResult, bamFileName, pScanData->pScanPars);
+
+        pthread_mutex_lock(&(pScanData->mutex));
+        ++(pResult->numDone);
+        pthread_cond_broadcast(&(pScanData->doneCond));
+        pthread_mutex_unlock(&(pScanData->mutex));
+    }
+
+    TGM_BamInStreamLiteFree(pBamInStreamLite);
+    return NULL;
+}
+
+// load the names of the bam files from the file list
+static char** TGM_ReadPairScanLoadFileList(unsigned int* pNumFiles, FILE* fileListInput)
+{
+    unsigned int capacity = 10;
+    char** pBamFiles = (char**) malloc(sizeof(char*) * capacity);
+    if (pBamFiles == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the bam file names.\n");
+
+    // buffer used to hold the bam file name
+    char bamFileName[TGM_MAX_LINE];
+
+    *pNumFiles = 0;
+    while (TGM_GetNextLine(bamFileName, TGM_MAX_LINE, fileListInput) == TGM_OK)
+    {
+        if (*pNumFiles == capacity)
+        {
+            capacity *= 2;
+            pBamFiles = (char**) realloc(pBamFiles, sizeof(char*) * capacity);
+            if (pBamFiles == NULL)
+                TGM_ErrQuit("ERROR: Not enough memory for the bam file names.\n");
+        }
+
+        pBamFiles[*pNumFiles] = strdup(bamFileName);
+        ++(*pNumFiles);
+    }
+
+    return pBamFiles;
+}
+
+void TGM_ReadPairScan(const TGM_ReadPairScanPars* pScanPars)
+{
+    TGM_Status status = TGM_CheckWorkingDir(pScanPars->workingDir);
+    if (status != TGM_OK)
+        TGM_ErrQuit("ERROR: Error found during creating the working directory.\n");
+
+    // get the library table output file name
+    char* libTableOutputFile = TGM_CreateFileName(pScanPars->workingDir, TGM_LibTableFileName);
+
+    // write the library information table into the file
+    FILE* libTableOutput = fopen(libTableOutputFile, "wb");
+    if (libTableOutput == NULL)
+        TGM_ErrQuit("ERROR: Cannot open the library output file: %s\n", libTableOutputFile);
+
+    free(libTableOutputFile);
+
+    // open the fragment length histogram output file
+    char* histOutputFile = TGM_CreateFileName(pScanPars->workingDir, TGM_HistFileName);
+    FILE* histOutput = fopen(histOutputFile, "w");
+    if (histOutput == NULL)
+        TGM_ErrQuit("ERROR: Cannot open fragment length histogram file: %s\n", histOutputFile);
+
+    free(histOutputFile);
+
+    uint32_t readGrpCount = 0;
+    TGM_FragLenHistArrayWriteHeader(readGrpCount, histOutput);
+
+    // Each bam file is scanned into its own library table, histogram array
+    // and special ID list, either by one of the threads or, if it is indexed,
+    // by several threads over its regions. The partial results are merged
+    // here in the order of the file list as soon as they are ready, so the
+    // output files are the same as those of a serial scan.
+    TGM_ScanData scanData;
+    scanData.pScanPars = pScanPars;
+    scanData.pBamFiles = TGM_ReadPairScanLoadFileList(&(scanData.numFiles), pScanPars->fileListInput);
+
+    scanData.pResults = (TGM_ScanResult*) calloc(scanData.numFiles + 1, sizeof(TGM_ScanResult));
+    if (scanData.pResults == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the scan results.\n");
+
+    scanData.capTasks = scanData.numFiles + 1;
+    scanData.pTasks = (TGM_ScanTask*) malloc(sizeof(TGM_ScanTask) * scanData.capTasks);
+    if (scanData.pTasks == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the scan tasks.\n");
+
+    scanData.numTasks = 0;
+    scanData.nextTask = 0;
+    scanData.isFinished = FALSE;
+
+    pthread_mutex_init(&(scanData.mutex), NULL);
+    pthread_cond_init(&(scanData.taskCond), NULL);
+    pthread_cond_init(&(scanData.doneCond), NULL);
+
+    unsigned int numThreads = pScanPars->numThreads;
+    pthread_t* pThreads = (pthread_t*) malloc(sizeof(pthread_t) * (numThreads + 1));
+    if (pThreads == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the scan threads.\n");
+
+    for (unsigned int i = 0; i != numThreads; ++i)
+    {
+        if (pthread_create(pThreads + i, NULL, TGM_ReadPairScanThread, &scanData) != 0)
+            TGM_ErrQuit("ERROR: Cannot create the scan thread.\n");
+    }
+
+    TGM_LibInfoTable* pLibTable = NULL;
+    TGM_SpecialID* pSpecialID = TGM_SpecialIDAlloc(10);
+
+    unsigned int capIsNew = 20;
+    TGM_Bool* pIsNew = (TGM_Bool*) malloc(sizeof(TGM_Bool) * capIsNew);
+    if (pIsNew == NULL)
+        TGM_ErrQuit("ERROR: Not enough memory for the read group flags.\n");
+
+    // the bam instream used to split the bam files into regions
+    TGM_BamInStreamLite* pBamInStreamLite = TGM_BamInStreamLiteAlloc();
+
+    // at most one bam file for each thread is queued ahead of the merge
+    unsigned int numQueued = 0;
+    for (unsigned int i = 0; i != scanData.numFiles; ++i)
+    {
+        for (; numQueued != scanData.numFiles && numQueued < i + numThreads; ++numQueued)
+        {
+            TGM_ScanResult* pQueued = scanData.pResults + numQueued;
+            TGM_ReadPairScanPrepare(pQueued, pBamInStreamLite, scanData.pBamFiles[numQueued], pScanPars, numThreads);
+
+            unsigned int numNewTasks = (pQueued->pShards != NULL ? pQueued->numShards : 1);
+
+            pthread_mutex_lock(&(scanData.mutex));
+            if (scanData.numTasks + numNewTasks > scanData.capTasks)
+            {
+                scanData.capTasks = (scanData.numTasks + numNewTasks) * 2;
+                scanData.pTasks = (TGM_ScanTask*) realloc(scanData.pTasks, sizeof(TGM_ScanTask) * scanData.capTasks);
+                if (scanData.pTasks == NULL)
+                    TGM_ErrQuit("ERROR: Not enough memory for the scan tasks.\n");
+            }
+
+            for (unsigned int j = 0; j != numNewTasks; ++j)
+            {
+                scanData.pTasks[scanData.numTasks].fileIdx = numQueued;
+                scanData.pTasks[scanData.numTasks].shardIdx = (pQueued->pShards != NULL ? (int) j : -1);
+                ++(scanData.numTasks);
+            }
+
+            if (numQueued == scanData.numFiles - 1)
+                scanData.isFinished = TRUE;
+
+            pthread_cond_broadcast(&(scanData.taskCond));
+            pthread_mutex_unlock(&(scanData.mutex));
+        }
+
+        TGM_ScanResult* pResult = scanData.pResults + i;
+        unsigned int numTasks = (pResult->pShards != NULL ? pResult->numShards : 1);
+
+        pthread_mutex_lock(&(scanData.mutex));
+        while (pResult->numDone != numTasks)
+            pthread_cond_wait(&(scanData.doneCond), &(scanData.mutex));
+        pthread_mutex_unlock(&(scanData.mutex));
+
+        if (pResult->pShards != NULL)
+            TGM_ReadPairScanReduce(pResult, pBamInStreamLite, scanData.pBamFiles[i], pScanPars);
+
+        TGM_FragLenHistArray* pHistArray = pResult->pHistArray;
+
+        if (pLibTable == NULL)
+        {
+            TGM_SWAP(pLibTable, pResult->pLibTable, TGM_LibInfoTable*);
+        }
+        else
+        {
+            if (pResult->pLibTable->size > capIsNew)
+            {
+                capIsNew = pResult->pLibTable->size * 2;
+                free(pIsNew);
+                pIsNew = (TGM_Bool*) malloc(sizeof(TGM_Bool) * capIsNew);
+                if (pIsNew == NULL)
+                    TGM_ErrQuit("ERROR: Not enough memory for the read group flags.\n");
+            }
+
+            if (TGM_LibInfoTableAppend(pLibTable, pIsNew, pResult->pLibTable) != TGM_OK)
+                TGM_ErrQuit("ERROR: Found an error when loading the bam file.\n");
+
+            // drop the histograms of the read groups found in the previous bam files
+            unsigned int numNew = 0;
+            for (unsigned int j = 0; j != pHistArray->size; ++j)
+            {
+                if (pIsNew[j])
+                {
+                    if (j != numNew)
+                        TGM_SWAP(pHistArray->data[numNew], pHistArray->data[j], TGM_FragLenHist);
+
+                    ++numNew;
+                }
+            }
+
+            pHistArray->size = numNew;
+        }
 
         // write the fragment length histogram into the file
         TGM_FragLenHistArrayWrite(pHistArray, histOutput);
+        TGM_SpecialIDMerge(pSpecialID, pResult->pSpecialID);
 
-        // close the bam file
-        TGM_BamInStreamLiteClose(pBamInStreamLite);
-        TGM_BamHeaderFree(pBamHeader);
+        TGM_LibInfoTableFree(pResult->pLibTable);
+        TGM_FragLenHistArrayFree(pHistArray);
+        TGM_SpecialIDFree(pResult->pSpecialID);
+
+        free(scanData.pBamFiles[i]);
+    }
+
+    // release the threads waiting for a task if there is no bam file at all
+    pthread_mutex_lock(&(scanData.mutex));
+    scanData.isFinished = TRUE;
+    pthread_cond_broadcast(&(scanData.taskCond));
+    pthread_mutex_unlock(&(scanData.mutex));
+
+    for (unsigned int i = 0; i != numThreads; ++i)
+        pthread_join(pThreads[i], NULL);
+
+    TGM_BamInStreamLiteFree(pBamInStreamLite);
+
+    if (pLibTable == NULL)
+    {
+        pLibTable = TGM_LibInfoTableAlloc(1, 1, 1, pScanPars->specialPrefix);
+        TGM_LibInfoTableSetCutoff(pLibTable, pScanPars->cutoff);
+        TGM_LibInfoTableSetTrimRate(pLibTable, pScanPars->trimRate);
     }
 
     // write the library information into file
@@ -183,8 +1116,16 @@ void TGM_ReadPairScan(const TGM_ReadPairScanPars* pScanPars)
     fclose(histOutput);
     TGM_SpecialIDFree(pSpecialID);
     TGM_LibInfoTableFree(pLibTable);
-    TGM_FragLenHistArrayFree(pHistArray);
-    TGM_BamInStreamLiteFree(pBamInStreamLite);
+
+    pthread_mutex_destroy(&(scanData.mutex));
+    pthread_cond_destroy(&(scanData.taskCond));
+    pthread_cond_destroy(&(scanData.doneCond));
+
+    free(pIsNew);
+    free(pThreads);
+    free(scanData.pResults);
+    free(scanData.pTasks);
+    free(scanData.pBamFiles);
 }
 
 void TGM_SpecialIDUpdate(TGM_SpecialID* pSpecialID, const TGM_ZAtag* pZAtag)
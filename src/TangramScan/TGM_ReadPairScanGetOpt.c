@@ -24,7 +24,7 @@
 #include "TGM_ReadPairScanGetOpt.h"
 
 // total number of arguments we should expect for the split-read build program
-#define OPT_SCAN_TOTAL_NUM 8
+#define OPT_SCAN_TOTAL_NUM 10
 
 // total number of required arguments we should expect for the split-read build program
 #define OPT_SCAN_REQUIRED_NUM 2
@@ -50,6 +50,10 @@
 
 #define OPT_MIN_NORMAL_FRAG 7
 
+#define OPT_NUM_THREADS    8
+
+#define OPT_SAMPLE_NUM     9
+
 #define DEFAULT_SCAN_CUTOFF 0.01
 
 #define DEFAULT_SCAN_TRIM_RATE 0.002
@@ -58,6 +62,8 @@
 
 #define DEFAULT_MIN_NORMAL_FRAG 10000
 
+#define DEFAULT_SCAN_NUM_THREADS 1
+
 // set the parameters for the split-read build program from the pScanParsed command line arguments
 void TGM_ReadPairScanSetPars(TGM_ReadPairScanPars* pScanPars, int argc, char* argv[])
 {
@@ -71,6 +77,8 @@ void TGM_ReadPairScanSetPars(TGM_ReadPairScanPars* pScanPars, int argc, char* ar
         {"mq",  NULL, FALSE},
         {"sp",  NULL, FALSE},
         {"mf",  NULL, FALSE},
+        {"p",   NULL, FALSE},
+        {"sn",  NULL, FALSE},
         {NULL,   NULL, FALSE}
     };
 
@@ -181,6 +189,38 @@ void TGM_ReadPairScanSetPars(TGM_ReadPairScanPars* pScanPars, int argc, char* ar
                 else
                     pScanPars->minFrags = DEFAULT_MIN_NORMAL_FRAG;
 
+                break;
+            case OPT_NUM_THREADS:
+                if (opts[i].isFound)
+                {
+                    if (opts[i].value == NULL)
+                        TGM_ErrQuit("ERROR: Number of threads is not specified.\n");
+
+                    int numThreads = atoi(opts[i].value);
+                    if (numThreads <= 0)
+                        TGM_ErrQuit("ERROR: %s is an invalid number of threads.\n", opts[i].value);
+
+                    pScanPars->numThreads = numThreads;
+                }
+                else
+                    pScanPars->numThreads = DEFAULT_SCAN_NUM_THREADS;
+
+                break;
+            case OPT_SAMPLE_NUM:
+                if (opts[i].isFound)
+                {
+                    if (opts[i].value == NULL)
+                        TGM_ErrQuit("ERROR: Number of sampled normal pairs is not specified.\n");
+
+                    int sampleNum = atoi(opts[i].value);
+                    if (sampleNum < 0)
+                        TGM_ErrQuit("ERROR: %s is an invalid number of sampled normal pairs.\n", opts[i].value);
+
+                    pScanPars->sampleNum = sampleNum;
+                }
+                else
+                    pScanPars->sampleNum = 0;
+
                 break;
             default:
                 TGM_ErrQuit("ERROR: Unrecognized argument.\n");
@@ -200,6 +240,9 @@ void TGM_ReadPairScanHelp(void)
     printf("                     -tr   FLOAT  trim rate for the fragment length distribution[0.02 total for both side]\n");
     printf("                     -mq   INT    minimum mapping quality for a normal read pair\n");
     printf("                     -mf   INT    minimum number of nomral fragments in a library[10000]\n");
+    printf("                     -p    INT    number of scan threads. indexed bam files are split by regions among them[1]\n");
+    printf("                     -sn   INT    sample windows of an indexed bam file until each library has INT normal pairs\n");
+    printf("                                  or its fragment length distribution converges (0 scans the whole file)[0]\n");
     printf("                     -help        print this help message\n");
     exit(0);
 }
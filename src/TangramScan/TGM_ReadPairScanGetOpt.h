@@ -42,6 +42,10 @@ typedef struct
 
     uint32_t minFrags;             // minimum number of normal fragments in a library
 
+    unsigned int numThreads;       // number of bam files scanned at the same time
+
+    uint32_t sampleNum;            // target number of normal pairs in each library when sampling an indexed bam file (0 for whole file)
+
 }TGM_ReadPairScanPars;
 
 // set the parameters for the split-read build program from the parsed command line arguments 